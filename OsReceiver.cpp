@@ -24,13 +24,13 @@
 //
 #define NO_VERIFY_CHECKSUMS 0
 
-#include "OsReceiver.h"
-
-extern "C" {
-#include "osrx.h"
-}
+#include <util/crc16.h>
 
-const unsigned long mm_diff = 0x7fffffffUL; 
+#include "OsReceiver.h"
+#include "rxstats.h"
+#include "profile.h"
+#include "filter.h"
+#include "xprint.h"
 
 #if ENABLE_DEBUG_PRINT
 const char hexChars[16] = { 
@@ -48,25 +48,55 @@ const char hexChars[16] = {
     osrx_init();
   }
 
+  //
+  // returns the receiver with a message, taking receivers in turns, or OSRX_RECEIVERS when
+  // there are no messages
+  //
+  byte OsRx::ready()
+  {
+    for (byte i = 0; i < OSRX_RECEIVERS; i++)
+    {
+      byte rx = last_receiver + 1 + i;
+      if (rx >= OSRX_RECEIVERS)
+        rx -= OSRX_RECEIVERS;
+      if (osrx_data_available(rx))
+        return rx;
+    }
+    return OSRX_RECEIVERS;
+  }
+
   boolean OsRx::data_available()
   {
-    return osrx_data_available();
+    return ready() != OSRX_RECEIVERS;
+  }
+
+  void OsRx::skip()
+  {
+    byte rx = ready();
+    if (rx != OSRX_RECEIVERS)
+      start_receiving(rx);
   }
 
   byte OsRx::get_data(byte *packet, byte length, byte *protocol)
   {
-    if (!osrx_data_available()) return 0;
+    byte rx = ready();
+    if (rx == OSRX_RECEIVERS) return 0;
+    PROFILE_GET_DATA();
 
     byte duplicateIndex = 0;
     byte duplicateLength = 0;
     byte protocol_version;
-    byte msgLen = get_osrx_data(packet, length, &protocol_version);
-    start_receiving();
+    byte msgLen = get_osrx_data(rx, packet, length, &protocol_version);
+    last_receiver = rx;
+    last_packet_time = get_osrx_packet_time(rx);
+    last_packet_repaired = false;
+    start_receiving(rx);
 
     //
     // validate the sync nibble. it is the same for version 2 and 3 protocols
     //
     bool msgOk = packet[0] == 0x0A;
+#if OSRX_PROTOCOLS & OSRX_V2
     //
     // for protocol version 2, there may be two concatenated copies of the same message 
     // this is indicated if the pattern "FFFFA" occurs in the message. "FFFF" is the 
@@ -112,13 +142,24 @@ const char hexChars[16] = {
           // copy the 2nd message on top of the first, destroying it
           memcpy(packet, packet+duplicateIndex, duplicateLength);
           // reset the pointers and we're done
-          duplicateIndex = duplicateLength = 0;
           msgLen = duplicateLength;
+          duplicateIndex = duplicateLength = 0;
           msgOk = true;
         }
       } // if (foundHdr)
 
     }   // if (msgLen > 27)
+#endif
+
+    if (!msgOk)
+    {
+      RX_STAT_INC(rxStats.syncErrors);
+    }
+    else if (msgLen >= 8 && !filterPass(packet))
+    {
+      // unwanted sensor, skip the checksum and everything after it
+      return 0;
+    }
 
     do 
     {
@@ -146,6 +187,12 @@ const char hexChars[16] = {
           msgOk = ValidChecksum(packet, ++cksumIndex);
         }
 
+        if (msgOk && cksumIndex + 4 != msgLen)
+        {
+          RX_STAT_INC(rxStats.repaired);
+          last_packet_repaired = true;
+        }
+
         msgLen = cksumIndex + 4;
 
         // for both version 2.1 and 3.0 protocols, msgLen is includes two nibbles
@@ -162,9 +209,13 @@ const char hexChars[16] = {
       memcpy(packet, packet+duplicateIndex, duplicateLength);
       msgLen = duplicateLength;
       duplicateIndex = duplicateLength = 0;
+      // the sync nibble of the duplicate was found with its preamble, validate its checksum
+      msgOk = true;
 
     } while (true);
 
+    if (!msgOk && packet[0] == 0x0A)
+      RX_STAT_INC(rxStats.checksumFail);
 
 #if ENABLE_DEBUG_PRINT && !ENABLE_HEX_OUTPUT
     if (!msgOk)
@@ -180,26 +231,13 @@ const char hexChars[16] = {
 
     //
     // version 2.1 protocol messages include a full repeat of the 
-    // message with every transmission.
-    // detect repeated version 2.1 protocol messages here
-    // and get rid of one of them if it matches the previous one
+    // message with every transmission, and every receiver may get its own copy.
+    // detect copies here and get rid of all but the first one
     //
-    if (msgOk && protocol_version == 2)
-    {
-      unsigned long now = millis();
-      unsigned long tlim = previous_packet_time + 1000UL;
-      if ( MILLIS_CMP(now, tlim) == -1 )
-      {
-        // this packet was received less than one second after the
-        // previous packet, so this might be a repeated packet. 
-        // the only way to know for sure is to compare data.
-        // if the data is equal, memcmp will return zero.
-        msgOk = memcmp(packet, previous_packet, msgLen-2) != 0; 
-      }
-      // log the time of this packet and save the packet data 
-      previous_packet_time = now;
-      memcpy(previous_packet, packet, msgLen);
-    }
+#if OSRX_DEDUPE
+    if (msgOk && (OSRX_RECEIVERS > 1 || protocol_version == 2))
+      msgOk = FirstCopy(packet, msgLen, rx, protocol_version == 2);
+#endif
 
     if (msgOk)
     {
@@ -213,6 +251,52 @@ const char hexChars[16] = {
 
   }
 
+#if OSRX_DEDUPE
+  //
+  // returns true for a message that is not a copy of a recently delivered one. the CRC
+  // covers all nibbles up to the checksum, so repaired and complete copies are the same.
+  // the same message from the same receiver is a copy only for protocols that repeat it.
+  //
+  boolean OsRx::FirstCopy(byte *packet, byte len, byte rx, boolean repeated)
+  {
+    uint16_t crc = 0xffff;
+    for (byte k = 0; k < len - 2; k++)
+      crc = _crc16_update(crc, packet[k]);
+    unsigned long now = millis();
+    byte bit = 1 << rx;
+    for (byte i = 0; i < DEDUPE_SLOTS; i++)
+    {
+      Recent& r = recent[i];
+      if (r.heard_by == 0 || r.crc != crc || now - r.time >= DEDUPE_WINDOW)
+        continue;
+      if ((r.heard_by & bit) && !repeated)
+        continue;
+      // a copy. a chain of copies extends the window like repeats did before
+      r.time = now;
+#if OSRX_RECEIVERS > 1
+      if (!(r.heard_by & bit))
+      {
+        r.heard_by |= bit;
+        RX_STAT_INC(heard[rx]);
+      }
+#endif
+      RX_STAT_INC(rxStats.repeats);
+      return false;
+    }
+    Recent& r = recent[recent_next];
+    if (++recent_next == DEDUPE_SLOTS)
+      recent_next = 0;
+    r.crc = crc;
+    r.heard_by = bit;
+    r.time = now;
+#if OSRX_RECEIVERS > 1
+    RX_STAT_INC(heard[rx]);
+    RX_STAT_INC(first[rx]);
+#endif
+    return true;
+  }
+#endif
+
   boolean OsRx::ValidChecksum(byte *packet, int Pos)
   {
 #if NO_VERIFY_CHECKSUMS
@@ -229,3 +313,18 @@ const char hexChars[16] = {
   }
 
   OsRx OsReceiver = OsRx();
+
+#if OSRX_RECEIVERS > 1
+void dumpReceivers() {
+  waitPrint();
+  print_C("{R:");
+  for (byte i = 0; i < OSRX_RECEIVERS; i++) {
+    if (i != 0)
+      Serial.print('|');
+    Serial.print(OsReceiver.heard[i]);
+    Serial.print(' ');
+    Serial.print(OsReceiver.first[i]);
+  }
+  print_C("}*\r\n");
+}
+#endif
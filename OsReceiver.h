@@ -20,6 +20,8 @@
 // Hardware connections and notes:
 //
 // Connect the data line from the receiver to Port B0 (Digital 8 on the Duemilanove).
+// With OSRX_RECEIVERS set to 2, connect the data line of the second receiver to Port D4
+// (Digital 4), e.g. on the far side of the house. Messages of both receivers are combined.
 // Optionally, an LED may be connected to Port D6 (Digital 6 on the Duemilanove).
 // The receiver may be powered from the Arduino's 5V supply and works with the 5V logic
 // levels of the Duemilanove  -- level translation is not required.
@@ -30,6 +32,21 @@
 
 #include <Arduino.h>
 
+extern "C" {
+#include "osrx.h"
+}
+
+//
+// version 2.1 protocol messages are sent twice and with several receivers every message
+// may come from each of them. the first valid copy is delivered, and a valid message that
+// has the same CRC as one of the last DEDUPE_SLOTS messages within DEDUPE_WINDOW is a copy
+// (for version 3 only when it is from another receiver). copies that fail the checksum are
+// dropped before, so a valid copy is always preferred.
+//
+#define OSRX_DEDUPE ((OSRX_RECEIVERS > 1) || (OSRX_PROTOCOLS & OSRX_V2))
+#define DEDUPE_SLOTS  4
+#define DEDUPE_WINDOW 1000 // ms
+
 class OsRx
 {
 public:
@@ -38,19 +55,55 @@ public:
   void init();
   boolean data_available();
   byte get_data(byte *buffer, byte length, byte *protocol);
+  // drops the next message without decoding it
+  void skip();
+  // receiver of the message from get_data
+  byte packet_receiver() { return last_receiver; }
+  // timestamp of the last RF edge of the message from get_data in timer 1 ticks (4 usec)
+  unsigned long packet_time() { return last_packet_time; }
+  // true when the message from get_data was valid only with lost trailing bits
+  boolean packet_repaired() { return last_packet_repaired; }
+  // millis() at the last RF edge of the message from get_data
+  unsigned long packet_millis() { return millis() - (osrx_now() - last_packet_time) / 250; }
+
+#if OSRX_RECEIVERS > 1
+  // valid messages that were new to a receiver and messages that were delivered from it first
+  uint16_t heard[OSRX_RECEIVERS];
+  uint16_t first[OSRX_RECEIVERS];
+#endif
 
 private:
+#if OSRX_DEDUPE
   //
-  // these used to detect version 2.1 protocol repeated packets
-  // so one of them can be discarded
+  // recently delivered messages, used to discard their copies
   //
-  byte previous_packet[64];
-  unsigned long previous_packet_time;
+  struct Recent
+  {
+    uint16_t crc;
+    byte heard_by;      // bit mask of receivers, 0 for an empty slot
+    unsigned long time; // millis() of the last copy
+  };
+  Recent recent[DEDUPE_SLOTS];
+  byte recent_next;
+#endif
+
+  byte last_receiver;
+  unsigned long last_packet_time;
+  boolean last_packet_repaired;
 
+  byte ready();
   boolean ValidChecksum(byte *packet, int Pos);
+#if OSRX_DEDUPE
+  boolean FirstCopy(byte *packet, byte len, byte rx, boolean repeated);
+#endif
 
 };
 
 extern OsRx OsReceiver;
 
+#if OSRX_RECEIVERS > 1
+// Prints for every receiver valid messages that were new to it and messages that were delivered from it first
+extern void dumpReceivers();
+#endif
+
 #endif
@@ -0,0 +1,431 @@
+// Benchmarks of firmware hot paths on the real target (run in simavr, see Makefile).
+// Every benchmark prints one CSV line to the serial port:
+//
+//   bench,<name>,<runs>,<min cycles>,<avg cycles>,<max cycles>,<stack bytes>
+//
+// Cycles are counted by timer 1 at clk/1 extended to 32 bits by its overflow interrupt,
+// measurement overhead is subtracted. Stack is the high-water mark below the caller,
+// found by painting free RAM before each run.
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+
+#include "../OsReceiver.h"
+#include "../display.h"
+#include "../parse.h"
+#include "../fmt_util.h"
+#include "../bmp085.h"
+#include "../xprint.h"
+#include "../filter.h"
+#include "../derived.h"
+
+extern "C" {
+#include "../osrx.h"
+#include "bench.h"
+
+void TIMER1_CAPT_vect(void);
+void TIMER2_OVF_vect(void);
+}
+
+extern uint8_t __heap_start;
+
+volatile unsigned int bench_icr1;
+
+#define STACK_PAINT 0xc5
+#define STACK_GUARD 16
+
+#define SHORT_TICKS 122 // 488 usec half-bit period
+#define LONG_TICKS  244
+
+// messages are sent on V3 unless the decoder is built for V2.1 only
+#define RX_V2 !(OSRX_PROTOCOLS & OSRX_V3)
+
+//================= MEASUREMENT =================
+
+unsigned long overhead;
+uint8_t* stackTop;
+unsigned long minCycles;
+unsigned long maxCycles;
+unsigned long sumCycles;
+unsigned int runs;
+unsigned int maxStack;
+
+void __attribute__((noinline)) stackPaint() {
+  uint8_t* sp = (uint8_t*)SP;
+  for (uint8_t* p = &__heap_start; p < sp - STACK_GUARD; p++)
+    *p = STACK_PAINT;
+}
+
+unsigned int stackUsed() {
+  uint8_t* p = &__heap_start;
+  while (p < stackTop && *p == STACK_PAINT)
+    p++;
+  return stackTop - p;
+}
+
+void benchStart() {
+  minCycles = 0xffffffffUL;
+  maxCycles = sumCycles = 0;
+  runs = maxStack = 0;
+}
+
+// start of one run, returns start time
+inline unsigned long runStart() {
+  stackTop = (uint8_t*)SP;
+  stackPaint();
+  return osrx_now();
+}
+
+inline void runEnd(unsigned long start) {
+  unsigned long c = osrx_now() - start;
+  c = c > overhead ? c - overhead : 0;
+  unsigned int s = stackUsed();
+  if (c < minCycles)
+    minCycles = c;
+  if (c > maxCycles)
+    maxCycles = c;
+  if (s > maxStack)
+    maxStack = s;
+  sumCycles += c;
+  runs++;
+}
+
+void benchEnd(const char* name) {
+  print_C("bench,");
+  print_P(name);
+  Serial.print(',');
+  Serial.print(runs);
+  Serial.print(',');
+  Serial.print(runs ? minCycles : 0);
+  Serial.print(',');
+  Serial.print(runs ? sumCycles / runs : 0);
+  Serial.print(',');
+  Serial.print(maxCycles);
+  Serial.print(',');
+  Serial.println(maxStack);
+}
+
+#define BENCH(name, runCount, code) {                         \
+    static const char benchName[] PROGMEM = name;             \
+    benchStart();                                             \
+    for (unsigned int benchRun = 0; benchRun < (runCount); benchRun++) { \
+      unsigned long benchTime = runStart();                   \
+      code;                                                   \
+      runEnd(benchTime);                                      \
+    }                                                         \
+    benchEnd(benchName);                                      \
+  }
+
+//================= CANNED INPUTS =================
+
+// message nibbles after the sync nibble, checksum and two trailing nibbles are appended
+const byte THGR810[] PROGMEM = { 0xF, 0x8, 0x2, 0x4, 1, 0xA, 0x5, 0, 3, 1, 2, 0, 5, 4, 0, 0 };
+const byte RAIN[] PROGMEM    = { 0x2, 0x9, 0x1, 0x4, 1, 0x3, 0xC, 0, 5, 2, 0, 0, 7, 4, 3, 1, 0, 0 };
+const byte UVN800[] PROGMEM  = { 0xD, 0x8, 0x7, 0x4, 1, 0x6, 0x1, 0, 4, 0, 0, 0 };
+const byte WIND[] PROGMEM    = { 0x1, 0x9, 0x8, 0x4, 1, 0x2, 0x7, 0, 6, 0, 0, 3, 4, 0, 5, 2, 0 };
+const byte UNKNOWN[] PROGMEM = { 0x5, 0xD, 0x6, 0x0, 1, 0x4, 0x4, 0, 1, 2, 3, 4, 5, 6 };
+
+byte nibbles[MAX_MSG_LEN];
+byte nibbleCount;
+
+// builds full message (sync, data, checksum, two trailing nibbles) in nibbles[]
+void makeMessage(const byte* data, byte len) {
+  nibbles[0] = 0xA;
+  byte sum = 0;
+  for (byte i = 0; i < len; i++) {
+    nibbles[1 + i] = pgm_read_byte(&data[i]);
+    sum += nibbles[1 + i];
+  }
+  nibbles[len + 1] = sum & 0xf;
+  nibbles[len + 2] = sum >> 4;
+  nibbles[len + 3] = 0;
+  nibbles[len + 4] = 0;
+  nibbleCount = len + 5;
+}
+
+inline byte messageBit(int i) {
+  return (nibbles[i >> 2] >> (i & 3)) & 1;
+}
+
+#define MAX_PERIODS 240
+
+byte periods[MAX_PERIODS];
+byte periodCount;
+
+void addPeriod(byte ticks) {
+  if (periodCount < MAX_PERIODS)
+    periods[periodCount++] = ticks;
+}
+
+// version 3: preamble of ones sent as short pairs, a long period flips the bit
+void makeV3() {
+  periodCount = 0;
+  for (byte i = 0; i < 24; i++) {
+    addPeriod(SHORT_TICKS);
+    addPeriod(SHORT_TICKS);
+  }
+  byte prev = 1;
+  for (int i = 0; i < nibbleCount * 4; i++) {
+    byte b = messageBit(i);
+    if (b != prev) {
+      addPeriod(LONG_TICKS);
+    } else {
+      addPeriod(SHORT_TICKS);
+      addPeriod(SHORT_TICKS);
+    }
+    prev = b;
+  }
+}
+
+// version 2.1: preamble of long periods and a short one, then every bit is repeated
+// inverted, so a changed bit is a short pair followed by a long period, and the same
+// bit is two long periods (the first bit after the preamble is always zero)
+void makeV2() {
+  periodCount = 0;
+  for (byte i = 0; i < 32; i++)
+    addPeriod(LONG_TICKS);
+  addPeriod(SHORT_TICKS);
+  addPeriod(SHORT_TICKS);
+  addPeriod(LONG_TICKS);
+  byte prev = 0;
+  for (int i = 1; i < nibbleCount * 4; i++) {
+    byte b = messageBit(i);
+    if (b != prev) {
+      addPeriod(SHORT_TICKS);
+      addPeriod(SHORT_TICKS);
+    } else
+      addPeriod(LONG_TICKS);
+    addPeriod(LONG_TICKS);
+    prev = b;
+  }
+}
+
+unsigned int edgeTime;
+
+// feeds canned periods to the capture ISR, measuring every call when bench is running
+void feedEdges(boolean measure) {
+  for (byte i = 0; i < periodCount; i++) {
+    edgeTime += periods[i];
+    bench_icr1 = edgeTime;
+    if (measure) {
+      unsigned long t = runStart();
+      TIMER1_CAPT_vect();
+      runEnd(t);
+    } else
+      TIMER1_CAPT_vect();
+  }
+}
+
+// prepares periods of the message from nibbles[] with a given protocol and resets the decoder
+void startMessage(boolean v2) {
+  if (v2)
+    makeV2();
+  else
+    makeV3();
+  edgeTime += 10000; // silence is noise, resets the decoder
+  bench_icr1 = edgeTime;
+  TIMER1_CAPT_vect();
+}
+
+// receives the message from nibbles[], leaves it ready for get_data
+void receive(boolean v2, boolean measure) {
+  startMessage(v2);
+  feedEdges(measure);
+  TIMER2_OVF_vect();
+}
+
+//================= BENCHMARKS =================
+
+const char B_CAPTURE_V3[] PROGMEM = "capture_isr_v3";
+const char B_CAPTURE_V2[] PROGMEM = "capture_isr_v2";
+const char B_TIMEOUT[] PROGMEM = "timeout_isr";
+const char B_GET_DATA_V3[] PROGMEM = "get_data_v3";
+const char B_GET_DATA_V2[] PROGMEM = "get_data_v2";
+const char B_PARSE_TEMP[] PROGMEM = "parse_thgr810";
+const char B_PARSE_RAIN[] PROGMEM = "parse_rain";
+const char B_PARSE_UV[] PROGMEM = "parse_uvn800";
+const char B_PARSE_WIND[] PROGMEM = "parse_wind";
+const char B_PARSE_UNKN[] PROGMEM = "parse_unknown";
+const char B_EMIT_LINE[] PROGMEM = "emit_line";
+const char B_RENDER_LINE[] PROGMEM = "render_line";
+
+// calibration of the BMP085 datasheet example, there is no sensor on the bus under simavr
+// (bmp085Calibration would wait for it forever), so it is loaded directly
+extern int16_t ac1, ac2, ac3;
+extern uint16_t ac4, ac5, ac6;
+extern int16_t b1, b2, mb, mc, md;
+
+#define BMP085_UT 27898 // 15.0 C
+#define BMP085_UP 23843 // 69964 Pa
+
+void loadCalibration() {
+  ac1 = 408;
+  ac2 = -72;
+  ac3 = -14383;
+  ac4 = 32741;
+  ac5 = 32757;
+  ac6 = 23153;
+  b1 = 6190;
+  b2 = 4;
+  mb = -32768;
+  mc = -8711;
+  md = 2868;
+}
+
+byte packet[65];
+byte version;
+byte len;
+
+void benchCapture(const char* name, boolean v2) {
+  makeMessage(THGR810, sizeof(THGR810));
+  benchStart();
+  for (byte i = 0; i < 10; i++) {
+    receive(v2, true);
+    start_receiving(0);
+  }
+  benchEnd(name);
+}
+
+void benchTimeout() {
+  benchStart();
+  for (byte i = 0; i < 10; i++) {
+    startMessage(RX_V2);
+    feedEdges(false);
+    unsigned long t = runStart();
+    TIMER2_OVF_vect();
+    runEnd(t);
+    start_receiving(0);
+  }
+  benchEnd(B_TIMEOUT);
+}
+
+void benchGetData(const char* name, boolean v2) {
+  benchStart();
+  for (byte i = 0; i < 10; i++) {
+    receive(v2, false);
+    unsigned long t = runStart();
+    OsReceiver.get_data(packet, sizeof(packet), &version);
+    runEnd(t);
+  }
+  benchEnd(name);
+}
+
+// lets console pacing in waitPrint expire, so that it is not counted
+void waitQuiet() {
+  delay(300);
+}
+
+void benchParse(const char* name, const byte* data, byte size) {
+  makeMessage(data, size);
+  receive(RX_V2, false);
+  len = OsReceiver.get_data(packet, sizeof(packet), &version);
+  benchStart();
+  for (byte i = 0; i < 10; i++) {
+    waitQuiet();
+    unsigned long t = runStart();
+    parsePacket(&packet[1], len - 1, millis(), false);
+    runEnd(t);
+  }
+  benchEnd(name);
+}
+
+volatile int16_t i16 = -1234;
+volatile int32_t i32 = -12345678L;
+volatile int16_t temp = 213;
+volatile uint8_t humidity = 45;
+volatile int16_t windSpeed = 83;
+volatile int16_t pressure = 10132;
+volatile int16_t derived;
+char buf[16];
+
+void setup() {
+  Serial.begin(57600);
+  setupDisplay();
+  setupFilter();
+  OsReceiver.init();
+  loadCalibration();
+  // canned edges instead of input capture, timer 1 counts CPU cycles
+  TIMSK1 = _BV(TOIE1);
+  TCCR1B = _BV(CS10);
+  sei();
+
+  unsigned long t;
+  benchStart();
+  for (byte i = 0; i < 10; i++) {
+    t = runStart();
+    runEnd(t);
+  }
+  overhead = minCycles;
+  BENCH("overhead", 10, {});
+
+#if OSRX_PROTOCOLS & OSRX_V3
+  benchCapture(B_CAPTURE_V3, false);
+#endif
+#if OSRX_PROTOCOLS & OSRX_V2
+  benchCapture(B_CAPTURE_V2, true);
+#endif
+
+  makeMessage(THGR810, sizeof(THGR810));
+  benchTimeout();
+#if OSRX_PROTOCOLS & OSRX_V3
+  benchGetData(B_GET_DATA_V3, false);
+#endif
+#if OSRX_PROTOCOLS & OSRX_V2
+  benchGetData(B_GET_DATA_V2, true);
+#endif
+
+  // a neighbour's sensor on the deny list, and the cost of a pass with the filter off
+  makeMessage(THGR810, sizeof(THGR810));
+  filterCommand("+F824");
+  filterCommand("D");
+  BENCH("filter_drop", 10, filterPass(nibbles));
+  filterCommand("O");
+  BENCH("filter_off", 10, filterPass(nibbles));
+
+  benchParse(B_PARSE_TEMP, THGR810, sizeof(THGR810));
+  benchParse(B_PARSE_RAIN, RAIN, sizeof(RAIN));
+  benchParse(B_PARSE_UV, UVN800, sizeof(UVN800));
+  benchParse(B_PARSE_WIND, WIND, sizeof(WIND));
+  benchParse(B_PARSE_UNKN, UNKNOWN, sizeof(UNKNOWN));
+
+  BENCH("format_int16", 10, formatDecimal((int16_t)i16, buf, 6, 1 | FMT_SIGN | FMT_SPACE));
+  BENCH("format_int32", 10, formatDecimal((int32_t)i32, buf, 9, FMT_SPACE));
+  // pressure uses b5 of the temperature
+  BENCH("bmp085_temperature", 10, bmp085GetTemperature(BMP085_UT));
+  BENCH("bmp085_pressure", 10, bmp085GetPressure(BMP085_UP));
+
+  BENCH("dew_point", 10, derived = dewPoint(temp, humidity));
+  BENCH("humidex", 10, derived = humidex(temp, humidity));
+  temp = -52;
+  BENCH("wind_chill", 10, derived = windChill(temp, windSpeed));
+  BENCH("sea_level_pressure", 10, derived = seaLevelPressure(pressure));
+
+  benchStart();
+  for (byte i = 0; i < 10; i++) {
+    waitQuiet();
+    t = runStart();
+    emitLine("1:  21.3 45%    ", "");
+    runEnd(t);
+  }
+  benchEnd(B_EMIT_LINE);
+
+  benchStart();
+  for (byte i = 0; i < 10; i++) {
+    waitQuiet();
+    t = runStart();
+    renderLine("1:  21.3 45%    ");
+    runEnd(t);
+  }
+  benchEnd(B_RENDER_LINE);
+
+  print_C("bench,done\r\n");
+  Serial.flush();
+  // stops simavr
+  cli();
+  sleep_enable();
+  sleep_cpu();
+}
+
+void loop() {
+}
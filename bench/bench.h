@@ -0,0 +1,8 @@
+// Hooks of the benchmark build, included into osrx.c with -include
+#ifndef BENCH_H
+#define BENCH_H
+
+// canned capture time that replaces ICR1 (OSRX_CAPTURE_TIME)
+extern volatile unsigned int bench_icr1;
+
+#endif
@@ -4,37 +4,40 @@
 #include "bmp085.h"
 #include "display.h"
 #include "fmt_util.h"
+#include "derived.h"
 #include "Timeout.h"
+#include "schedule.h"
+#include "pipeline.h"
 
 #define BMP085_ADDRESS 0x77  // I2C address of BMP085
 
 const unsigned char OSS = 0;  // Oversampling Setting
 
 // Calibration values
-int ac1;
-int ac2;
-int ac3;
-unsigned int ac4;
-unsigned int ac5;
-unsigned int ac6;
-int b1;
-int b2;
-int mb;
-int mc;
-int md;
+int16_t ac1;
+int16_t ac2;
+int16_t ac3;
+uint16_t ac4;
+uint16_t ac5;
+uint16_t ac6;
+int16_t b1;
+int16_t b2;
+int16_t mb;
+int16_t mc;
+int16_t md;
 
 // b5 is calculated in bmp085GetTemperature(...), this variable is also used in bmp085GetPressure(...)
 // so ...Temperature(...) must be called before ...Pressure(...).
-long b5;
+int32_t b5;
 
 // Calculate temperature given ut.
 // Value returned will be in units of 0.1 deg C
-inline short bmp085GetTemperature(unsigned int ut)
+short bmp085GetTemperature(uint16_t ut)
 {
-  long x1, x2;
+  int32_t x1, x2;
 
-  x1 = (((long)ut - (long)ac6)*(long)ac5) >> 15;
-  x2 = ((long)mc << 11)/(x1 + md);
+  x1 = (((int32_t)ut - (int32_t)ac6)*(int32_t)ac5) >> 15;
+  x2 = ((int32_t)mc << 11)/(x1 + md);
   b5 = x1 + x2;
 
   return ((b5 + 8)>>4);
@@ -44,25 +47,25 @@ inline short bmp085GetTemperature(unsigned int ut)
 // calibration values must be known
 // b5 is also required so bmp085GetTemperature(...) must be called first.
 // Value returned will be pressure in units of Pa.
-inline long bmp085GetPressure(unsigned long up)
+int32_t bmp085GetPressure(uint32_t up)
 {
-  long x1, x2, x3, b3, b6, p;
-  unsigned long b4, b7;
+  int32_t x1, x2, x3, b3, b6, p;
+  uint32_t b4, b7;
 
   b6 = b5 - 4000;
   // Calculate B3
   x1 = (b2 * (b6 * b6)>>12)>>11;
   x2 = (ac2 * b6)>>11;
   x3 = x1 + x2;
-  b3 = (((((long)ac1)*4 + x3)<<OSS) + 2)>>2;
+  b3 = (((((int32_t)ac1)*4 + x3)<<OSS) + 2)>>2;
 
   // Calculate B4
   x1 = (ac3 * b6)>>13;
   x2 = (b1 * ((b6 * b6)>>12))>>16;
   x3 = ((x1 + x2) + 2)>>2;
-  b4 = (ac4 * (unsigned long)(x3 + 32768))>>15;
+  b4 = (ac4 * (uint32_t)(x3 + 32768))>>15;
 
-  b7 = ((unsigned long)(up - b3) * (50000>>OSS));
+  b7 = ((uint32_t)(up - b3) * (50000>>OSS));
   if (b7 < 0x80000000)
     p = (b7<<1)/b4;
   else
@@ -95,7 +98,7 @@ char bmp085Read(unsigned char address)
 // Read 2 bytes from the BMP085
 // First byte will be from 'address'
 // Second byte will be from 'address'+1
-int bmp085ReadInt(unsigned char address)
+int16_t bmp085ReadInt(unsigned char address)
 {
   unsigned char msb, lsb;
 
@@ -189,9 +192,12 @@ void bmp085Calibration()
 const long PERIOD = 55000L; // 55 secs
 
 Timeout bmp085Period(PERIOD); 
+Deferred bmp085Deferred;
 
 // POSITIONS                  0123456789012345
 const char sPRES[] PROGMEM = "P: -??.? ????.? ";
+const char xPRES[] PROGMEM = "qnh ????.?";
+// POSITIONS                  0123456789012345
 
 void setupBMP085() {
   Wire.begin();
@@ -199,7 +205,7 @@ void setupBMP085() {
 }
 
 void checkBMP085() {
-  if (!bmp085Period.check())
+  if (!bmp085Deferred.ready(bmp085Period.check(), BUSY_BMP085))
     return;
   bmp085Period.reset(PERIOD);
   int temperature = bmp085GetTemperature(bmp085ReadUT());
@@ -207,5 +213,7 @@ void checkBMP085() {
   strcpy_P(displayBuf, sPRES);
   formatDecimal(temperature, &displayBuf[3], 5, 1 | FMT_SPACE);
   formatDecimal(pressure, &displayBuf[9], 6, 1 | FMT_SPACE);
-  updateDisplay(displayBuf);
+  strcpy_P(extraBuf, xPRES);
+  formatDecimal(seaLevelPressure(pressure), &extraBuf[4], 6, 1 | FMT_SPACE);
+  postLine();
 }
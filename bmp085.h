@@ -6,4 +6,9 @@
 void setupBMP085();
 void checkBMP085();
 
+// Compensated temperature in 0.1 deg C, must be called before bmp085GetPressure
+short bmp085GetTemperature(uint16_t ut);
+// Compensated pressure in Pa
+int32_t bmp085GetPressure(uint32_t up);
+
 #endif /* BMP085_H_ */
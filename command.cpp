@@ -0,0 +1,84 @@
+
+#include <avr/pgmspace.h>
+
+#include "command.h"
+#include "history.h"
+#include "rxstats.h"
+#include "profile.h"
+#include "latency.h"
+#include "filter.h"
+#include "sensors.h"
+#include "schedule.h"
+#include "pipeline.h"
+#include "OsReceiver.h"
+#include "rawcap.h"
+#include "xprint.h"
+
+const char UNKNOWN_COMMAND[] PROGMEM = "{E:Unknown command}*\r\n";
+
+char commandBuf[COMMAND_LENGTH + 1];
+byte commandLen;
+
+static void executeCommand() {
+  switch (commandBuf[0]) {
+  case 'H':
+    dumpHistory();
+    break;
+  case 'S':
+    dumpRxStats();
+    break;
+  case 'L':
+    dumpLatency();
+    break;
+  case 'F':
+    filterCommand(commandBuf + 1);
+    break;
+  case 'T':
+    dumpSensors();
+    break;
+  case 'Q':
+    dumpQuality();
+    break;
+  case 'D':
+    dumpSchedule();
+    break;
+  case 'B':
+    dumpPipeline();
+    break;
+  case 'O':
+    passthroughCommand(commandBuf + 1);
+    break;
+#if OSRX_RECEIVERS > 1
+  case 'R':
+    dumpReceivers();
+    break;
+#endif
+#if ENABLE_RAW_CAPTURE
+  case 'C':
+    rawCommand(commandBuf + 1);
+    break;
+#endif
+#if ENABLE_PROFILE
+  case 'P':
+    dumpProfile();
+    break;
+#endif
+  default:
+    waitPrint();
+    print_P(UNKNOWN_COMMAND);
+  }
+}
+
+void checkCommand() {
+  while (Serial.available()) {
+    char ch = Serial.read();
+    if (ch == '\r' || ch == '\n') {
+      if (commandLen == 0)
+        continue; // empty line or second half of CR LF
+      commandBuf[commandLen] = 0;
+      executeCommand();
+      commandLen = 0;
+    } else if (commandLen < COMMAND_LENGTH)
+      commandBuf[commandLen++] = ch;
+  }
+}
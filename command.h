@@ -0,0 +1,34 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <Arduino.h>
+
+// Max length of a command line from the console
+#define COMMAND_LENGTH 16
+
+// Reads console input and executes a command on every complete line:
+//   H -- dump hourly history log as a binary frame
+//   S -- print receive pipeline statistics
+//   L -- print last and maximal latency from RF edge to serial and LCD by stage
+//   T -- print sensor table: sensors, evictions, rolling code re-bindings and for every sensor
+//        id/channel/rc, display code position, seconds since seen, messages, battery, last reading
+//   Q -- print reception quality: sensors and for every sensor id/channel/rc, estimated period in ms,
+//        expected and received messages, average loss and repair rates in 1/1000, jitter in ms
+//   D -- print deferred work: count, count of works that waited for too long, total delay in ms
+//   B -- print receive pipeline: framed and dropped messages, stalls of decode and emit stages,
+//        dropped local sensor lines and max length of frame, emit and render queues
+//   O -- print passthrough mode (see pipeline.h)
+//        O1, O0 -- start or stop writing validated messages as OS<version>:<hex> lines instead of
+//        decoding them
+//   R -- print receivers (when OSRX_RECEIVERS is 2): for every receiver valid messages that were
+//        new to it and messages that were delivered from it first
+//   F -- print sensor filter: mode, dropped messages and entries with their matches
+//        FA, FD, FO -- set allow, deny or off mode
+//        F+<id> [<channel> [<rc>]] -- add entry (hex values, '*' or omitted matches anything)
+//        F-<id> [<channel> [<rc>]] -- remove entry
+//   C -- print raw capture mode (when ENABLE_RAW_CAPTURE is set in rawcap.h): on/off and baud
+//        C1, C0 -- start or stop streaming of receiver edges at RAW_BAUD as binary frames
+//   P -- print profiling histograms (when ENABLE_PROFILE is set in profile.h)
+extern void checkCommand();
+
+#endif
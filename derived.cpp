@@ -0,0 +1,111 @@
+
+#include <avr/pgmspace.h>
+
+#include "derived.h"
+
+// Saturation vapour pressure over water by Magnus formula: 6.112 * exp(17.62 * T / (243.12 + T)) hPa
+// In units of 1/256 hPa for T = -40..+60 C with 1 C step, interpolated linearly in between.
+#define ES_MIN_TEMP (-400)
+#define ES_MAX_TEMP 600
+#define ES_STEP     10
+#define ES_SIZE     101
+
+const uint16_t ES_TABLE[ES_SIZE] PROGMEM = {
+     49,    54,    60,    66,    73,    81,    89,    98,   108,   119,
+    131,   144,   158,   173,   190,   208,   227,   248,   271,   296,
+    322,   351,   382,   416,   452,   491,   533,   578,   627,   679,
+    735,   795,   859,   928,  1002,  1081,  1165,  1256,  1352,  1455,
+   1565,  1682,  1807,  1940,  2081,  2232,  2392,  2562,  2743,  2935,
+   3139,  3355,  3584,  3827,  4084,  4356,  4644,  4949,  5271,  5612,
+   5971,  6351,  6752,  7174,  7620,  8090,  8585,  9106,  9654, 10231,
+  10838, 11477, 12147, 12852, 13592, 14369, 15184, 16039, 16936, 17876,
+  18861, 19892, 20973, 22103, 23286, 24524, 25818, 27171, 28585, 30061,
+  31604, 33214, 34894, 36647, 38475, 40382, 42369, 44440, 46597, 48844,
+  51183 
+};
+
+// Wind speed power V^0.16 (V in km/h) in units of 1/4096 for 0..50 m/s with 0.5 m/s step
+#define WP_STEP     5
+#define WP_SIZE     101
+
+const uint16_t WP_TABLE[WP_SIZE] PROGMEM = {
+      0,  4500,  5028,  5365,  5617,  5822,  5994,  6144,  6276,  6396,
+   6504,  6604,  6697,  6783,  6864,  6940,  7012,  7081,  7146,  7208,
+   7267,  7324,  7379,  7432,  7482,  7531,  7579,  7625,  7669,  7712,
+   7754,  7795,  7835,  7873,  7911,  7948,  7984,  8019,  8053,  8087,
+   8120,  8152,  8183,  8214,  8244,  8274,  8303,  8332,  8360,  8388,
+   8415,  8441,  8468,  8494,  8519,  8544,  8569,  8593,  8617,  8641,
+   8664,  8687,  8709,  8732,  8754,  8775,  8797,  8818,  8839,  8860,
+   8880,  8900,  8920,  8940,  8959,  8979,  8998,  9017,  9035,  9054,
+   9072,  9090,  9108,  9125,  9143,  9160,  9177,  9194,  9211,  9228,
+   9244,  9261,  9277,  9293,  9309,  9325,  9340,  9356,  9371,  9387,
+   9402
+};
+
+// Interpolates table that is indexed by x / step
+static uint16_t interpolate(const uint16_t* table, uint8_t size, int16_t x, uint8_t step) {
+  uint8_t i = x / step;
+  if (i >= size - 1)
+    return pgm_read_word(&table[size - 1]);
+  uint16_t a = pgm_read_word(&table[i]);
+  uint16_t b = pgm_read_word(&table[i + 1]);
+  return a + (uint16_t)(((uint32_t)(b - a) * (x - i * step) + step / 2) / step);
+}
+
+// Vapour pressure in 1/256 hPa
+static uint16_t vapourPressure(int16_t temp, uint8_t humidity) {
+  if (temp < ES_MIN_TEMP)
+    temp = ES_MIN_TEMP;
+  if (temp > ES_MAX_TEMP)
+    temp = ES_MAX_TEMP;
+  uint16_t es = interpolate(ES_TABLE, ES_SIZE, temp - ES_MIN_TEMP, ES_STEP);
+  return (uint16_t)(((uint32_t)es * humidity + 50) / 100);
+}
+
+int16_t dewPoint(int16_t temp, uint8_t humidity) {
+  uint16_t e = vapourPressure(temp, humidity);
+  if (e <= pgm_read_word(&ES_TABLE[0]))
+    return ES_MIN_TEMP;
+  // binary search for the last table entry that is below e
+  uint8_t lo = 0;
+  uint8_t hi = ES_SIZE - 1;
+  while (hi - lo > 1) {
+    uint8_t mid = (lo + hi) >> 1;
+    if (pgm_read_word(&ES_TABLE[mid]) < e)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  uint16_t a = pgm_read_word(&ES_TABLE[lo]);
+  uint16_t b = pgm_read_word(&ES_TABLE[hi]);
+  return ES_MIN_TEMP + lo * ES_STEP + (int16_t)(((uint32_t)(e - a) * ES_STEP + (b - a) / 2) / (b - a));
+}
+
+int16_t humidex(int16_t temp, uint8_t humidity) {
+  // H = T + 5/9 * (e - 10 hPa)
+  int32_t d = 50L * ((int32_t)vapourPressure(temp, humidity) - 2560);
+  return temp + (int16_t)((d + (d < 0 ? -1152 : 1152)) / 2304);
+}
+
+int16_t windChill(int16_t temp, int16_t speed) {
+  // W = 13.12 + 0.6215 T - 11.37 V^0.16 + 0.3965 T V^0.16
+  if (temp > 100 || speed < 14 || temp < ES_MIN_TEMP)
+    return temp;
+  int32_t p = interpolate(WP_TABLE, WP_SIZE, speed, WP_STEP);
+  int32_t a = (3965L * temp - 1137000L) / 100;
+  int32_t w = 53739520L + 254566L * temp + p * a;
+  return (int16_t)((w + (w < 0 ? -204800L : 204800L)) / 409600L);
+}
+
+// QNH = QFE / (1 - h / 44330) ^ 5.255, the factor is computed at compile time in 1/65536
+// with series expansion of ln and exp, which are precise to 1e-5 up to 3000 m.
+#define QNH_Y (STATION_ALTITUDE / 44330.0)
+#define QNH_X (5.255 * (QNH_Y + QNH_Y * QNH_Y / 2 + QNH_Y * QNH_Y * QNH_Y / 3 + QNH_Y * QNH_Y * QNH_Y * QNH_Y / 4))
+#define QNH_EXP (1 + QNH_X + QNH_X * QNH_X / 2 + QNH_X * QNH_X * QNH_X / 6 + QNH_X * QNH_X * QNH_X * QNH_X / 24 + \
+    QNH_X * QNH_X * QNH_X * QNH_X * QNH_X / 120)
+
+const int32_t QNH_FACTOR = (int32_t)(65536.0 * QNH_EXP + 0.5);
+
+int16_t seaLevelPressure(int16_t pressure) {
+  return (int16_t)(((int32_t)pressure * QNH_FACTOR + 32768L) >> 16);
+}
@@ -0,0 +1,31 @@
+#ifndef DERIVED_H
+#define DERIVED_H
+
+#include <Arduino.h>
+
+// Station altitude above sea level in meters, used for QNH reduction of BMP085 pressure
+#ifndef STATION_ALTITUDE
+#define STATION_ALTITUDE 0
+#endif
+
+// Channel of the temperature sensor that is used for wind chill
+#ifndef OUTDOOR_CHANNEL
+#define OUTDOOR_CHANNEL 1
+#endif
+
+// All temperatures are in 0.1 C, humidity in %, wind speed in 0.1 m/s, pressure in 0.1 hPa
+// (exactly as they come from the sensors), all results use the same units.
+
+// Dew point with Magnus formula for -40..+60 C. Error vs. double precision is within 0.12 C for
+// dew points above -30 C and within 0.25 C down to -40 C (where vapour pressure is tiny).
+// Errors of all functions are checked by test/derived_test.cpp.
+extern int16_t dewPoint(int16_t temp, uint8_t humidity);
+// Humidex (Environment Canada). Error vs. double precision is within 0.1 C.
+extern int16_t humidex(int16_t temp, uint8_t humidity);
+// Wind chill (JAG/TI 2001), returns temp when out of the formula range (T > 10 C or V < 4.8 km/h).
+// Error vs. double precision is within 0.1 C for wind speeds up to 50 m/s.
+extern int16_t windChill(int16_t temp, int16_t speed);
+// Sea level pressure (QNH) for STATION_ALTITUDE. Error vs. double precision is within 0.1 hPa.
+extern int16_t seaLevelPressure(int16_t pressure);
+
+#endif
@@ -5,67 +5,113 @@
 #include "fmt_util.h"
 #include "xprint.h"
 #include "Timeout.h"
+#include "sensors.h"
 
 LiquidCrystal lcd(7, 9, 2, 3, 5, 6);
 
 // current buffer string
 char displayBuf[DISPLAY_LENGTH+1];
+char extraBuf[EXTRA_LENGTH+1];
 
 const char SENSOR_CODES[] PROGMEM = " 123456789?CRUWH";
 
-#define TIMEOUT (10 * 60000L) // 10 min
 #define ANIMATION_LENGTH 2 
 #define ANIMATION_PERIOD 1000L
 
-struct Sensor {
-  boolean seen;
-  long lastTime;
-};
-
-Sensor sensor[MAX_SENSORS];
+Timeout staleCheck; // fires when the next sensor in the status line goes stale
+unsigned long staleTime; // millis when staleCheck fires
 Timeout animationPeriod(ANIMATION_PERIOD); 
 char animation[ANIMATION_LENGTH] = { ' ', '.' };
 byte animationPos;
 
+byte sensorIndex(char code) {
+  byte sid;
+  for (sid = 0; sid < MAX_SENSORS; sid++)
+    if (pgm_read_byte(&(SENSOR_CODES[sid])) == code)
+      break;
+  return sid;
+}
+
+char sStatus[MAX_SENSORS + 1];
+char sLine[DISPLAY_LENGTH + 1];
+
 void setupDisplay() {
+  memset(sStatus, ' ', MAX_SENSORS);
   lcd.begin(2, 16);
   lcd.print("WeatherCentral");
 }
 
-char sStatus[MAX_SENSORS + 1];
-
-void updateDisplay(char* s) {
-  // echo to console
-  waitPrint();
-  Serial.print('[');
-  Serial.print(s);
-  Serial.println(']');
-  // find sensor id
-  char scode = s[0];
-  byte sid;
-  for (sid = 0; sid < MAX_SENSORS; sid++)
-    if (pgm_read_byte(&(SENSOR_CODES[sid])) == scode)
-      break;
-  if (sid >= MAX_SENSORS)
+void scheduleStale(unsigned long interval) {
+  unsigned long time = millis() + interval;
+  if (staleCheck.enabled() && (long)(time - staleTime) >= 0)
     return;
-  // prepare strings for display
-  long time = millis();
-  sensor[sid].seen = true;
-  sensor[sid].lastTime = time;
-  // prepare status line
+  staleTime = time;
+  staleCheck.reset(interval);
+}
+
+// rebuilds status line from the sensors that are not stale and sets timer to the next one
+static void refreshStatus() {
+  unsigned long time = millis();
+  unsigned long next = 0xffffffffUL;
+  boolean any = false;
+  memset(&sStatus[1], ' ', MAX_SENSORS - 1);
+  for (byte i = 0; i < SENSOR_SLOTS; i++) {
+    SensorState& s = sensors[i];
+    unsigned long age = time - s.lastTime;
+    unsigned long timeout = sensorTimeout(s);
+    if (s.flags == 0 || s.code == 0 || s.code >= MAX_SENSORS || age >= timeout)
+      continue;
+    sStatus[s.code] = pgm_read_byte(&(SENSOR_CODES[s.code]));
+    any = true;
+    if (timeout - age < next)
+      next = timeout - age;
+  }
+  staleCheck.disable();
+  if (any)
+    scheduleStale(next);
+}
+
+void showDisplay() {
   sStatus[0] = animation[animationPos];
-  for (byte i = 1; i < MAX_SENSORS; i++)
-    sStatus[i] = sensor[i].seen && time - sensor[i].lastTime < TIMEOUT ? pgm_read_byte(&(SENSOR_CODES[i])) : ' ';
   // display  
   lcd.setCursor(0, 0);
-  lcd.print(s);
-  for (byte i = strlen(s); i < DISPLAY_LENGTH; i++)
+  lcd.print(sLine);
+  for (byte i = strlen(sLine); i < DISPLAY_LENGTH; i++)
     lcd.print(' ');
   lcd.setCursor(0, 1);
   lcd.print(sStatus);
 }
 
+void emitLine(const char* s, const char* extra) {
+  Serial.print('[');
+  Serial.print(s);
+  Serial.print(']');
+  if (extra[0] != 0) {
+    Serial.print(' ');
+    Serial.print(extra);
+  }
+  Serial.println();
+}
+
+boolean renderLine(const char* s) {
+  // find sensor id
+  byte sid = sensorIndex(s[0]);
+  if (sid >= MAX_SENSORS)
+    return false;
+  // prepare strings for display, parsePacket has scheduled when this code goes stale
+  if (sid != 0)
+    sStatus[sid] = s[0];
+  strncpy(sLine, s, DISPLAY_LENGTH);
+  showDisplay();
+  return true;
+}
+
 void checkDisplay() {
+  if (staleCheck.check()) {
+    refreshStatus();
+    lcd.setCursor(1, 1);
+    lcd.print(&sStatus[1]);
+  }
   if (!animationPeriod.check())
     return;
   animationPeriod.reset(ANIMATION_PERIOD);
@@ -77,3 +123,26 @@ void checkDisplay() {
   lcd.print(animation[animationPos]);
 
 }
+
+void saveDisplay(DisplayState& ds) {
+  unsigned long time = millis();
+  memset(ds.age, 0xff, MAX_SENSORS);
+  for (byte i = 0; i < SENSOR_SLOTS; i++) {
+    SensorState& s = sensors[i];
+    unsigned long age = (time - s.lastTime) / 60000L;
+    if (s.flags != 0 && s.code < MAX_SENSORS && age < ds.age[s.code])
+      ds.age[s.code] = age;
+  }
+  memcpy(ds.line, sLine, DISPLAY_LENGTH);
+}
+
+void restoreDisplay(const DisplayState& ds) {
+  unsigned long time = millis();
+  // sensor ids are not kept, so codes are restored as sensors without id
+  for (byte i = 0; i < MAX_SENSORS; i++)
+    if (ds.age[i] != 0xff)
+      restoreSensor(i, time - ds.age[i] * 60000L);
+  memcpy(sLine, ds.line, DISPLAY_LENGTH);
+  refreshStatus();
+  showDisplay();
+}
@@ -4,14 +4,34 @@
 #include <Arduino.h>
 
 #define DISPLAY_LENGTH 16
+#define EXTRA_LENGTH 40 // the longest is xWIND in parse.cpp
 #define MAX_SENSORS 16
 
 // current buffer string
 extern char displayBuf[DISPLAY_LENGTH+1];
+// extra console-only fields for the current buffer string (empty when none)
+extern char extraBuf[EXTRA_LENGTH+1];
+
+// display state that is kept in the warm start snapshot
+struct DisplayState {
+  byte age[MAX_SENSORS];     // minutes since the sensor was last seen, 0xff when never
+  char line[DISPLAY_LENGTH]; // last displayed line
+};
+
+// Returns position of sensor display code in SENSOR_CODES or MAX_SENSORS when not found
+extern byte sensorIndex(char code);
 
 extern void setupDisplay();
-extern void updateDisplay(char* s);
+// Writes the console line of the data: [s] extra
+extern void emitLine(const char* s, const char* extra);
+// Shows the line on the LCD, returns false when it is not a sensor line that is shown
+extern boolean renderLine(const char* s);
+// Makes sure that sensors in the status line are checked for staleness in no more than interval ms
+extern void scheduleStale(unsigned long interval);
 extern void checkDisplay();
 
+extern void saveDisplay(DisplayState& ds);
+extern void restoreDisplay(const DisplayState& ds);
+
 #endif
 
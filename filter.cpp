@@ -0,0 +1,198 @@
+#include <avr/eeprom.h>
+
+#include "filter.h"
+#include "rxstats.h"
+#include "xprint.h"
+
+struct Filter {
+  byte mode;
+  byte reserved;
+  FilterEntry entry[FILTER_ENTRIES];
+};
+
+static_assert(FILTER_ADDR + sizeof(Filter) <= E2END + 1, "Filter does not fit into EEPROM");
+static_assert(HISTORY_ADDR + HISTORY_BYTES <= FILTER_ADDR, "History log overlaps the filter");
+
+Filter filter;
+uint16_t filterHits[FILTER_ENTRIES]; // matched messages by entry since start
+
+const char BAD_FILTER[] PROGMEM = "{E:Bad filter}*\r\n";
+const char FILTER_FULL[] PROGMEM = "{E:Filter full}*\r\n";
+
+void setupFilter() {
+  eeprom_read_block(&filter, (const void*)FILTER_ADDR, sizeof(filter));
+  if (filter.mode != FILTER_ALLOW && filter.mode != FILTER_DENY && filter.mode != FILTER_OFF) {
+    filter.mode = FILTER_OFF;
+    for (byte i = 0; i < FILTER_ENTRIES; i++)
+      filter.entry[i].any = 0xff;
+  }
+}
+
+boolean filterPass(const byte* packet) {
+  if (filter.mode == FILTER_OFF)
+    return true;
+  uint16_t id = (packet[1] << 12) | (packet[2] << 8) | (packet[3] << 4) | packet[4];
+  byte i;
+  for (i = 0; i < FILTER_ENTRIES; i++) {
+    FilterEntry& e = filter.entry[i];
+    if (e.id == id && e.any != 0xff &&
+        ((e.any & FILTER_ANY_CHANNEL) || e.channel == packet[5]) &&
+        ((e.any & FILTER_ANY_RC) || e.rc == ((packet[6] << 4) | packet[7])))
+      break;
+  }
+  boolean listed = i < FILTER_ENTRIES;
+  if (listed)
+    RX_STAT_INC(filterHits[i]);
+  if (listed == (filter.mode == FILTER_ALLOW))
+    return true;
+  RX_STAT_INC(rxStats.filtered);
+  return false;
+}
+
+static void saveFilter() {
+  eeprom_update_block(&filter, (void*)FILTER_ADDR, sizeof(filter));
+}
+
+static void printFilter() {
+  waitPrint();
+  print_C("{F:");
+  Serial.print((char)filter.mode);
+  Serial.print(' ');
+  Serial.print(rxStats.filtered);
+  for (byte i = 0; i < FILTER_ENTRIES; i++) {
+    FilterEntry& e = filter.entry[i];
+    if (e.any == 0xff)
+      continue;
+    Serial.print('|');
+    printHex(e.id, 4);
+    Serial.print('/');
+    if (e.any & FILTER_ANY_CHANNEL)
+      Serial.print('*');
+    else
+      printHex(e.channel, 1);
+    Serial.print('/');
+    if (e.any & FILTER_ANY_RC)
+      Serial.print('*');
+    else
+      printHex(e.rc, 2);
+    Serial.print(' ');
+    Serial.print(filterHits[i]);
+  }
+  print_C("}*\r\n");
+}
+
+// Parses up to 4 hex digits, returns their number (0 on '*' or at the end of the line)
+static byte parseHex(const char*& p, uint16_t& value) {
+  while (*p == ' ')
+    p++;
+  if (*p == '*') {
+    p++;
+    return 0;
+  }
+  byte n = 0;
+  value = 0;
+  for (; n < 4; n++, p++) {
+    char ch = *p;
+    byte d;
+    if (ch >= '0' && ch <= '9')
+      d = ch - '0';
+    else if (ch >= 'A' && ch <= 'F')
+      d = ch - 'A' + 10;
+    else if (ch >= 'a' && ch <= 'f')
+      d = ch - 'a' + 10;
+    else
+      break;
+    value = (value << 4) | d;
+  }
+  return n;
+}
+
+// Parses "<id> [<channel> [<rc>]]" where omitted or '*' fields match anything
+static boolean parseEntry(const char* p, FilterEntry& e) {
+  uint16_t v;
+  if (parseHex(p, v) != 4)
+    return false;
+  e.id = v;
+  e.any = 0;
+  e.channel = e.rc = 0;
+  byte n = parseHex(p, v);
+  if (n == 0)
+    e.any |= FILTER_ANY_CHANNEL;
+  else if (n == 1)
+    e.channel = v;
+  else
+    return false;
+  n = parseHex(p, v);
+  if (n == 0)
+    e.any |= FILTER_ANY_RC;
+  else if (n == 2)
+    e.rc = v;
+  else
+    return false;
+  return *p == 0;
+}
+
+static byte findEntry(const FilterEntry& e) {
+  byte i;
+  for (i = 0; i < FILTER_ENTRIES; i++) {
+    FilterEntry& f = filter.entry[i];
+    if (f.any == e.any && f.id == e.id && f.channel == e.channel && f.rc == e.rc)
+      break;
+  }
+  return i;
+}
+
+static byte freeEntry() {
+  byte i = 0;
+  while (i < FILTER_ENTRIES && filter.entry[i].any != 0xff)
+    i++;
+  return i;
+}
+
+void filterCommand(const char* args) {
+  FilterEntry e;
+  byte i;
+  PGM_P error = 0;
+  switch (args[0]) {
+  case 0:
+    break;
+  case FILTER_ALLOW:
+  case FILTER_DENY:
+  case FILTER_OFF:
+    if (args[1] != 0) {
+      error = BAD_FILTER;
+      break;
+    }
+    filter.mode = args[0];
+    saveFilter();
+    break;
+  case '+':
+    if (!parseEntry(args + 1, e))
+      error = BAD_FILTER;
+    else if (findEntry(e) < FILTER_ENTRIES)
+      break;
+    else if ((i = freeEntry()) == FILTER_ENTRIES)
+      error = FILTER_FULL;
+    else {
+      filter.entry[i] = e;
+      filterHits[i] = 0;
+      saveFilter();
+    }
+    break;
+  case '-':
+    if (!parseEntry(args + 1, e) || (i = findEntry(e)) == FILTER_ENTRIES)
+      error = BAD_FILTER;
+    else {
+      filter.entry[i].any = 0xff;
+      saveFilter();
+    }
+    break;
+  default:
+    error = BAD_FILTER;
+  }
+  if (error) {
+    waitPrint();
+    print_P(error);
+  } else
+    printFilter();
+}
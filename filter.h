@@ -0,0 +1,36 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <Arduino.h>
+
+#include "history.h"
+
+// Allow/deny list of sensors is kept in the last 32 bytes of EEPROM, the history log ends
+// exactly there, so its records never overwrite the filter. The first byte is the mode,
+// anything else there (erased EEPROM) means that the filter is off.
+#define FILTER_ADDR    (E2END + 1 - 32)
+#define FILTER_ENTRIES 6
+
+#define FILTER_OFF   'O'
+#define FILTER_ALLOW 'A' // only listed sensors pass
+#define FILTER_DENY  'D' // listed sensors are dropped
+
+// Flags of the entry fields that match anything
+#define FILTER_ANY_CHANNEL 1
+#define FILTER_ANY_RC      2
+
+typedef struct {
+  uint16_t id;
+  byte channel; // nibble after the id as it is in the message
+  byte rc;      // rolling code
+  byte any;     // FILTER_ANY_XXX flags, 0xff for an unused entry
+} __attribute__((packed)) FilterEntry; // 5 bytes on the host as well
+
+extern void setupFilter();
+// Checks the message nibbles (starting from the sync nibble) against the filter,
+// counts dropped messages and returns false when the message shall be dropped
+extern boolean filterPass(const byte* packet);
+// Executes the "F" console command, see command.h
+extern void filterCommand(const char* args);
+
+#endif
@@ -0,0 +1,61 @@
+// Bit streams of the store, most significant bit first
+#ifndef BITS_H
+#define BITS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t>& out) : out(out), bits(0) {}
+
+  // Appends the low n bits of v, n <= 64
+  void put(uint64_t v, int n) {
+    while (n > 0) {
+      if ((bits & 7) == 0)
+        out.push_back(0);
+      int room = 8 - (bits & 7);
+      int k = n < room ? n : room;
+      uint8_t chunk = (uint8_t)((v >> (n - k)) & ((1u << k) - 1));
+      out.back() |= chunk << (room - k);
+      bits += k;
+      n -= k;
+    }
+  }
+
+  size_t size() const { return bits; }
+
+private:
+  std::vector<uint8_t>& out;
+  size_t bits;
+};
+
+class BitReader {
+public:
+  BitReader(const uint8_t* data, size_t bits, size_t pos) : data(data), bits(bits), pos(pos) {}
+
+  // Reads n bits, zeros past the end
+  uint64_t get(int n) {
+    uint64_t v = 0;
+    while (n > 0) {
+      if (pos >= bits)
+        return v << n;
+      int room = 8 - (pos & 7);
+      int k = n < room ? n : room;
+      uint8_t b = data[pos >> 3];
+      v = (v << k) | ((b >> (room - k)) & ((1u << k) - 1));
+      pos += k;
+      n -= k;
+    }
+    return v;
+  }
+
+private:
+  const uint8_t* data;
+  size_t bits;
+  size_t pos;
+};
+
+#endif
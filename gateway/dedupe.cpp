@@ -0,0 +1,45 @@
+#include "dedupe.h"
+
+#define DEDUPE_MASK (DEDUPE_SLOTS - 1)
+
+// FNV-1a, zero marks an empty slot
+static uint64_t hashKey(const uint8_t* key, size_t len) {
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= key[i];
+    h *= 1099511628211ULL;
+  }
+  return h != 0 ? h : 1;
+}
+
+Dedupe::Dedupe(uint32_t window) :
+  evictions(0), window(window), table(DEDUPE_SLOTS)
+{}
+
+bool Dedupe::check(const uint8_t* key, size_t len, int station, uint64_t now) {
+  uint64_t h = hashKey(key, len);
+  Entry* free = 0;
+  Entry* oldest = 0;
+  for (int i = 0; i < DEDUPE_PROBES; i++) {
+    Entry& e = table[(h + i) & DEDUPE_MASK];
+    bool live = e.hash != 0 && now - e.time < window;
+    if (live && e.hash == h) {
+      if (e.station != station)
+        return false;
+      e.time = now;
+      return true;
+    }
+    if (!live && !free)
+      free = &e;
+    if (!oldest || e.time < oldest->time)
+      oldest = &e;
+  }
+  if (!free) {
+    free = oldest;
+    evictions++;
+  }
+  free->hash = h;
+  free->time = now;
+  free->station = station;
+  return true;
+}
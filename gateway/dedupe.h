@@ -0,0 +1,33 @@
+// Readings that several stations heard from the same sensor transmission
+#ifndef DEDUPE_H
+#define DEDUPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#define DEDUPE_SLOTS  16384 // power of two, enough for hundreds of stations at the default window
+#define DEDUPE_PROBES 16
+
+// A reading is a duplicate when another station published the same key less than window
+// msec ago. The same station repeating it is a new reading (sensors with the same values).
+class Dedupe {
+public:
+  explicit Dedupe(uint32_t window);
+  // Returns true when the reading is new and remembers it for the station
+  bool check(const uint8_t* key, size_t len, int station, uint64_t now);
+
+  uint64_t evictions; // live keys overwritten because their probe range was full
+
+private:
+  struct Entry {
+    uint64_t hash;
+    uint64_t time;
+    int station;
+  };
+  uint32_t window;
+  std::vector<Entry> table;
+};
+
+#endif
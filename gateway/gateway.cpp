@@ -0,0 +1,322 @@
+// Aggregation gateway of several WeatherCentral boards. Reads the console streams of all
+// boards with one epoll loop and writes their readings as one stream to stdout:
+//   <unix time> <station> [<display line>] <extra>
+// Messages of boards in the passthrough mode are decoded here (see packet.h) into the same
+// display line, the passthrough line is its extra. Boards that hear the same sensor transmission
+// print the same display line, only the first copy is written. Port metrics go to stderr on SIGUSR1, every -m sec and on exit.
+// With -s the values of published readings are also appended to a store (see store.h)
+// and added to its minute, hour and day aggregates (see rollup.h).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include <vector>
+
+#include "station.h"
+#include "dedupe.h"
+#include "packet.h"
+#include "store.h"
+#include "rollup.h"
+
+#define DEFAULT_WINDOW 5000 // msec, boards print a reading within a few ms of each other
+#define RETRY_MS       2000 // closed ports are reopened this often
+#define MAX_EVENTS     256
+#define LOCAL_CODES    "P"  // display codes of board-local sensors (BMP085), never duplicates
+#define DEFAULT_FLUSH  3600 // sec, pending samples of the store are written at least this often,
+                            // lost on a crash, shorter periods make small blocks that compress worse
+
+static void usage() {
+  fprintf(stderr,
+    "Usage: gateway [options] [name=]port ...\n"
+    "Merges readings from the consoles of several boards into one stream on stdout.\n"
+    "Ports are serial ports, ptys (see ptystation) or fifos, the name defaults to the file name.\n"
+    "  -b <baud>      serial baud (default 57600)\n"
+    "  -w <msec>      window in which the same reading from another station is a duplicate\n"
+    "                 (default %d)\n"
+    "  -l <codes>     display codes of board-local readings that are never duplicates\n"
+    "                 (default %s)\n"
+    "  -r             also write {..}* records of all stations\n"
+    "  -s <dir>       append values of published readings to a store in dir and keep\n"
+    "                 their aggregates\n"
+    "  -F <sec>       write pending samples of the store at least every sec (default %d)\n"
+    "  -m <sec>       print port metrics every sec\n"
+    "  -t <sec>       run time (default: until interrupted)\n",
+    DEFAULT_WINDOW, LOCAL_CODES, DEFAULT_FLUSH);
+}
+
+struct Gateway {
+  std::vector<Station*> stations;
+  Dedupe* dedupe;
+  Store* store;     // null without -s
+  Rollups* rollups;
+  const char* localCodes;
+  bool records;
+  uint64_t now;     // monotonic msec of the current loop iteration
+  int64_t wallNow;  // unix msec of the current loop iteration
+  char stamp[32];   // wall clock of the current loop iteration
+};
+
+static volatile bool stop;
+static volatile bool metricsRequested;
+
+static uint64_t monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void updateClock(Gateway& g) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  snprintf(g.stamp, sizeof(g.stamp), "%ld.%03ld", (long)ts.tv_sec, ts.tv_nsec / 1000000);
+  g.now = monotonicMs();
+  g.wallNow = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void publish(Gateway& g, Station& s, const uint8_t* data, size_t len) {
+  fputs(g.stamp, stdout);
+  putchar(' ');
+  fputs(s.name.c_str(), stdout);
+  putchar(' ');
+  fwrite(data, 1, len, stdout);
+  putchar('\n');
+}
+
+static void onReading(Gateway& g, Station& s, const uint8_t* data, size_t len) {
+  const uint8_t* end = (const uint8_t*)memchr(data, ']', len);
+  size_t keyLen = end ? end - data + 1 : len;
+  bool local = len > 1 && strchr(g.localCodes, data[1]) != 0;
+  if (!local && !g.dedupe->check(data, keyLen, s.index, g.now)) {
+    s.stats.duplicates++;
+    return;
+  }
+  s.stats.published++;
+  publish(g, s, data, len);
+  Reading r;
+  if (!g.store || !parseReading(data, len, r))
+    return;
+  Sample sample;
+  sample.time = g.wallNow;
+  memcpy(sample.value, r.value, sizeof(int32_t) * r.count);
+  if (g.rollups->add(s.name, r.code, r.count, sample))
+    g.store->append(s.name, r, sample.time);
+}
+
+// makes "[<display line>] <passthrough line>" of a valid message
+static void onPacket(Gateway& g, Station& s, const uint8_t* data, size_t len) {
+  Packet p;
+  if (!parsePacket(data, len, p)) {
+    s.stats.badPackets++;
+    return;
+  }
+  uint8_t line[PACKET_DISPLAY + 3 + STATION_BUFFER];
+  line[0] = '[';
+  decodePacket(p, (char*)line + 1);
+  line[PACKET_DISPLAY + 1] = ']';
+  line[PACKET_DISPLAY + 2] = ' ';
+  memcpy(line + PACKET_DISPLAY + 3, data, len);
+  onReading(g, s, line, PACKET_DISPLAY + 3 + len);
+}
+
+static void onItem(Station& s, ItemKind kind, const uint8_t* data, size_t len, void* ctx) {
+  Gateway& g = *(Gateway*)ctx;
+  s.stats.items[kind]++;
+  if (kind == ITEM_RECORD && g.records)
+    publish(g, s, data, len);
+  else if (kind == ITEM_READING)
+    onReading(g, s, data, len);
+  else if (kind == ITEM_PACKET)
+    onPacket(g, s, data, len);
+}
+
+static void printMetrics(Gateway& g, Dedupe& dedupe) {
+  uint64_t published = 0, duplicates = 0;
+  int up = 0;
+  for (Station* p : g.stations) {
+    Station& s = *p;
+    StationStats& st = s.stats;
+    fprintf(stderr, "gateway: %s %s, %llu bytes, %llu reads, %llu readings, %llu packets, "
+      "%llu bad packets, %llu published, "
+      "%llu duplicates, %llu records, %llu other, %llu frames, %llu bad frames, %llu overruns, "
+      "backlog %d max %d, %llu opens\n",
+      s.name.c_str(), s.fd >= 0 ? "up" : "down",
+      (unsigned long long)st.bytes, (unsigned long long)st.reads,
+      (unsigned long long)st.items[ITEM_READING], (unsigned long long)st.items[ITEM_PACKET],
+      (unsigned long long)st.badPackets, (unsigned long long)st.published,
+      (unsigned long long)st.duplicates, (unsigned long long)st.items[ITEM_RECORD],
+      (unsigned long long)st.items[ITEM_OTHER], (unsigned long long)st.items[ITEM_FRAME],
+      (unsigned long long)st.items[ITEM_BAD_FRAME], (unsigned long long)st.overruns,
+      st.backlog, st.maxBacklog, (unsigned long long)st.opens);
+    published += st.published;
+    duplicates += st.duplicates;
+    if (s.fd >= 0)
+      up++;
+  }
+  fprintf(stderr, "gateway: %d ports, %d up, %llu published, %llu duplicates, %llu evictions\n",
+    (int)g.stations.size(), up, (unsigned long long)published, (unsigned long long)duplicates,
+    (unsigned long long)dedupe.evictions);
+  if (g.store)
+    fprintf(stderr, "gateway: store %llu samples, %llu blocks, %llu bytes, %llu errors\n",
+      (unsigned long long)g.store->samples, (unsigned long long)g.store->blocks,
+      (unsigned long long)g.store->bytes,
+      (unsigned long long)(g.store->errors + g.rollups->errors));
+}
+
+static speed_t baudConstant(long baud) {
+  switch (baud) {
+  case 9600: return B9600;
+  case 19200: return B19200;
+  case 38400: return B38400;
+  case 57600: return B57600;
+  case 115200: return B115200;
+  case 230400: return B230400;
+  case 500000: return B500000;
+  default: return 0;
+  }
+}
+
+static void onSignal(int) {
+  stop = true;
+}
+
+static void onMetricsSignal(int) {
+  metricsRequested = true;
+}
+
+int main(int argc, char* argv[]) {
+  Gateway g;
+  g.localCodes = LOCAL_CODES;
+  g.records = false;
+  g.store = 0;
+  g.rollups = 0;
+  const char* storeDir = 0;
+  double flushPeriod = DEFAULT_FLUSH;
+  long baud = 57600;
+  long window = DEFAULT_WINDOW;
+  double metricsPeriod = -1;
+  double limit = -1;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (arg[0] != '-') {
+      Station* s = new Station();
+      const char* eq = strchr(arg, '=');
+      s->path = eq ? eq + 1 : arg;
+      const char* base = strrchr(s->path.c_str(), '/');
+      s->name = eq ? std::string(arg, eq - arg) : base ? base + 1 : s->path;
+      s->index = (int)g.stations.size();
+      s->fd = -1;
+      g.stations.push_back(s);
+      continue;
+    }
+    if (arg[1] == 'r' && arg[2] == 0) {
+      g.records = true;
+      continue;
+    }
+    const char* val = i + 1 < argc ? argv[i + 1] : 0;
+    if (!val || arg[1] == 0 || arg[2] != 0) {
+      usage();
+      return 1;
+    }
+    switch (arg[1]) {
+    case 'b': baud = atol(val); break;
+    case 'w': window = atol(val); break;
+    case 'l': g.localCodes = val; break;
+    case 's': storeDir = val; break;
+    case 'F': flushPeriod = atof(val); break;
+    case 'm': metricsPeriod = atof(val); break;
+    case 't': limit = atof(val); break;
+    default:
+      usage();
+      return 1;
+    }
+    i++;
+  }
+  speed_t speed = baudConstant(baud);
+  if (g.stations.empty() || speed == 0 || window <= 0) {
+    usage();
+    return 1;
+  }
+  Dedupe dedupe(window);
+  g.dedupe = &dedupe;
+  if (storeDir) {
+    g.store = new Store(storeDir, (int64_t)(flushPeriod * 1000));
+    g.rollups = new Rollups(storeDir);
+  }
+  int epfd = epoll_create1(0);
+  if (epfd < 0) {
+    perror("gateway: epoll_create1");
+    return 1;
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGUSR1, onMetricsSignal);
+  static char outBuf[1 << 16];
+  setvbuf(stdout, outBuf, _IOFBF, sizeof(outBuf));
+  uint64_t start = monotonicMs();
+  uint64_t nextMetrics = metricsPeriod > 0 ? start + (uint64_t)(metricsPeriod * 1000) : UINT64_MAX;
+  uint64_t end = limit >= 0 ? start + (uint64_t)(limit * 1000) : UINT64_MAX;
+  uint64_t nextFlush = start + 1000;
+  struct epoll_event events[MAX_EVENTS];
+  while (!stop) {
+    updateClock(g);
+    if (g.now >= end)
+      break;
+    for (Station* p : g.stations) {
+      Station& s = *p;
+      if (s.fd >= 0 || g.now < s.retryAt)
+        continue;
+      if (!openStation(s, speed)) {
+        if (s.retryAt == 0)
+          fprintf(stderr, "gateway: cannot open %s, retrying\n", s.path.c_str());
+        s.retryAt = g.now + RETRY_MS;
+        continue;
+      }
+      struct epoll_event ev;
+      ev.events = EPOLLIN;
+      ev.data.ptr = &s;
+      if (epoll_ctl(epfd, EPOLL_CTL_ADD, s.fd, &ev) != 0) {
+        fprintf(stderr, "gateway: cannot poll %s\n", s.path.c_str());
+        closeStation(s);
+        s.retryAt = g.now + RETRY_MS;
+      }
+    }
+    if (g.store && g.now >= nextFlush) {
+      g.store->flushOld(g.wallNow);
+      nextFlush = g.now + 1000;
+    }
+    if (metricsRequested || g.now >= nextMetrics) {
+      fflush(stdout);
+      printMetrics(g, dedupe);
+      metricsRequested = false;
+      if (g.now >= nextMetrics)
+        nextMetrics += (uint64_t)(metricsPeriod * 1000);
+    }
+    int n = epoll_wait(epfd, events, MAX_EVENTS, 100);
+    if (n < 0)
+      continue; // EINTR on signals
+    updateClock(g);
+    // level triggered: one read per ready port per iteration, so busy ports do not starve others
+    for (int i = 0; i < n; i++) {
+      Station& s = *(Station*)events[i].data.ptr;
+      if (readStation(s, onItem, &g))
+        continue;
+      // EOF or EIO: board unplugged or pty closed, closing removes it from epoll
+      fprintf(stderr, "gateway: %s closed, retrying\n", s.path.c_str());
+      closeStation(s);
+      s.retryAt = g.now + RETRY_MS;
+    }
+    fflush(stdout);
+  }
+  fflush(stdout);
+  if (g.store)
+    g.store->flushAll();
+  printMetrics(g, dedupe);
+  delete g.store;
+  delete g.rollups;
+  return 0;
+}
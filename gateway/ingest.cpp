@@ -0,0 +1,304 @@
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "ingest.h"
+
+#define DISPLAY_LENGTH 16
+#define MAX_DIGITS     8
+#define RECORD_BYTES   40 // shortest lines of the gateway, to size the output
+
+// Fixed layout of a display line: template characters and the digit positions of every
+// value with their decimal weights, see parse.cpp and bmp085.cpp
+struct Field {
+  uint16_t mask;     // positions that hold digits, spaces or the sign
+  uint16_t signMask; // positions where formatDecimal can put the sign
+  uint8_t n;
+  uint8_t pos[MAX_DIGITS];
+  int32_t weight[MAX_DIGITS];
+};
+
+struct Layout {
+  char fixed[DISPLAY_LENGTH + 1]; // characters that must match, '~' for any
+  int count;
+  Field field[READING_VALUES];
+};
+
+#define BIT(p) (1 << (p))
+
+//                          0123456789012345
+static const Layout TEMP = { "~:~~~~.~~~~%~~~~", 2, {
+  // #: +??.? ??%   !
+  { 0x00b8, BIT(3) | BIT(4), 4, { 3, 4, 5, 7 }, { 1000, 100, 10, 1 } },
+  { 0x0600, 0, 2, { 9, 10 }, { 10, 1 } } } };
+static const Layout RAIN = { "R:~~~~~~~~~~.~~~", 2, {
+  // R: ------ --.--!
+  { 0x01f8, 0, 6, { 3, 4, 5, 6, 7, 8 }, { 100000, 10000, 1000, 100, 10, 1 } },
+  { 0x6c00, 0, 4, { 10, 11, 13, 14 }, { 1000, 100, 10, 1 } } } };
+static const Layout UVLT = { "U:~~~~~~~~~~~~~~", 1, {
+  // U: --          !
+  { 0x0018, 0, 2, { 3, 4 }, { 10, 1 } } } };
+static const Layout WIND = { "W:~~~~~~~~~d~~~~", 3, {
+  // W: --- --- d-- !
+  { 0x0038, 0, 3, { 3, 4, 5 }, { 100, 10, 1 } },
+  { 0x0380, 0, 3, { 7, 8, 9 }, { 100, 10, 1 } },
+  { 0x3000, 0, 2, { 12, 13 }, { 10, 1 } } } };
+static const Layout PRES = { "P:~~~~.~~~~~~.~~", 2, {
+  // P: -??.? ????.?
+  { 0x00b8, BIT(3) | BIT(4), 4, { 3, 4, 5, 7 }, { 1000, 100, 10, 1 } },
+  { 0x5e00, 0, 5, { 9, 10, 11, 12, 14 }, { 10000, 1000, 100, 10, 1 } } } };
+
+static const Layout* layoutOf(uint8_t code) {
+  if (code >= '1' && code <= '9')
+    return &TEMP;
+  switch (code) {
+  case 'R': return &RAIN;
+  case 'U': return &UVLT;
+  case 'W': return &WIND;
+  case 'P': return &PRES;
+  default: return 0;
+  }
+}
+
+// Per-position masks of the display: digits, spaces, signs and template matches
+struct Classes {
+  uint32_t digits;
+  uint32_t spaces;
+  uint32_t minus;
+  uint32_t plus;
+  uint32_t fixed;
+  uint8_t d[DISPLAY_LENGTH]; // character minus '0'
+};
+
+static void classify(const uint8_t* p, const Layout& l, Classes& c) {
+#ifdef __SSE2__
+  __m128i v = _mm_loadu_si128((const __m128i*)p);
+  __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+  // 0..9 as unsigned bytes
+  c.digits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d));
+  c.spaces = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+  c.minus = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+  c.plus = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')));
+  __m128i t = _mm_loadu_si128((const __m128i*)l.fixed);
+  __m128i any = _mm_cmpeq_epi8(t, _mm_set1_epi8('~'));
+  c.fixed = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, t), any));
+  _mm_storeu_si128((__m128i*)c.d, d);
+#else
+  c.digits = c.spaces = c.minus = c.plus = c.fixed = 0;
+  for (int i = 0; i < DISPLAY_LENGTH; i++) {
+    c.d[i] = (uint8_t)(p[i] - '0');
+    c.digits |= (c.d[i] <= 9) << i;
+    c.spaces |= (p[i] == ' ') << i;
+    c.minus |= (p[i] == '-') << i;
+    c.plus |= (p[i] == '+') << i;
+    c.fixed |= (p[i] == l.fixed[i] || l.fixed[i] == '~') << i;
+  }
+#endif
+}
+
+bool decodeDisplay(const uint8_t* display, Reading& r) {
+  const Layout* l = layoutOf(display[0]);
+  if (!l)
+    return false;
+  Classes c;
+  classify(display, *l, c);
+  uint32_t bad = c.fixed ^ 0xffff;
+  r.code = display[0];
+  r.count = l->count;
+  for (int i = 0; i < l->count; i++) {
+    const Field& f = l->field[i];
+    // every position is a digit, a space or an allowed sign and some digit is there
+    bad |= f.mask & ~(c.digits | c.spaces | ((c.minus | c.plus) & f.signMask));
+    bad |= (c.digits & f.mask) == 0;
+    int32_t v = 0;
+    for (int k = 0; k < f.n; k++) {
+      int32_t digit = -(int32_t)((c.digits >> f.pos[k]) & 1) & c.d[f.pos[k]];
+      v += digit * f.weight[k];
+    }
+    int32_t neg = -(int32_t)((c.minus & f.signMask) != 0);
+    r.value[i] = (v ^ neg) - neg;
+  }
+  return bad == 0;
+}
+
+// Bit masks of '\n' and '[' in 64 bytes
+static inline void scan64(const uint8_t* p, uint64_t& nl, uint64_t& br) {
+#ifdef __SSE2__
+  nl = br = 0;
+  for (int i = 0; i < 4; i++) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+    nl |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))) << (16 * i);
+    br |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('['))) << (16 * i);
+  }
+#else
+  nl = br = 0;
+  for (int i = 0; i < 64; i++) {
+    nl |= (uint64_t)(p[i] == '\n') << i;
+    br |= (uint64_t)(p[i] == '[') << i;
+  }
+#endif
+}
+
+struct ChunkParser {
+  const std::string* defaultStation;
+  int partitions;
+  IngestStats stats;
+
+  // <unix time> [<station>] [..] extra
+  void line(const uint8_t* start, const uint8_t* end, const uint8_t* bracket,
+      std::vector<IngestRecord>* out)
+  {
+    stats.lines++;
+    IngestRecord rec;
+    const uint8_t* p = start;
+    int64_t sec = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+      sec = sec * 10 + (*p++ - '0');
+    int64_t ms = 0;
+    int frac = 0;
+    if (p < end && *p == '.') {
+      p++;
+      while (p < end && *p >= '0' && *p <= '9') {
+        if (frac++ < 3)
+          ms = ms * 10 + (*p - '0');
+        p++;
+      }
+    }
+    for (; frac < 3; frac++)
+      ms *= 10;
+    if (!bracket || p == start || p >= bracket || *p != ' ' || end - bracket < DISPLAY_LENGTH + 2 ||
+        bracket[DISPLAY_LENGTH + 1] != ']' || !decodeDisplay(bracket + 1, rec.reading)) {
+      stats.skipped++;
+      return;
+    }
+    p++;
+    if (p < bracket) {
+      rec.station = (const char*)p;
+      rec.stationLen = bracket - 1 - p;
+    } else {
+      rec.station = defaultStation->data();
+      rec.stationLen = defaultStation->size();
+    }
+    rec.time = sec * 1000 + ms;
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < rec.stationLen; i++)
+      h = (h ^ (uint8_t)rec.station[i]) * 16777619u;
+    h = (h ^ (uint8_t)rec.reading.code) * 16777619u;
+    out[h % partitions].push_back(rec);
+    stats.records++;
+  }
+
+  // Lines that start in [from, to), the last one may end past to
+  void chunk(const uint8_t* data, size_t size, size_t from, size_t to, std::vector<IngestRecord>* out) {
+    size_t pos = from;
+    if (from > 0 && data[from - 1] != '\n') {
+      const uint8_t* nl = (const uint8_t*)memchr(data + from, '\n', size - from);
+      if (!nl)
+        return;
+      pos = nl - data + 1; // the line belongs to the previous chunk
+    }
+    size_t lineStart = pos;
+    const uint8_t* bracket = 0;
+    uint8_t tail[64];
+    for (size_t base = pos; lineStart < to && lineStart < size; base += 64) {
+      uint64_t nl, br;
+      if (base + 64 <= size) {
+        scan64(data + base, nl, br);
+      } else if (base < size) {
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, data + base, size - base);
+        scan64(tail, nl, br);
+      } else {
+        // the last line has no line feed
+        line(data + lineStart, data + size, bracket, out);
+        break;
+      }
+      uint64_t events = nl | br;
+      while (events) {
+        int i = __builtin_ctzll(events);
+        events &= events - 1;
+        if (!((nl >> i) & 1)) {
+          if (!bracket)
+            bracket = data + base + i;
+          continue;
+        }
+        line(data + lineStart, data + base + i, bracket, out);
+        lineStart = base + i + 1;
+        bracket = 0;
+        if (lineStart >= to)
+          break;
+      }
+    }
+  }
+};
+
+// Chunks [lo, hi) of a worker in one word: the owner takes from the front and thieves
+// from the back, both by CAS, so a chunk is taken once
+struct alignas(64) WorkQueue {
+  std::atomic<uint64_t> range;
+
+  bool take(bool front, uint32_t& chunk) {
+    uint64_t r = range.load();
+    while (true) {
+      uint32_t lo = (uint32_t)r, hi = (uint32_t)(r >> 32);
+      if (lo >= hi)
+        return false;
+      uint64_t next = front ? ((uint64_t)hi << 32) | (lo + 1) : ((uint64_t)(hi - 1) << 32) | lo;
+      if (range.compare_exchange_weak(r, next)) {
+        chunk = front ? lo : hi - 1;
+        return true;
+      }
+    }
+  }
+};
+
+void parseParallel(const uint8_t* data, size_t size, int threads, size_t chunkSize,
+    int partitions, const std::string& defaultStation,
+    std::vector<std::vector<IngestRecord>>& out, IngestStats& stats)
+{
+  uint32_t chunks = (uint32_t)((size + chunkSize - 1) / chunkSize);
+  // vectors keep their memory from the previous window
+  out.resize((size_t)chunks * partitions);
+  for (std::vector<IngestRecord>& o : out)
+    o.clear();
+  std::vector<WorkQueue> queues(threads);
+  for (int t = 0; t < threads; t++) {
+    uint64_t lo = (uint64_t)chunks * t / threads, hi = (uint64_t)chunks * (t + 1) / threads;
+    queues[t].range = (hi << 32) | lo;
+  }
+  std::vector<ChunkParser> parsers(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      ChunkParser& p = parsers[t];
+      p.defaultStation = &defaultStation;
+      p.partitions = partitions;
+      p.stats = IngestStats();
+      uint32_t c;
+      for (int v = 0; v < threads; v++) {
+        // own chunks first, then steal from the others
+        WorkQueue& q = queues[(t + v) % threads];
+        while (q.take(v == 0, c)) {
+          size_t from = (size_t)c * chunkSize;
+          size_t to = from + chunkSize < size ? from + chunkSize : size;
+          std::vector<IngestRecord>* o = &out[(size_t)c * partitions];
+          for (int k = 0; k < partitions; k++)
+            o[k].reserve((to - from) / (RECORD_BYTES * partitions) + 16);
+          p.chunk(data, size, from, to, o);
+        }
+      }
+    });
+  }
+  for (std::thread& w : workers)
+    w.join();
+  for (ChunkParser& p : parsers) {
+    stats.lines += p.stats.lines;
+    stats.records += p.stats.records;
+    stats.skipped += p.stats.skipped;
+  }
+}
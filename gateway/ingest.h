@@ -0,0 +1,39 @@
+// Parallel parser of logged gateway streams for bulk imports, see wcimport
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "reading.h"
+
+struct IngestRecord {
+  int64_t time;        // unix msec
+  const char* station; // points into the input
+  uint32_t stationLen;
+  Reading reading;
+};
+
+struct IngestStats {
+  uint64_t lines;
+  uint64_t records;
+  uint64_t skipped; // lines without a time or a known display line
+};
+
+// Decodes the 16 display characters after '[' with the fixed layouts of parse.cpp and
+// bmp085.cpp, gives the same values as parseReading
+bool decodeDisplay(const uint8_t* display, Reading& r);
+
+// Parses lines "<unix time> [<station>] [..] extra" of data[0..size) with threads that
+// share chunks of chunkSize bytes by work stealing. A line belongs to the chunk it starts
+// in. Records of chunk c and partition p (a hash of station and code) go to
+// out[c * partitions + p] in input order, out keeps its memory between calls.
+// Lines without a station get defaultStation, which must outlive the records.
+void parseParallel(const uint8_t* data, size_t size, int threads, size_t chunkSize,
+  int partitions, const std::string& defaultStation,
+  std::vector<std::vector<IngestRecord>>& out, IngestStats& stats);
+
+#endif
@@ -0,0 +1,129 @@
+#include <string.h>
+
+#include "packet.h"
+#include "fmt_util.h" // shared with the firmware, so that lines are the same in both modes
+
+#define CHECKSUM_NIBBLES 2
+
+// POSITIONS                 0123456789012345
+static const char sUNKN[] = "?: -------------";
+static const char sTEMP[] = "#: +??.? ??%   !";
+static const char sRAIN[] = "R: ------ --.--!";
+static const char sUVLT[] = "U: --          !";
+static const char sWIND[] = "W: --- --- d-- !";
+
+// status character at the end of the line by flags nibble
+static const char STS_CHARS[17] = " ghijklmnoabcdef";
+
+static int hexValue(uint8_t c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool parsePacket(const uint8_t* line, size_t len, Packet& p) {
+  if (len < 5 || line[0] != 'O' || line[1] != 'S' || line[3] != ':')
+    return false;
+  p.version = line[2] - '0';
+  if (p.version != 2 && p.version != 3)
+    return false;
+  size_t i = 4;
+  p.len = 0;
+  int v;
+  while (i < len && (v = hexValue(line[i])) >= 0) {
+    if (p.len == PACKET_NIBBLES)
+      return false;
+    p.nibble[p.len++] = v;
+    i++;
+  }
+  if (p.len <= CHECKSUM_NIBBLES)
+    return false;
+  p.millis = 0;
+  if (i < len && line[i] == ' ') {
+    for (i++; i < len && line[i] >= '0' && line[i] <= '9'; i++)
+      p.millis = p.millis * 10 + (line[i] - '0');
+  }
+  if (i != len)
+    return false;
+  // sum of nibbles up to the checksum, the checksum comes low nibble first (OsRx::ValidChecksum)
+  int n = p.len - CHECKSUM_NIBBLES;
+  uint8_t sum = 0;
+  for (int k = 0; k < n; k++)
+    sum += p.nibble[k];
+  return sum == (uint8_t)(p.nibble[n] | p.nibble[n + 1] << 4);
+}
+
+static void decodeTemp(const uint8_t* p, char* d) {
+  memcpy(d, sTEMP, PACKET_DISPLAY);
+  int16_t temp = 100 * p[10] + 10 * p[9] + p[8];
+  if (p[11] != 0)
+    temp = -temp;
+  int16_t humidity = 10 * p[13] + p[12];
+  d[0] = '0' + p[4];
+  formatDecimal(temp, &d[3], 5, 1 | FMT_SIGN | FMT_SPACE);
+  formatDecimal(humidity, &d[9], 2, FMT_SPACE);
+}
+
+static void decodeRain(const uint8_t* p, char* d) {
+  memcpy(d, sRAIN, PACKET_DISPLAY);
+  int32_t total = 100000L * p[17] + 10000L * p[16] + 1000 * p[15] +
+    100 * p[14] + 10 * p[13] + p[12];
+  int16_t rate = 1000 * p[11] + 100 * p[10] + 10 * p[9] + p[8];
+  formatDecimal(total, &d[3], 6, FMT_SPACE);
+  formatDecimal(rate, &d[10], 5, 2 | FMT_SPACE);
+}
+
+static void decodeUvlt(const uint8_t* p, char* d) {
+  memcpy(d, sUVLT, PACKET_DISPLAY);
+  int16_t uv = 10 * p[9] + p[8];
+  formatDecimal(uv, &d[3], 2, FMT_SPACE);
+}
+
+static void decodeWind(const uint8_t* p, char* d) {
+  memcpy(d, sWIND, PACKET_DISPLAY);
+  int16_t dir = p[8];
+  int16_t avg = 100 * p[16] + 10 * p[15] + p[14];
+  int16_t gust = 100 * p[13] + 10 * p[12] + p[11];
+  formatDecimal(avg, &d[3], 3, FMT_SPACE);
+  formatDecimal(gust, &d[7], 3, FMT_SPACE);
+  formatDecimal(dir, &d[12], 2, 0);
+}
+
+// Models of parse.cpp and ones that only the gateway knows, a new model needs just an entry here
+static const SensorModel MODELS[] = {
+  { 0xF824, "THGR810", 14, decodeTemp },
+  { 0xF8B4, "THGR810", 14, decodeTemp }, // in the anemometer
+  { 0x1D20, "THGR122NX", 14, decodeTemp }, // and THGN123N
+  { 0x1A2D, "THGR228N", 14, decodeTemp },
+  { 0x1A3D, "THGR918", 14, decodeTemp },
+  { 0x2914, "PCR800", 18, decodeRain },
+  { 0xD874, "UVN800", 10, decodeUvlt },
+  { 0xEC70, "UVR123", 10, decodeUvlt },
+  { 0x1984, "WGR800", 17, decodeWind },
+  { 0x1994, "WGR800", 17, decodeWind },
+};
+
+static const SensorModel* findModel(uint16_t id) {
+  for (size_t i = 0; i < sizeof(MODELS) / sizeof(MODELS[0]); i++)
+    if (MODELS[i].id == id)
+      return &MODELS[i];
+  return 0;
+}
+
+const SensorModel* decodePacket(const Packet& p, char display[PACKET_DISPLAY]) {
+  const uint8_t* n = p.nibble;
+  const SensorModel* m = p.len >= 8 ? findModel(n[0] << 12 | n[1] << 8 | n[2] << 4 | n[3]) : 0;
+  if (m && p.len < m->len + CHECKSUM_NIBBLES)
+    m = 0;
+  if (!m) {
+    memcpy(display, sUNKN, PACKET_DISPLAY);
+    for (int i = 0; i < 13; i++)
+      display[3 + i] = i < p.len ? HEX_CHARS[n[i]] : ' ';
+    return 0;
+  }
+  m->decode(n, display);
+  display[15] = STS_CHARS[n[7]];
+  return m;
+}
@@ -0,0 +1,33 @@
+// Decoder of sensor messages that boards write in the passthrough mode (see pipeline.h)
+#ifndef PACKET_H
+#define PACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PACKET_NIBBLES 64   // MAX_MSG_LEN of the firmware
+#define PACKET_DISPLAY 16   // DISPLAY_LENGTH of the firmware
+
+// Message of a line "OS<version>:<hex nibbles> <millis>"
+struct Packet {
+  int version;      // protocol 2 or 3
+  int len;          // nibbles after the sync nibble up to the checksum, both checksum nibbles included
+  uint8_t nibble[PACKET_NIBBLES];
+  uint32_t millis;  // board time of the last RF edge
+};
+
+// Sensor model that is decoded into a display line
+struct SensorModel {
+  uint16_t id;      // first 4 nibbles
+  const char* name;
+  int len;          // nibbles that the decoder reads, shorter messages are shown as unknown
+  void (*decode)(const uint8_t* p, char* display);
+};
+
+// Parses the line and validates the checksum of its message, returns false for other lines
+bool parsePacket(const uint8_t* line, size_t len, Packet& p);
+// Formats the display line of the message exactly as parse.cpp of the firmware does and returns
+// its sensor model, messages of unknown models are formatted as "?: <hex>" and return null
+const SensorModel* decodePacket(const Packet& p, char display[PACKET_DISPLAY]);
+
+#endif
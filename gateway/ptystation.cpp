@@ -0,0 +1,210 @@
+// Stand-in boards for testing the gateway without hardware. Creates ptys that play back
+// the same console output (e.g. saved from wcsim) like boards that hear the same sensors:
+// every station drops some of the readings and writes at the serial baud.
+// The slave paths are printed to stdout, one per line, for passing to the gateway.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <errno.h>
+
+#include <string>
+#include <vector>
+
+#define TICK_MS 10
+
+static void usage() {
+  fprintf(stderr,
+    "Usage: ptystation [options] [input]\n"
+    "Plays console output from a file or stdin to several ptys at once.\n"
+    "  -n <count>     number of stations (default 2)\n"
+    "  -b <baud>      pacing of every station, 10 bits per byte (default 57600)\n"
+    "  -d <percent>   readings dropped by every station independently (default 0)\n"
+    "  -s <seed>      random seed of the drops (default 1)\n"
+    "  -l             loop the input\n"
+    "  -w <sec>       wait before the playback and after its end (default 1)\n");
+}
+
+struct Pty {
+  int master;
+  int slave; // kept open so that the pty lives until the playback ends
+  std::string path;
+  size_t line;        // next line to write
+  std::string out;    // pending bytes of the current line
+  size_t outPos;
+  bool silent;        // the current line is dropped, it only takes its time
+  unsigned long written;
+  unsigned long dropped;
+  unsigned long blocked; // writes that did not fit the pty
+};
+
+static volatile bool stop;
+
+static void onSignal(int) {
+  stop = true;
+}
+
+static bool readInput(const char* input, std::vector<std::string>& lines) {
+  FILE* f = input && strcmp(input, "-") != 0 ? fopen(input, "rb") : stdin;
+  if (!f)
+    return false;
+  std::string line;
+  int c;
+  while ((c = getc(f)) != EOF) {
+    line += (char)c;
+    if (c == '\n') {
+      lines.push_back(line);
+      line.clear();
+    }
+  }
+  if (!line.empty())
+    lines.push_back(line);
+  if (f != stdin)
+    fclose(f);
+  return true;
+}
+
+static bool openPty(Pty& p) {
+  p.master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (p.master < 0 || grantpt(p.master) != 0 || unlockpt(p.master) != 0)
+    return false;
+  p.path = ptsname(p.master);
+  p.slave = open(p.path.c_str(), O_RDWR | O_NOCTTY);
+  if (p.slave < 0)
+    return false;
+  // raw from the start, so that nothing written before the gateway opens it is translated
+  struct termios tio;
+  if (tcgetattr(p.slave, &tio) != 0)
+    return false;
+  cfmakeraw(&tio);
+  if (tcsetattr(p.slave, TCSANOW, &tio) != 0)
+    return false;
+  fcntl(p.master, F_SETFL, fcntl(p.master, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+static void sleepMs(long ms) {
+  struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
+  nanosleep(&ts, 0);
+}
+
+int main(int argc, char* argv[]) {
+  int count = 2;
+  long baud = 57600;
+  double dropRate = 0;
+  unsigned seed = 1;
+  bool loop = false;
+  double wait = 1;
+  const char* input = 0;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (arg[0] != '-' || arg[1] == 0) {
+      input = arg;
+      continue;
+    }
+    if (arg[1] == 'l' && arg[2] == 0) {
+      loop = true;
+      continue;
+    }
+    const char* val = i + 1 < argc ? argv[i + 1] : 0;
+    if (!val || arg[2] != 0) {
+      usage();
+      return 1;
+    }
+    switch (arg[1]) {
+    case 'n': count = atoi(val); break;
+    case 'b': baud = atol(val); break;
+    case 'd': dropRate = atof(val) / 100; break;
+    case 's': seed = atoi(val); break;
+    case 'w': wait = atof(val); break;
+    default:
+      usage();
+      return 1;
+    }
+    i++;
+  }
+  if (count <= 0 || baud <= 0) {
+    usage();
+    return 1;
+  }
+  std::vector<std::string> lines;
+  if (!readInput(input, lines) || lines.empty()) {
+    fprintf(stderr, "ptystation: no input\n");
+    return 1;
+  }
+  std::vector<Pty> ptys(count);
+  for (Pty& p : ptys) {
+    if (!openPty(p)) {
+      perror("ptystation: cannot create pty");
+      return 1;
+    }
+    printf("%s\n", p.path.c_str());
+  }
+  fflush(stdout);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+  srand(seed);
+  sleepMs((long)(wait * 1000));
+  size_t budget = baud / 10 * TICK_MS / 1000; // bytes per station per tick
+  if (budget == 0)
+    budget = 1;
+  bool active = true;
+  while (!stop && active) {
+    active = false;
+    for (Pty& p : ptys) {
+      size_t left = budget;
+      while (left > 0) {
+        if (p.outPos == p.out.size()) {
+          if (p.line == lines.size()) {
+            if (!loop)
+              break;
+            p.line = 0;
+          }
+          const std::string& line = lines[p.line++];
+          p.out = line;
+          p.outPos = 0;
+          // only readings and passthrough messages are dropped, like a board that missed
+          // the transmission, so all stations stay in step
+          bool reading = line[0] == '[' || line.compare(0, 2, "OS") == 0;
+          p.silent = reading && dropRate > 0 && rand() < dropRate * RAND_MAX;
+          if (p.silent)
+            p.dropped++;
+        }
+        size_t n = p.out.size() - p.outPos;
+        if (n > left)
+          n = left;
+        if (p.silent) {
+          p.outPos += n;
+          left -= n;
+          continue;
+        }
+        ssize_t w = write(p.master, p.out.data() + p.outPos, n);
+        if (w <= 0) {
+          if (w < 0 && errno == EAGAIN)
+            p.blocked++;
+          break;
+        }
+        p.outPos += w;
+        p.written += w;
+        left -= w;
+      }
+      if (p.line < lines.size() || p.outPos < p.out.size())
+        active = true;
+    }
+    sleepMs(TICK_MS);
+  }
+  sleepMs((long)(wait * 1000));
+  for (Pty& p : ptys) {
+    fprintf(stderr, "ptystation: %s %lu bytes, %lu readings dropped, %lu blocked writes\n",
+      p.path.c_str(), p.written, p.dropped, p.blocked);
+    close(p.slave);
+    close(p.master);
+  }
+  return 0;
+}
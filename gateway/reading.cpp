@@ -0,0 +1,57 @@
+#include "reading.h"
+
+#define STATUS_POS 15 // battery and status character at the end of the display line
+
+int readingValues(char code) {
+  if (code >= '1' && code <= '9')
+    return 2; // temperature, humidity
+  switch (code) {
+  case 'R': return 2; // total, rate
+  case 'U': return 1;
+  case 'W': return 3; // average, gust, direction
+  case 'P': return 2; // temperature, pressure
+  default: return 0;
+  }
+}
+
+bool parseReading(const uint8_t* line, size_t len, Reading& r) {
+  if (len < 4 || line[0] != '[' || line[2] != ':')
+    return false;
+  r.code = line[1];
+  r.count = readingValues(r.code);
+  if (r.count == 0)
+    return false;
+  // the status character can touch the last value (rain rate), so it is cut off
+  size_t end = 1 + STATUS_POS;
+  if (end > len)
+    end = len;
+  size_t i = 3;
+  int n = 0;
+  while (i < end) {
+    uint8_t c = line[i];
+    if (c == ' ' || c == '%') {
+      i++;
+      continue;
+    }
+    if (c == 'd' || c == ']') { // wind direction prefix, end of a short line
+      i++;
+      continue;
+    }
+    bool negative = c == '-';
+    if (c == '-' || c == '+')
+      i++;
+    bool digits = false;
+    int32_t v = 0;
+    while (i < end && ((line[i] >= '0' && line[i] <= '9') || line[i] == '.')) {
+      if (line[i] != '.') {
+        v = v * 10 + (line[i] - '0');
+        digits = true;
+      }
+      i++;
+    }
+    if (!digits || n == r.count)
+      return false; // "--" of a missing value or a line of another format
+    r.value[n++] = negative ? -v : v;
+  }
+  return n == r.count;
+}
@@ -0,0 +1,23 @@
+// Values of readings in the console display line
+#ifndef READING_H
+#define READING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define READING_VALUES 3
+
+struct Reading {
+  char code;    // display code: 1-9 temperature, R rain, U UV, W wind, P BMP085
+  int count;    // values of the code, see readingValues
+  int32_t value[READING_VALUES];
+};
+
+// Number of values of a display code, 0 for codes that have none
+int readingValues(char code);
+// Parses "[X: ...]" as it is formatted in parse.cpp and bmp085.cpp. Values are the
+// printed decimals without the point: temperature 0.1, humidity %, rain total and
+// rate 0.01, UV index, wind average, gust and direction, pressure 0.1.
+bool parseReading(const uint8_t* line, size_t len, Reading& r);
+
+#endif
@@ -0,0 +1,235 @@
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rollup.h"
+
+#define HOUR_MS (3600 * 1000LL)
+
+struct LevelInfo {
+  int64_t period;
+  int slots;          // slots of a file
+  const char* format; // file name
+  const char* suffix;
+};
+
+static const LevelInfo LEVELS[ROLLUP_LEVELS] = {
+  { 60 * 1000LL, 24 * 60, "%Y-%m-%d.min", ".min" },
+  { HOUR_MS, 366 * 24, "%Y.hour", ".hour" },
+  { STORE_DAY_MS, 366, "%Y.day", ".day" }
+};
+
+// First slot of the file that covers the time: minute files are days, others are years
+static int64_t fileBase(int level, int64_t time) {
+  int64_t day = storeDayStart(time);
+  if (level == ROLLUP_MINUTE)
+    return day;
+  time_t t = (time_t)(day / 1000);
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  tm.tm_mon = 0;
+  tm.tm_mday = 1;
+  return (int64_t)timegm(&tm) * 1000;
+}
+
+static size_t slotSize(int columns) {
+  return sizeof(RollupSlot) + columns * sizeof(RollupValue);
+}
+
+static size_t fileSize(int level, int columns) {
+  return sizeof(RollupHeader) + LEVELS[level].slots * slotSize(columns);
+}
+
+// First slot of the next file, hour and day files of a common year leave the last day empty
+static int64_t fileEnd(int level, int64_t base) {
+  const LevelInfo& li = LEVELS[level];
+  return fileBase(level, base + li.period * li.slots);
+}
+
+struct Rollups::Map {
+  int64_t base;
+  int64_t end;   // base of the next file
+  uint8_t* data; // null when nothing is mapped
+};
+
+struct Rollups::Series {
+  std::string station;
+  char code;
+  int columns;
+  Map maps[ROLLUP_LEVELS];
+  int64_t lastTime;
+  int32_t lastTotal; // rain total of the latest reading
+  bool haveTotal;
+  Sample recent[ROLLUP_RECENT];
+  int recentPos;
+};
+
+Rollups::Rollups(const std::string& dir) :
+  samples(0), duplicates(0), errors(0), dir(dir)
+{}
+
+Rollups::~Rollups() {
+  for (auto& e : series) {
+    for (int level = 0; level < ROLLUP_LEVELS; level++)
+      if (e.second->maps[level].data)
+        munmap(e.second->maps[level].data, fileSize(level, e.second->columns));
+    delete e.second;
+  }
+}
+
+RollupSlot* Rollups::slot(Series& s, int level, int64_t time) {
+  const LevelInfo& li = LEVELS[level];
+  Map& m = s.maps[level];
+  size_t size = fileSize(level, s.columns);
+  if (!m.data || time < m.base || time >= m.end) {
+    if (m.data)
+      munmap(m.data, size);
+    m.data = 0;
+    m.base = fileBase(level, time);
+    m.end = fileEnd(level, m.base);
+    std::string path = seriesDir(dir, s.station, s.code) + "/" + storeName(m.base, li.format);
+    int fd;
+    if (!makeDirs(path) || (fd = open(path.c_str(), O_RDWR | O_CREAT, 0666)) < 0)
+      return 0;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && (st.st_size == (off_t)size ||
+      (st.st_size == 0 && ftruncate(fd, size) == 0));
+    void* map = ok ? mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED)
+      return 0;
+    RollupHeader& h = *(RollupHeader*)map;
+    if (h.magic == 0) { // new file, empty slots are zeros
+      h.magic = ROLLUP_MAGIC;
+      h.code = s.code;
+      h.columns = s.columns;
+      h.level = level;
+      h.base = m.base;
+    }
+    if (h.magic != ROLLUP_MAGIC || h.code != (uint8_t)s.code || h.columns != s.columns ||
+        h.level != level || h.base != m.base) {
+      munmap(map, size);
+      return 0;
+    }
+    m.data = (uint8_t*)map;
+  }
+  int64_t i = (time - m.base) / li.period;
+  return (RollupSlot*)(m.data + sizeof(RollupHeader) + i * slotSize(s.columns));
+}
+
+bool Rollups::add(const std::string& station, char code, int columns, const Sample& sample) {
+  std::string key = station + "/" + code;
+  Series*& s = series[key];
+  if (!s) {
+    s = new Series();
+    s->station = station;
+    s->code = code;
+    s->columns = columns;
+    s->lastTime = INT64_MIN;
+  }
+  // the gateway drops copies from other stations, this catches a reading stored twice,
+  // readings of one read share a time, so the values are compared too
+  for (int i = 0; i < ROLLUP_RECENT; i++) {
+    const Sample& r = s->recent[i];
+    if (r.time == sample.time && memcmp(r.value, sample.value, sizeof(int32_t) * columns) == 0) {
+      duplicates++;
+      return false;
+    }
+  }
+  s->recent[s->recentPos++ % ROLLUP_RECENT] = sample;
+  int64_t increase = 0;
+  if (code == 'R' && sample.time > s->lastTime) {
+    // a total going down is a counter reset and starts a new baseline, late totals
+    // lie between readings whose increase is already counted
+    int32_t total = sample.value[0];
+    if (s->haveTotal && total > s->lastTotal)
+      increase = total - s->lastTotal;
+    s->lastTotal = total;
+    s->haveTotal = true;
+  }
+  if (sample.time > s->lastTime)
+    s->lastTime = sample.time;
+  float windX = 0, windY = 0;
+  if (code == 'W') {
+    double a = sample.value[2] * (M_PI / 8); // 16 sectors from north
+    windX = sample.value[0] * sin(a);
+    windY = sample.value[0] * cos(a);
+  }
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    RollupSlot* r = slot(*s, level, sample.time);
+    if (!r) {
+      errors++;
+      continue;
+    }
+    RollupValue* values = (RollupValue*)(r + 1);
+    if (r->count == 0)
+      for (int c = 0; c < columns; c++)
+        values[c].min = values[c].max = sample.value[c];
+    r->count++;
+    for (int c = 0; c < columns; c++) {
+      RollupValue& v = values[c];
+      int32_t x = sample.value[c];
+      if (x < v.min)
+        v.min = x;
+      if (x > v.max)
+        v.max = x;
+      v.sum += x;
+    }
+    r->increase += increase;
+    r->windX += windX;
+    r->windY += windY;
+  }
+  samples++;
+  return true;
+}
+
+double rollupWindDir(const RollupRecord& r) {
+  if (r.slot.windX == 0 && r.slot.windY == 0)
+    return -1;
+  double deg = atan2(r.slot.windX, r.slot.windY) * (180 / M_PI);
+  return deg < 0 ? deg + 360 : deg;
+}
+
+void scanRollups(const std::string& dir, const std::string& station, char code, int level,
+    int64_t from, int64_t to, RollupHandler handler, void* ctx)
+{
+  const LevelInfo& li = LEVELS[level];
+  std::string series = seriesDir(dir, station, code);
+  std::string first = from > 0 ? storeName(fileBase(level, from), li.format) : "";
+  std::string last = to < INT64_MAX ? storeName(fileBase(level, to - 1), li.format) : "";
+  for (const std::string& name : listSeries(series, li.suffix, first, last)) {
+    int fd = open((series + "/" + name).c_str(), O_RDONLY);
+    if (fd < 0)
+      continue;
+    struct stat st;
+    void* map = fstat(fd, &st) == 0 && st.st_size > (off_t)sizeof(RollupHeader) ?
+      mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED)
+      continue;
+    const RollupHeader& h = *(const RollupHeader*)map;
+    if (h.magic == ROLLUP_MAGIC && h.level == level && h.code == (uint8_t)code &&
+        h.columns > 0 && h.columns <= READING_VALUES && st.st_size == (off_t)fileSize(level, h.columns)) {
+      const uint8_t* slots = (const uint8_t*)map + sizeof(RollupHeader);
+      size_t size = slotSize(h.columns);
+      // only the slots in range are touched
+      int64_t lo = from > h.base ? (from - h.base) / li.period : 0;
+      int64_t end = fileEnd(level, h.base);
+      int64_t hi = (to < end ? to - h.base + li.period - 1 : end - h.base) / li.period;
+      for (int64_t i = lo; i < hi; i++) {
+        RollupRecord r;
+        memcpy(&r.slot, slots + i * size, sizeof(r.slot));
+        r.start = h.base + i * li.period;
+        if (r.slot.count == 0 || r.start < from || r.start >= to)
+          continue;
+        memcpy(r.value, slots + i * size + sizeof(r.slot), h.columns * sizeof(RollupValue));
+        handler(r, h.code, h.columns, ctx);
+      }
+    }
+    munmap(map, st.st_size);
+  }
+}
@@ -0,0 +1,85 @@
+// Minute, hour and day aggregates of readings kept next to the raw store:
+//   <dir>/<station>/<code>/<yyyy-mm-dd>.min  1440 minutes of a day
+//   <dir>/<station>/<code>/<yyyy>.hour       hours of a year
+//   <dir>/<station>/<code>/<yyyy>.day        days of a year
+// A file is a header and a slot for every period, addressed by time and updated in place
+// through a shared mapping, so late readings go to their own periods. Min, max and sum
+// are kept for every value. The rain total is a counter: its increases are summed to the
+// period of the later reading. Wind direction is averaged as a vector weighted by speed.
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <map>
+#include <string>
+
+#include "reading.h"
+#include "store.h"
+
+#define ROLLUP_MAGIC  0x31525357 // "WSR1"
+#define ROLLUP_RECENT 16         // samples per series that are checked for duplicates
+
+enum RollupLevel { ROLLUP_MINUTE, ROLLUP_HOUR, ROLLUP_DAY, ROLLUP_LEVELS };
+
+struct RollupHeader {
+  uint32_t magic;
+  uint8_t code;
+  uint8_t columns;
+  uint8_t level;
+  uint8_t reserved;
+  int64_t base; // unix msec of the first slot
+};
+
+struct RollupValue {
+  int32_t min;
+  int32_t max;
+  int64_t sum;
+};
+
+// A slot in a file, followed by a RollupValue of every column. The time is given by the
+// position, empty slots are zeros.
+struct RollupSlot {
+  uint32_t count;
+  int32_t increase; // rain: sum of increases of the total
+  float windX;      // wind: sum of average speed times the direction vector
+  float windY;
+};
+
+struct RollupRecord {
+  int64_t start; // unix msec of the period
+  RollupSlot slot;
+  RollupValue value[READING_VALUES];
+};
+
+class Rollups {
+public:
+  explicit Rollups(const std::string& dir);
+  ~Rollups();
+
+  // Adds a sample to the three periods it falls in, returns false for a duplicate
+  bool add(const std::string& station, char code, int columns, const Sample& s);
+
+  uint64_t samples;
+  uint64_t duplicates;
+  uint64_t errors;
+
+private:
+  struct Map;
+  struct Series;
+  RollupSlot* slot(Series& s, int level, int64_t time);
+
+  std::string dir;
+  std::map<std::string, Series*> series;
+};
+
+typedef void (*RollupHandler)(const RollupRecord& r, char code, int columns, void* ctx);
+
+// Passes records of a level whose periods start in [from, to) to the handler in time order
+void scanRollups(const std::string& dir, const std::string& station, char code, int level,
+  int64_t from, int64_t to, RollupHandler handler, void* ctx);
+// Wind direction of a record in degrees, negative without wind
+double rollupWindDir(const RollupRecord& r);
+
+#endif
@@ -0,0 +1,138 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "station.h"
+
+#define FRAME_MORE ((size_t)0)       // need more bytes to tell
+#define FRAME_NONE ((size_t)-1)      // not a known frame
+
+// CRC16 of avr-libc _crc16_update, the firmware starts it with 0xffff
+static uint16_t crc16Update(uint16_t crc, uint8_t a) {
+  crc ^= a;
+  for (int i = 0; i < 8; i++)
+    crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  return crc;
+}
+
+// Size of a binary frame that starts with 'W': WH is the history log (dumpHistory) and
+// WR raw capture (checkRawCapture), both end with CRC16 of everything after the type
+static size_t frameSize(const uint8_t* p, size_t n) {
+  if (n < 2)
+    return FRAME_MORE;
+  switch (p[1]) {
+  case 'H':
+    return n < 3 ? FRAME_MORE : 6 + 4 * (size_t)p[2];
+  case 'R':
+    return n < 6 ? FRAME_MORE : 8 + (size_t)p[5];
+  default:
+    return FRAME_NONE;
+  }
+}
+
+static bool frameValid(const uint8_t* p, size_t size) {
+  uint16_t crc = 0xffff;
+  for (size_t i = 2; i < size - 2; i++)
+    crc = crc16Update(crc, p[i]);
+  return p[size - 2] == (crc & 0xff) && p[size - 1] == (crc >> 8);
+}
+
+size_t splitItems(Station& s, const uint8_t* buf, size_t len, ItemHandler handler, void* ctx) {
+  size_t pos = 0;
+  while (pos < len) {
+    const uint8_t* p = buf + pos;
+    size_t n = len - pos;
+    if (s.skipping) {
+      const uint8_t* eol = (const uint8_t*)memchr(p, '\n', n);
+      if (!eol)
+        return len;
+      s.skipping = false;
+      pos += eol - p + 1;
+      continue;
+    }
+    if (p[0] == 'W') {
+      size_t size = frameSize(p, n);
+      if (size == FRAME_MORE || (size != FRAME_NONE && size > n))
+        break;
+      if (size != FRAME_NONE) {
+        if (frameValid(p, size)) {
+          handler(s, ITEM_FRAME, p, size, ctx);
+          pos += size;
+        } else {
+          handler(s, ITEM_BAD_FRAME, p, 1, ctx);
+          pos++;
+        }
+        continue;
+      }
+    }
+    const uint8_t* eol = (const uint8_t*)memchr(p, '\n', n);
+    if (!eol)
+      break;
+    size_t l = eol - p;
+    if (l > 0 && p[l - 1] == '\r')
+      l--;
+    if (l > 0) {
+      ItemKind kind = p[0] == '[' ? ITEM_READING : p[0] == '{' ? ITEM_RECORD :
+        l > 1 && p[0] == 'O' && p[1] == 'S' ? ITEM_PACKET : ITEM_OTHER;
+      handler(s, kind, p, l, ctx);
+    }
+    pos += eol - p + 1;
+  }
+  return pos;
+}
+
+bool openStation(Station& s, speed_t baud) {
+  s.fd = open(s.path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (s.fd < 0)
+    s.fd = open(s.path.c_str(), O_RDONLY | O_NONBLOCK); // read-only ports
+  if (s.fd < 0)
+    return false;
+  struct termios tio;
+  if (tcgetattr(s.fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    cfsetispeed(&tio, baud);
+    cfsetospeed(&tio, baud);
+    tcsetattr(s.fd, TCSANOW, &tio);
+  }
+  s.len = 0;
+  s.skipping = false;
+  s.stats.opens++;
+  return true;
+}
+
+void closeStation(Station& s) {
+  if (s.fd >= 0)
+    close(s.fd);
+  s.fd = -1;
+}
+
+bool readStation(Station& s, ItemHandler handler, void* ctx) {
+  ssize_t n = read(s.fd, s.buf + s.len, STATION_BUFFER - s.len);
+  if (n < 0)
+    return errno == EAGAIN || errno == EINTR;
+  if (n == 0)
+    return false;
+  s.stats.reads++;
+  s.stats.bytes += n;
+  int queued;
+  if (ioctl(s.fd, FIONREAD, &queued) == 0) {
+    s.stats.backlog = queued;
+    if (queued > s.stats.maxBacklog)
+      s.stats.maxBacklog = queued;
+  }
+  s.len += n;
+  size_t used = splitItems(s, s.buf, s.len, handler, ctx);
+  if (used == 0 && s.len == STATION_BUFFER) {
+    // a line that does not fit, drop it up to its end
+    s.stats.overruns++;
+    s.skipping = true;
+    used = s.len;
+  }
+  // only the incomplete item at the end is moved
+  memmove(s.buf, s.buf + used, s.len - used);
+  s.len -= used;
+  return true;
+}
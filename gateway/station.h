@@ -0,0 +1,61 @@
+// Serial port of one WeatherCentral board and splitting of its console stream
+#ifndef STATION_H
+#define STATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <termios.h>
+
+#include <string>
+
+#define STATION_BUFFER 4096 // longest line or binary frame that is taken whole
+
+// Console items, see readStation
+enum ItemKind {
+  ITEM_READING,   // [..] extra
+  ITEM_RECORD,    // {X:..}*
+  ITEM_FRAME,     // binary frame with a valid CRC: 'W', type, ..., CRC16
+  ITEM_BAD_FRAME, // frame header with a wrong CRC, only its first byte is consumed
+  ITEM_PACKET,    // OS<version>:<hex> <millis> of the passthrough mode
+  ITEM_OTHER      // any other text line
+};
+
+struct StationStats {
+  uint64_t bytes;
+  uint64_t reads;
+  uint64_t items[ITEM_OTHER + 1];
+  uint64_t published;  // readings written to the unified stream
+  uint64_t duplicates; // readings that another station published first
+  uint64_t overruns;   // lines longer than the buffer, dropped
+  uint64_t badPackets; // passthrough lines with a wrong format or checksum
+  uint64_t opens;
+  int backlog;         // bytes waiting in the kernel after the last read
+  int maxBacklog;
+};
+
+struct Station {
+  int index;
+  std::string name;
+  std::string path;
+  int fd;           // -1 while the port is closed
+  uint64_t retryAt; // monotonic msec of the next open attempt
+  size_t len;       // bytes in buf
+  bool skipping;    // dropping the rest of a line that did not fit
+  StationStats stats;
+  uint8_t buf[STATION_BUFFER];
+};
+
+// Called for every complete item. Text lines come without CR LF. The data points into
+// the input buffer of the station and is valid only during the call.
+typedef void (*ItemHandler)(Station& s, ItemKind kind, const uint8_t* data, size_t len, void* ctx);
+
+// Opens the port in non-blocking mode, terminals are set to raw mode with a given baud
+bool openStation(Station& s, speed_t baud);
+void closeStation(Station& s);
+// Reads once and passes all complete items to the handler, returns false when the port is gone
+bool readStation(Station& s, ItemHandler handler, void* ctx);
+
+// Splits buf[0..len) into items, returns number of bytes consumed, the rest is an incomplete item
+size_t splitItems(Station& s, const uint8_t* buf, size_t len, ItemHandler handler, void* ctx);
+
+#endif
@@ -0,0 +1,403 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "store.h"
+#include "bits.h"
+
+// Bucket sizes of zigzag encoded numbers, zero is a single 0 bit and bucket i is prefixed
+// by i + 1 one bits and a 0 bit, except the last one. Reading times are msec and sensors
+// send every 14-73 s, so the jitter of the delta mostly fits 9 or 12 bits.
+static const uint8_t TIME_BUCKETS[] = { 7, 9, 12, 20, 64 };
+static const uint8_t VALUE_BUCKETS[] = { 4, 8, 16, 32 };
+
+#define BUCKETS(a) (int)(sizeof(a) / sizeof(a[0]))
+
+static uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t z) {
+  return (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+}
+
+static void putBucketed(BitWriter& w, uint64_t z, const uint8_t* buckets, int n) {
+  if (z == 0) {
+    w.put(0, 1);
+    return;
+  }
+  for (int i = 0; i < n; i++) {
+    bool last = i == n - 1;
+    if (last || z < (1ULL << buckets[i])) {
+      if (last)
+        w.put((1ULL << (i + 1)) - 1, i + 1);
+      else
+        w.put(((1ULL << (i + 1)) - 1) << 1, i + 2);
+      w.put(z, buckets[i]);
+      return;
+    }
+  }
+}
+
+static uint64_t getBucketed(BitReader& r, const uint8_t* buckets, int n) {
+  int i = 0;
+  while (i < n && r.get(1))
+    i++;
+  if (i == 0)
+    return 0;
+  return r.get(buckets[i == n ? n - 1 : i - 1]);
+}
+
+static size_t indexEntrySize(int columns) {
+  return sizeof(StoreIndexEntry) + 4 * (1 + columns);
+}
+
+int64_t storeDayStart(int64_t time) {
+  int64_t day = time / STORE_DAY_MS * STORE_DAY_MS;
+  return day > time ? day - STORE_DAY_MS : day;
+}
+
+std::string storeName(int64_t time, const char* format) {
+  time_t t = (time_t)(time / 1000);
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  char name[32];
+  strftime(name, sizeof(name), format, &tm);
+  return name;
+}
+
+std::string seriesDir(const std::string& dir, const std::string& station, char code) {
+  return dir + "/" + station + "/" + code;
+}
+
+std::string storePath(const std::string& dir, const std::string& station, char code, int64_t day) {
+  return seriesDir(dir, station, code) + "/" + storeName(day, "%Y-%m-%d.wcs");
+}
+
+bool makeDirs(const std::string& path) {
+  for (size_t i = 1; i < path.size(); i++) {
+    if (path[i] != '/')
+      continue;
+    if (mkdir(path.substr(0, i).c_str(), 0777) != 0 && errno != EEXIST)
+      return false;
+  }
+  return true;
+}
+
+// Size of the valid part of a file: header and complete blocks, 0 when the header is bad
+static size_t validLength(const uint8_t* data, size_t size, StoreFileHeader& fh) {
+  if (size < sizeof(fh))
+    return 0;
+  memcpy(&fh, data, sizeof(fh));
+  if (fh.magic != STORE_FILE_MAGIC || fh.columns == 0 || fh.columns > READING_VALUES)
+    return 0;
+  size_t pos = sizeof(fh);
+  while (pos + sizeof(StoreBlockHeader) <= size) {
+    StoreBlockHeader bh;
+    memcpy(&bh, data + pos, sizeof(bh));
+    if (bh.magic != STORE_BLOCK_MAGIC || pos + sizeof(bh) + bh.size > size)
+      break;
+    pos += sizeof(bh) + bh.size;
+  }
+  return pos;
+}
+
+struct Store::Series {
+  std::string station;
+  char code;
+  int columns;
+  int fd;
+  int64_t day;
+  std::vector<Sample> pending;
+};
+
+Store::Store(const std::string& dir, int64_t flushMs) :
+  samples(0), blocks(0), bytes(0), errors(0), dir(dir), flushMs(flushMs)
+{}
+
+Store::~Store() {
+  flushAll();
+  for (auto& e : series) {
+    if (e.second->fd >= 0)
+      close(e.second->fd);
+    delete e.second;
+  }
+}
+
+bool Store::openDay(Series& s, int64_t day) {
+  if (s.fd >= 0)
+    close(s.fd);
+  s.day = day;
+  std::string path = storePath(dir, s.station, s.code, day);
+  if (!makeDirs(path) || (s.fd = open(path.c_str(), O_RDWR | O_CREAT, 0666)) < 0)
+    return false;
+  struct stat st;
+  if (fstat(s.fd, &st) != 0)
+    return false;
+  StoreFileHeader fh;
+  size_t valid = 0;
+  if (st.st_size > 0) {
+    void* map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, s.fd, 0);
+    if (map == MAP_FAILED)
+      return false;
+    valid = validLength((const uint8_t*)map, st.st_size, fh);
+    munmap(map, st.st_size);
+    if (valid == 0 || fh.code != (uint8_t)s.code || fh.columns != s.columns)
+      return false; // not ours, leave it alone
+  } else {
+    fh.magic = STORE_FILE_MAGIC;
+    fh.code = s.code;
+    fh.columns = s.columns;
+    fh.reserved = 0;
+    fh.day = day;
+    if (write(s.fd, &fh, sizeof(fh)) != sizeof(fh))
+      return false;
+    valid = sizeof(fh);
+  }
+  // a block cut short by a crash is dropped
+  if ((off_t)valid < st.st_size && ftruncate(s.fd, valid) != 0)
+    return false;
+  return lseek(s.fd, valid, SEEK_SET) == (off_t)valid;
+}
+
+bool Store::flush(Series& s) {
+  if (s.pending.empty())
+    return true;
+  int count = (int)s.pending.size();
+  int segments = (count + STORE_SEGMENT - 1) / STORE_SEGMENT;
+  int columns = s.columns;
+  std::vector<uint32_t> offsets(segments * (1 + columns));
+  std::vector<uint8_t> streams;
+  BitWriter w(streams);
+  for (int seg = 0; seg < segments; seg++) {
+    offsets[seg * (1 + columns)] = (uint32_t)w.size();
+    int first = seg * STORE_SEGMENT;
+    int last = first + STORE_SEGMENT < count ? first + STORE_SEGMENT : count;
+    int64_t delta = 0;
+    for (int i = first + 1; i < last; i++) {
+      int64_t d = s.pending[i].time - s.pending[i - 1].time;
+      putBucketed(w, zigzag(d - delta), TIME_BUCKETS, BUCKETS(TIME_BUCKETS));
+      delta = d;
+    }
+  }
+  for (int c = 0; c < columns; c++) {
+    for (int seg = 0; seg < segments; seg++) {
+      offsets[seg * (1 + columns) + 1 + c] = (uint32_t)w.size();
+      int first = seg * STORE_SEGMENT;
+      int last = first + STORE_SEGMENT < count ? first + STORE_SEGMENT : count;
+      int32_t prev = 0;
+      for (int i = first; i < last; i++) {
+        int32_t v = s.pending[i].value[c];
+        // deltas wrap to 32 bits like the sum of the reader, so they fit the last bucket
+        putBucketed(w, zigzag((int32_t)((uint32_t)v - (uint32_t)prev)), VALUE_BUCKETS,
+          BUCKETS(VALUE_BUCKETS));
+        prev = v;
+      }
+    }
+  }
+  size_t entry = indexEntrySize(columns);
+  size_t size = segments * entry + streams.size();
+  size = (size + 7) & ~(size_t)7;
+  std::vector<uint8_t> block(sizeof(StoreBlockHeader) + size);
+  StoreBlockHeader bh;
+  bh.magic = STORE_BLOCK_MAGIC;
+  bh.count = count;
+  bh.columns = columns;
+  bh.segments = segments;
+  bh.size = size;
+  bh.streamBytes = streams.size();
+  bh.firstTime = s.pending.front().time;
+  bh.lastTime = s.pending.back().time;
+  memcpy(&block[0], &bh, sizeof(bh));
+  uint8_t* p = &block[sizeof(bh)];
+  for (int seg = 0; seg < segments; seg++) {
+    StoreIndexEntry ie = { s.pending[seg * STORE_SEGMENT].time };
+    memcpy(p, &ie, sizeof(ie));
+    memcpy(p + sizeof(ie), &offsets[seg * (1 + columns)], 4 * (1 + columns));
+    p += entry;
+  }
+  if (!streams.empty())
+    memcpy(p, &streams[0], streams.size());
+  s.pending.clear();
+  // one write per block, readers see either nothing or a whole block
+  if (s.fd < 0 || write(s.fd, &block[0], block.size()) != (ssize_t)block.size()) {
+    errors++;
+    return false;
+  }
+  blocks++;
+  bytes += block.size();
+  return true;
+}
+
+bool Store::append(const std::string& station, const Reading& r, int64_t time) {
+  std::string key = station + "/" + r.code;
+  Series*& s = series[key];
+  if (!s) {
+    s = new Series();
+    s->station = station;
+    s->code = r.code;
+    s->columns = r.count;
+    s->fd = -1;
+    s->day = -1;
+  }
+  int64_t day = storeDayStart(time);
+  // a block covers one day and its times do not go back
+  if (!s->pending.empty() && (day != s->day || time < s->pending.back().time ||
+      (int)s->pending.size() == STORE_BLOCK))
+    flush(*s);
+  if (day != s->day && !openDay(*s, day)) {
+    if (s->fd >= 0)
+      close(s->fd);
+    s->fd = -1;
+  }
+  if (s->fd < 0) {
+    errors++;
+    return false;
+  }
+  Sample sample;
+  sample.time = time;
+  memset(sample.value, 0, sizeof(sample.value));
+  memcpy(sample.value, r.value, sizeof(int32_t) * r.count);
+  s->pending.push_back(sample);
+  samples++;
+  return true;
+}
+
+void Store::flushOld(int64_t now) {
+  for (auto& e : series) {
+    Series& s = *e.second;
+    if (!s.pending.empty() && now - s.pending.front().time >= flushMs)
+      flush(s);
+  }
+}
+
+void Store::flushAll() {
+  for (auto& e : series)
+    flush(*e.second);
+}
+
+// Decodes one segment of a block into samples, returns the number of samples
+static int decodeSegment(const uint8_t* index, const uint8_t* streams, size_t streamBits,
+    int columns, int n, Sample* out)
+{
+  StoreIndexEntry ie;
+  memcpy(&ie, index, sizeof(ie));
+  uint32_t offsets[1 + READING_VALUES];
+  memcpy(offsets, index + sizeof(ie), 4 * (1 + columns));
+  BitReader tr(streams, streamBits, offsets[0]);
+  int64_t time = ie.time;
+  int64_t delta = 0;
+  for (int i = 0; i < n; i++) {
+    if (i > 0) {
+      delta += unzigzag(getBucketed(tr, TIME_BUCKETS, BUCKETS(TIME_BUCKETS)));
+      time += delta;
+    }
+    out[i].time = time;
+  }
+  for (int c = 0; c < columns; c++) {
+    BitReader vr(streams, streamBits, offsets[1 + c]);
+    int64_t v = 0;
+    for (int i = 0; i < n; i++) {
+      v += unzigzag(getBucketed(vr, VALUE_BUCKETS, BUCKETS(VALUE_BUCKETS)));
+      out[i].value[c] = (int32_t)v;
+    }
+  }
+  return n;
+}
+
+static void scanBlock(const uint8_t* p, const StoreBlockHeader& bh, int64_t from, int64_t to,
+    SampleHandler handler, void* ctx)
+{
+  size_t entry = indexEntrySize(bh.columns);
+  const uint8_t* streams = p + bh.segments * entry;
+  size_t streamBits = (size_t)bh.streamBytes * 8;
+  // the last segment that starts before from, segments are in time order and the one
+  // before a segment that starts at from can end with samples of the same time
+  int lo = 0, hi = bh.segments - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    int64_t t;
+    memcpy(&t, p + mid * entry, sizeof(t));
+    if (t < from)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  Sample samples[STORE_SEGMENT];
+  for (int seg = lo; seg < bh.segments; seg++) {
+    int first = seg * STORE_SEGMENT;
+    int n = bh.count - first < STORE_SEGMENT ? bh.count - first : STORE_SEGMENT;
+    decodeSegment(p + seg * entry, streams, streamBits, bh.columns, n, samples);
+    for (int i = 0; i < n; i++) {
+      if (samples[i].time >= to)
+        return;
+      if (samples[i].time >= from)
+        handler(samples[i], bh.columns, ctx);
+    }
+  }
+}
+
+bool scanFile(const std::string& path, int64_t from, int64_t to, SampleHandler handler, void* ctx) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void* map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+  const uint8_t* data = (const uint8_t*)map;
+  StoreFileHeader fh;
+  size_t valid = validLength(data, st.st_size, fh);
+  size_t pos = sizeof(fh);
+  while (pos < valid) {
+    StoreBlockHeader bh;
+    memcpy(&bh, data + pos, sizeof(bh));
+    if (bh.lastTime >= from && bh.firstTime < to)
+      scanBlock(data + pos + sizeof(bh), bh, from, to, handler, ctx);
+    pos += sizeof(bh) + bh.size;
+  }
+  munmap(map, st.st_size);
+  return valid != 0;
+}
+
+std::vector<std::string> listSeries(const std::string& series, const char* suffix,
+    const std::string& first, const std::string& last)
+{
+  std::vector<std::string> names;
+  DIR* d = opendir(series.c_str());
+  if (!d)
+    return names;
+  size_t n = strlen(suffix);
+  while (struct dirent* e = readdir(d)) {
+    std::string name = e->d_name;
+    if (name.size() > n && name.compare(name.size() - n, n, suffix) == 0 &&
+        (first.empty() || name >= first) && (last.empty() || name <= last))
+      names.push_back(name);
+  }
+  closedir(d);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+void scanSeries(const std::string& dir, const std::string& station, char code,
+    int64_t from, int64_t to, SampleHandler handler, void* ctx)
+{
+  // day files are listed instead of probed, open ranges would take forever
+  std::string series = seriesDir(dir, station, code);
+  std::string first = from > 0 ? storeName(storeDayStart(from), "%Y-%m-%d.wcs") : "";
+  std::string last = to < INT64_MAX ? storeName(storeDayStart(to - 1), "%Y-%m-%d.wcs") : "";
+  for (const std::string& name : listSeries(series, ".wcs", first, last))
+    scanFile(series + "/" + name, from, to, handler, ctx);
+}
@@ -0,0 +1,102 @@
+// Append-only time-series store of readings, one file per station, display code and UTC day:
+//   <dir>/<station>/<code>/<yyyy-mm-dd>.wcs
+// A file is a header and blocks of up to STORE_BLOCK samples. Blocks are columnar: the times
+// and every value are separate bit streams, times as delta of delta and values as delta, both
+// in variable-length buckets. Every STORE_SEGMENT samples the encoding restarts and a sparse
+// index entry records the time and the bit offset of every column, so a range scan decodes
+// only the segments it needs. Readers map the files, scans are served from the page cache.
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "reading.h"
+
+#define STORE_BLOCK   1024  // samples per block
+#define STORE_SEGMENT 64    // samples per index entry
+#define STORE_DAY_MS  86400000LL
+
+#define STORE_FILE_MAGIC  0x31534357 // "WCS1"
+#define STORE_BLOCK_MAGIC 0x4b4c4257 // "WBLK"
+
+struct StoreFileHeader {
+  uint32_t magic;
+  uint8_t code;
+  uint8_t columns;
+  uint16_t reserved;
+  int64_t day; // unix msec of the UTC day start
+};
+
+struct StoreBlockHeader {
+  uint32_t magic;
+  uint16_t count;
+  uint8_t columns;
+  uint8_t segments;
+  uint32_t size;     // bytes after the header, a multiple of 8
+  uint32_t streamBytes;
+  int64_t firstTime;
+  int64_t lastTime;
+};
+
+// Followed by a bit offset of the time and of every value column into the streams
+struct StoreIndexEntry {
+  int64_t time;
+};
+
+struct Sample {
+  int64_t time; // unix msec
+  int32_t value[READING_VALUES];
+};
+
+class Store {
+public:
+  // Pending samples of a series are written as a block when it is full, on a new day,
+  // when the oldest one waited flushMs and in flushAll
+  Store(const std::string& dir, int64_t flushMs);
+  ~Store();
+
+  bool append(const std::string& station, const Reading& r, int64_t time);
+  void flushOld(int64_t now);
+  void flushAll();
+
+  uint64_t samples;
+  uint64_t blocks;
+  uint64_t bytes;
+  uint64_t errors;
+
+private:
+  struct Series;
+  bool flush(Series& s);
+  bool openDay(Series& s, int64_t day);
+
+  std::string dir;
+  int64_t flushMs;
+  std::map<std::string, Series*> series;
+};
+
+typedef void (*SampleHandler)(const Sample& s, int columns, void* ctx);
+
+int64_t storeDayStart(int64_t time);
+// UTC time formatted with strftime
+std::string storeName(int64_t time, const char* format);
+std::string seriesDir(const std::string& dir, const std::string& station, char code);
+std::string storePath(const std::string& dir, const std::string& station, char code, int64_t day);
+// Creates missing directories of a file path
+bool makeDirs(const std::string& path);
+// Names of the files in a series directory with a suffix in [first, last] in name order,
+// empty bounds are open
+std::vector<std::string> listSeries(const std::string& series, const char* suffix,
+  const std::string& first, const std::string& last);
+// Passes samples with from <= time < to to the handler in file order, returns false
+// when the file cannot be read
+bool scanFile(const std::string& path, int64_t from, int64_t to, SampleHandler handler, void* ctx);
+// Scans all day files of a series in the range, missing days are skipped
+void scanSeries(const std::string& dir, const std::string& station, char code,
+  int64_t from, int64_t to, SampleHandler handler, void* ctx);
+
+#endif
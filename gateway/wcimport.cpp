@@ -0,0 +1,256 @@
+// Bulk import of logged gateway streams into the store (see store.h and rollup.h).
+// Files are mapped and parsed by all cores (see ingest.h), then the records are appended
+// by as many threads, each owning the series of its partition.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ingest.h"
+#include "store.h"
+#include "rollup.h"
+
+#define WINDOW_BYTES (256 << 20) // parsed records of this much input are kept at once
+
+static void usage() {
+  fprintf(stderr,
+    "Usage: wcimport [options] -d <dir> file ...\n"
+    "       wcimport [options] -b <MB>\n"
+    "Imports logged gateway streams \"<unix time> [<station>] [..] extra\" into a store.\n"
+    "Lines without a station are stored under the file name without its extension.\n"
+    "  -d <dir>       store directory\n"
+    "  -j <threads>   threads (default: all cores)\n"
+    "  -c <KB>        chunk of a file that a thread takes at once (default 1024)\n"
+    "  -n             parse only, nothing is stored\n"
+    "  -b <MB>        benchmark: parse a generated log of a given size in memory, twice,\n"
+    "                 and time the second pass\n");
+}
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct Sink {
+  std::vector<Store*> stores;
+  std::vector<Rollups*> rollups;
+};
+
+// Appends records of every partition in input order, one thread per partition
+static void appendRecords(Sink& sink, std::vector<std::vector<IngestRecord>>& out, int partitions) {
+  std::vector<std::thread> workers;
+  for (int k = 0; k < partitions; k++) {
+    workers.emplace_back([&, k]() {
+      Store& store = *sink.stores[k];
+      Rollups& rollups = *sink.rollups[k];
+      for (size_t i = k; i < out.size(); i += partitions) {
+        for (const IngestRecord& rec : out[i]) {
+          std::string station(rec.station, rec.stationLen);
+          Sample s;
+          s.time = rec.time;
+          memcpy(s.value, rec.reading.value, sizeof(int32_t) * rec.reading.count);
+          if (rollups.add(station, rec.reading.code, rec.reading.count, s))
+            store.append(station, rec.reading, s.time);
+        }
+      }
+    });
+  }
+  for (std::thread& w : workers)
+    w.join();
+}
+
+static void printStats(const char* name, double mb, const IngestStats& st, double parse, double store) {
+  fprintf(stderr, "wcimport: %s: %.1f MB, %llu lines, %llu records, %llu skipped, "
+    "parse %.3f s (%.2f GB/s)", name, mb, (unsigned long long)st.lines,
+    (unsigned long long)st.records, (unsigned long long)st.skipped, parse, mb / 1024 / parse);
+  if (store > 0)
+    fprintf(stderr, ", store %.3f s (%.0f MB/s)", store, mb / store);
+  fputc('\n', stderr);
+}
+
+static bool importFile(const char* path, Sink* sink, int threads, size_t chunkSize) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "wcimport: cannot read %s\n", path);
+    return false;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    return true;
+  }
+  void* map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "wcimport: cannot map %s\n", path);
+    return false;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  const char* base = strrchr(path, '/');
+  std::string station = base ? base + 1 : path;
+  station = station.substr(0, station.find('.'));
+  const uint8_t* data = (const uint8_t*)map;
+  IngestStats stats = {};
+  double parseTime = 0, storeTime = 0;
+  std::vector<std::vector<IngestRecord>> out;
+  // windows end on chunk boundaries, a line that crosses one belongs to the earlier window
+  size_t window = WINDOW_BYTES / chunkSize * chunkSize;
+  for (size_t from = 0; from < (size_t)st.st_size; from += window) {
+    size_t to = from + window < (size_t)st.st_size ? from + window : st.st_size;
+    double t0 = now();
+    IngestStats ws = {};
+    // the window is parsed as if it were the whole input, so the first line is taken
+    // only when the window starts a line and the last one may run into the next window
+    size_t start = from;
+    if (from > 0 && data[from - 1] != '\n') {
+      const uint8_t* nl = (const uint8_t*)memchr(data + from, '\n', st.st_size - from);
+      start = nl ? nl - data + 1 : st.st_size;
+    }
+    size_t end = to;
+    if (to < (size_t)st.st_size && data[to - 1] != '\n') {
+      const uint8_t* nl = (const uint8_t*)memchr(data + to, '\n', st.st_size - to);
+      end = nl ? nl - data + 1 : st.st_size;
+    }
+    parseParallel(data + start, end - start, threads, chunkSize, threads, station, out, ws);
+    double t1 = now();
+    if (sink)
+      appendRecords(*sink, out, threads);
+    double t2 = now();
+    parseTime += t1 - t0;
+    storeTime += t2 - t1;
+    stats.lines += ws.lines;
+    stats.records += ws.records;
+    stats.skipped += ws.skipped;
+  }
+  printStats(path, st.st_size / 1048576.0, stats, parseTime, sink ? storeTime : 0);
+  munmap(map, st.st_size);
+  return true;
+}
+
+// Lines like the gateway writes for a few stations, with all display codes
+static std::string generateLog(size_t bytes) {
+  static const char* stations[] = { "north", "south", "roof" };
+  std::string log;
+  log.reserve(bytes + 256);
+  char line[256];
+  int64_t time = 1790000000000LL;
+  unsigned seed = 1;
+  for (unsigned long i = 0; log.size() < bytes; i++) {
+    seed = seed * 1103515245 + 12345;
+    unsigned r = seed >> 8;
+    int t = (int)(r % 600) - 200;
+    const char* s = stations[r % 3];
+    time += 1000 + r % 9000;
+    int n;
+    switch (i % 6) {
+    case 0: case 1:
+      n = snprintf(line, sizeof(line), "%lld.%03d %s [%d: %5.1f %2d%%    ] dp %5.1f hx %5.1f\n",
+        (long long)(time / 1000), (int)(time % 1000), s, 1 + (int)(i % 3), t / 10.0,
+        (int)(r % 90) + 10, t / 12.0, t / 9.0);
+      break;
+    case 2:
+      n = snprintf(line, sizeof(line), "%lld.%03d %s [R: %6u %2u.%02u ] 1h %6u 24h %6u\n",
+        (long long)(time / 1000), (int)(time % 1000), s, 12000 + (unsigned)(i / 64), r % 40, r % 100,
+        r % 10, r % 200);
+      break;
+    case 3:
+      n = snprintf(line, sizeof(line), "%lld.%03d %s [W: %3u %3u d%02u  ] 2m %3u 180 %3u\n",
+        (long long)(time / 1000), (int)(time % 1000), s, r % 300, r % 300 + 20, r % 16, r % 300, r % 320);
+      break;
+    case 4:
+      n = snprintf(line, sizeof(line), "%lld.%03d %s [U: %2u           ]\n",
+        (long long)(time / 1000), (int)(time % 1000), s, r % 12);
+      break;
+    default:
+      n = snprintf(line, sizeof(line), "%lld.%03d %s [P: %5.1f %6.1f ] qnh %6.1f\n",
+        (long long)(time / 1000), (int)(time % 1000), s, t / 10.0, 990 + r % 400 / 10.0,
+        1000 + r % 400 / 10.0);
+    }
+    log.append(line, n);
+  }
+  return log;
+}
+
+int main(int argc, char* argv[]) {
+  const char* dir = 0;
+  int threads = (int)std::thread::hardware_concurrency();
+  size_t chunkSize = 1 << 20;
+  bool parseOnly = false;
+  double benchMB = 0;
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (arg[0] != '-') {
+      files.push_back(arg);
+      continue;
+    }
+    if (arg[1] == 'n' && arg[2] == 0) {
+      parseOnly = true;
+      continue;
+    }
+    const char* val = i + 1 < argc ? argv[i + 1] : 0;
+    if (!val || arg[1] == 0 || arg[2] != 0) {
+      usage();
+      return 1;
+    }
+    switch (arg[1]) {
+    case 'd': dir = val; break;
+    case 'j': threads = atoi(val); break;
+    case 'c': chunkSize = (size_t)atol(val) << 10; break;
+    case 'b': benchMB = atof(val); break;
+    default:
+      usage();
+      return 1;
+    }
+    i++;
+  }
+  if (threads <= 0)
+    threads = 1;
+  if (benchMB > 0) {
+    std::string log = generateLog((size_t)(benchMB * 1048576));
+    std::vector<std::vector<IngestRecord>> out;
+    IngestStats stats = {};
+    // the first pass allocates the output like the first window of an import
+    parseParallel((const uint8_t*)log.data(), log.size(), threads, chunkSize, threads, "bench", out, stats);
+    stats = IngestStats();
+    double t0 = now();
+    parseParallel((const uint8_t*)log.data(), log.size(), threads, chunkSize, threads, "bench", out, stats);
+    double t1 = now();
+    char name[32];
+    snprintf(name, sizeof(name), "bench -j %d", threads);
+    printStats(name, log.size() / 1048576.0, stats, t1 - t0, 0);
+    return 0;
+  }
+  if (files.empty() || chunkSize == 0 || (!dir && !parseOnly)) {
+    usage();
+    return 1;
+  }
+  Sink sink;
+  for (int k = 0; !parseOnly && k < threads; k++) {
+    sink.stores.push_back(new Store(dir, STORE_DAY_MS));
+    sink.rollups.push_back(new Rollups(dir));
+  }
+  bool ok = true;
+  for (const char* f : files)
+    ok &= importFile(f, parseOnly ? 0 : &sink, threads, chunkSize);
+  uint64_t errors = 0;
+  for (int k = 0; !parseOnly && k < threads; k++) {
+    sink.stores[k]->flushAll();
+    errors += sink.stores[k]->errors + sink.rollups[k]->errors;
+    delete sink.stores[k];
+    delete sink.rollups[k];
+  }
+  if (errors)
+    fprintf(stderr, "wcimport: %llu store errors\n", (unsigned long long)errors);
+  return ok && errors == 0 ? 0 : 1;
+}
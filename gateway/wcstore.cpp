@@ -0,0 +1,217 @@
+// Imports gateway streams into the time-series store and reads it back (see store.h
+// and rollup.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include "store.h"
+#include "rollup.h"
+
+static void usage() {
+  fprintf(stderr,
+    "Usage: wcstore -d <dir> <command> ...\n"
+    "Time-series store of readings. Times are unix seconds.\n"
+    "  import [file]                      append a gateway stream from a file or stdin\n"
+    "  scan <station> <code> [from [to]]  print samples as <time> <values>\n"
+    "  agg <station> <code> m|h|d [from [to]]\n"
+    "                                     print minute, hour or day aggregates as\n"
+    "                                     <time> <count> <min> <max> <mean> of every value\n"
+    "  rollup                             rebuild all aggregates from the samples\n"
+    "  stat                               print samples and bytes of every series\n");
+}
+
+static void printSample(const Sample& s, int columns, void* ctx) {
+  printf("%lld.%03lld", (long long)(s.time / 1000), (long long)(s.time % 1000));
+  for (int c = 0; c < columns; c++)
+    printf(" %d", s.value[c]);
+  putchar('\n');
+}
+
+static void printRollup(const RollupRecord& r, char code, int columns, void* ctx) {
+  printf("%lld %u", (long long)(r.start / 1000), r.slot.count);
+  for (int c = 0; c < columns; c++)
+    printf("  %d %d %.2f", r.value[c].min, r.value[c].max, (double)r.value[c].sum / r.slot.count);
+  if (code == 'R')
+    printf("  rain %d", r.slot.increase);
+  if (code == 'W')
+    printf("  dir %.1f", rollupWindDir(r));
+  putchar('\n');
+}
+
+static int import(const std::string& dir, const char* input) {
+  FILE* f = input && strcmp(input, "-") != 0 ? fopen(input, "r") : stdin;
+  if (!f) {
+    fprintf(stderr, "wcstore: cannot read %s\n", input);
+    return 1;
+  }
+  Store store(dir, STORE_DAY_MS);
+  Rollups rollups(dir);
+  unsigned long lines = 0, skipped = 0;
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    lines++;
+    // <unix time> <station> [..] extra
+    char* end;
+    double time = strtod(line, &end);
+    char* station = end + (*end == ' ');
+    char* sp = strchr(station, ' ');
+    Reading r;
+    if (end == line || !sp || sp == station ||
+        !parseReading((const uint8_t*)sp + 1, strlen(sp + 1), r)) {
+      skipped++;
+      continue;
+    }
+    std::string name(station, sp - station);
+    Sample s;
+    s.time = (int64_t)(time * 1000 + 0.5);
+    memcpy(s.value, r.value, sizeof(int32_t) * r.count);
+    if (rollups.add(name, r.code, r.count, s))
+      store.append(name, r, s.time);
+  }
+  if (f != stdin)
+    fclose(f);
+  store.flushAll();
+  fprintf(stderr, "wcstore: %lu lines, %lu skipped, %llu samples, %llu blocks, %llu bytes, "
+    "%llu duplicates, %llu errors\n", lines, skipped, (unsigned long long)store.samples,
+    (unsigned long long)store.blocks, (unsigned long long)store.bytes,
+    (unsigned long long)rollups.duplicates, (unsigned long long)(store.errors + rollups.errors));
+  return store.errors + rollups.errors != 0;
+}
+
+typedef void (*SeriesHandler)(const std::string& dir, const std::string& station, char code, void* ctx);
+
+// <dir>/<station>/<code>/...
+static bool forEachSeries(const std::string& dir, SeriesHandler handler, void* ctx) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) {
+    fprintf(stderr, "wcstore: cannot read %s\n", dir.c_str());
+    return false;
+  }
+  while (struct dirent* station = readdir(d)) {
+    if (station->d_name[0] == '.')
+      continue;
+    DIR* sd = opendir((dir + "/" + station->d_name).c_str());
+    if (!sd)
+      continue;
+    while (struct dirent* code = readdir(sd))
+      if (code->d_name[0] != '.' && code->d_name[1] == 0)
+        handler(dir, station->d_name, code->d_name[0], ctx);
+    closedir(sd);
+  }
+  closedir(d);
+  return true;
+}
+
+struct StatTotals {
+  unsigned long samples;
+  unsigned long bytes;
+  unsigned long rollupBytes;
+};
+
+static void countSample(const Sample& s, int columns, void* ctx) {
+  (*(unsigned long*)ctx)++;
+}
+
+static unsigned long filesSize(const std::string& series, const char* suffix, unsigned long* files) {
+  unsigned long bytes = 0;
+  for (const std::string& name : listSeries(series, suffix, "", "")) {
+    struct stat st;
+    if (stat((series + "/" + name).c_str(), &st) != 0)
+      continue;
+    bytes += st.st_size;
+    if (files)
+      (*files)++;
+  }
+  return bytes;
+}
+
+static void statSeries(const std::string& dir, const std::string& station, char code, void* ctx) {
+  StatTotals& t = *(StatTotals*)ctx;
+  std::string series = seriesDir(dir, station, code);
+  unsigned long files = 0, samples = 0;
+  unsigned long bytes = filesSize(series, ".wcs", &files);
+  scanSeries(dir, station, code, INT64_MIN, INT64_MAX, countSample, &samples);
+  unsigned long rollupBytes = filesSize(series, ".min", 0) + filesSize(series, ".hour", 0) +
+    filesSize(series, ".day", 0);
+  printf("%s %c: %lu files, %lu samples, %lu bytes, %.2f bytes/sample, %lu bytes of aggregates\n",
+    station.c_str(), code, files, samples, bytes, samples ? (double)bytes / samples : 0.0,
+    rollupBytes);
+  t.samples += samples;
+  t.bytes += bytes;
+  t.rollupBytes += rollupBytes;
+}
+
+struct RebuildContext {
+  Rollups* rollups;
+  std::string station;
+  char code;
+};
+
+static void rebuildSample(const Sample& s, int columns, void* ctx) {
+  RebuildContext& rc = *(RebuildContext*)ctx;
+  rc.rollups->add(rc.station, rc.code, columns, s);
+}
+
+static void rebuildSeries(const std::string& dir, const std::string& station, char code, void* ctx) {
+  std::string series = seriesDir(dir, station, code);
+  const char* suffixes[] = { ".min", ".hour", ".day" };
+  for (const char* suffix : suffixes)
+    for (const std::string& name : listSeries(series, suffix, "", ""))
+      unlink((series + "/" + name).c_str());
+  RebuildContext rc = { (Rollups*)ctx, station, code };
+  scanSeries(dir, station, code, INT64_MIN, INT64_MAX, rebuildSample, &rc);
+}
+
+static int64_t parseTime(int argc, char* argv[], int i, int64_t none) {
+  return i < argc ? (int64_t)(atof(argv[i]) * 1000) : none;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 4 || strcmp(argv[1], "-d") != 0) {
+    usage();
+    return 1;
+  }
+  std::string dir = argv[2];
+  const char* cmd = argv[3];
+  if (strcmp(cmd, "import") == 0 && argc <= 5)
+    return import(dir, argc == 5 ? argv[4] : 0);
+  if (strcmp(cmd, "stat") == 0 && argc == 4) {
+    StatTotals t = {};
+    if (!forEachSeries(dir, statSeries, &t))
+      return 1;
+    printf("total: %lu samples, %lu bytes, %.2f bytes/sample, %lu bytes of aggregates\n",
+      t.samples, t.bytes, t.samples ? (double)t.bytes / t.samples : 0.0, t.rollupBytes);
+    return 0;
+  }
+  if (strcmp(cmd, "rollup") == 0 && argc == 4) {
+    Rollups rollups(dir);
+    if (!forEachSeries(dir, rebuildSeries, &rollups))
+      return 1;
+    fprintf(stderr, "wcstore: %llu samples, %llu duplicates, %llu errors\n",
+      (unsigned long long)rollups.samples, (unsigned long long)rollups.duplicates,
+      (unsigned long long)rollups.errors);
+    return rollups.errors != 0;
+  }
+  if (strcmp(cmd, "scan") == 0 && argc >= 6 && argc <= 8 && strlen(argv[5]) == 1) {
+    scanSeries(dir, argv[4], argv[5][0], parseTime(argc, argv, 6, INT64_MIN),
+      parseTime(argc, argv, 7, INT64_MAX), printSample, 0);
+    return 0;
+  }
+  if (strcmp(cmd, "agg") == 0 && argc >= 7 && argc <= 9 && strlen(argv[5]) == 1) {
+    const char* levels = "mhd";
+    const char* level = strchr(levels, argv[6][0]);
+    if (level && argv[6][1] == 0) {
+      scanRollups(dir, argv[4], argv[5][0], level - levels, parseTime(argc, argv, 7, INT64_MIN),
+        parseTime(argc, argv, 8, INT64_MAX), printRollup, 0);
+      return 0;
+    }
+  }
+  usage();
+  return 1;
+}
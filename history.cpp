@@ -0,0 +1,208 @@
+
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include "history.h"
+#include "display.h"
+#include "xprint.h"
+#include "Timeout.h"
+#include "schedule.h"
+
+// Record tag: bit 7 toggles on every pass over the log, bit 6 flags the first record of an hour,
+// bits 5-4 are kind, bits 3-0 are sensor index. Erased EEPROM reads as 0xff, which is never
+// a valid tag, because sensor index of mark records is HISTORY_SILENT or HISTORY_BOOT.
+#define TAG_LAP    0x80
+#define TAG_HOUR   0x40
+#define TAG_KIND   0x30
+#define TAG_SENSOR 0x0f
+#define TAG_EMPTY  0xff
+
+// Layout mark in front of the records, a log of an older firmware is erased at boot
+#define HISTORY_LAYOUT 0x3448 // "H4"
+
+#define HISTORY_PERIOD Timeout::HOUR
+
+struct HistoryRecord {
+  byte tag;
+  byte min;
+  byte max;
+  byte mean;
+};
+
+static_assert(sizeof(HistoryRecord) == HISTORY_RECORD_SIZE, "HistoryRecord size");
+
+struct HistorySlot {
+  byte tag; // TAG_EMPTY when slot is not used
+  int16_t min;
+  int16_t max;
+  int32_t sum;
+  byte count;
+};
+
+HistorySlot historySlot[HISTORY_SLOTS];
+byte historyPos; // next record to write
+byte historyLap; // TAG_LAP bit of the current pass
+unsigned long historyStart; // start time of the current hour
+Deferred historyDeferred;
+
+static HistoryRecord* recordAddr(byte i) {
+  return (HistoryRecord*)(size_t)(HISTORY_ADDR + 2 + i * sizeof(HistoryRecord));
+}
+
+static byte readTag(byte i) {
+  return eeprom_read_byte((const uint8_t*)recordAddr(i));
+}
+
+static void putRecord(HistoryRecord& r) {
+  r.tag |= historyLap;
+  eeprom_update_block(&r, recordAddr(historyPos), sizeof(r));
+  if (++historyPos == HISTORY_RECORDS) {
+    historyPos = 0;
+    historyLap ^= TAG_LAP;
+  }
+}
+
+static void putMark(byte tag) {
+  HistoryRecord r;
+  r.tag = tag;
+  r.min = r.max = r.mean = 0;
+  putRecord(r);
+}
+
+void setupHistory() {
+  for (byte i = 0; i < HISTORY_SLOTS; i++)
+    historySlot[i].tag = TAG_EMPTY;
+  historyStart = millis();
+  uint16_t layout;
+  eeprom_read_block(&layout, (const void*)HISTORY_ADDR, sizeof(layout));
+  if (layout != HISTORY_LAYOUT) {
+    // erased EEPROM or records of an older firmware, only tags are checked
+    for (byte i = 0; i < HISTORY_RECORDS; i++)
+      eeprom_update_byte((uint8_t*)recordAddr(i), TAG_EMPTY);
+    layout = HISTORY_LAYOUT;
+    eeprom_update_block(&layout, (void*)HISTORY_ADDR, sizeof(layout));
+    return;
+  }
+  byte tag = readTag(0);
+  if (tag == TAG_EMPTY)
+    return;
+  // find the first record that was not written on the same pass as the first one
+  byte lap = tag & TAG_LAP;
+  byte i = 1;
+  while (i < HISTORY_RECORDS && (tag = readTag(i)) != TAG_EMPTY && (tag & TAG_LAP) == lap)
+    i++;
+  if (i < HISTORY_RECORDS) {
+    historyPos = i;
+    historyLap = lap;
+  } else {
+    historyPos = 0;
+    historyLap = lap ^ TAG_LAP;
+  }
+  // repeated resets without a finished hour leave one boot record
+  tag = readTag((historyPos == 0 ? HISTORY_RECORDS : historyPos) - 1);
+  if ((tag & (TAG_KIND | TAG_SENSOR)) != (HISTORY_MARK << 4 | HISTORY_BOOT))
+    putMark(HISTORY_MARK << 4 | HISTORY_BOOT);
+}
+
+static byte quantize(byte kind, int16_t value) {
+  int16_t q;
+  switch (kind) {
+  case HISTORY_TEMP: q = (value + 400) / 5; break;
+  case HISTORY_WIND: q = value / 2; break;
+  default: q = value;
+  }
+  return q < 0 ? 0 : q > 0xff ? 0xff : q;
+}
+
+static void writeRecord(HistorySlot& hs, byte flag) {
+  byte kind = (hs.tag & TAG_KIND) >> 4;
+  HistoryRecord r;
+  r.tag = hs.tag | flag;
+  r.min = quantize(kind, hs.min);
+  r.max = quantize(kind, hs.max);
+  r.mean = quantize(kind, hs.sum / hs.count);
+  putRecord(r);
+}
+
+void checkHistory() {
+  if (!historyDeferred.ready(millis() - historyStart >= HISTORY_PERIOD, BUSY_HISTORY))
+    return;
+  historyStart += HISTORY_PERIOD;
+  byte flag = TAG_HOUR; // goes to the first record of the hour
+  for (byte i = 0; i < HISTORY_SLOTS; i++) {
+    HistorySlot& hs = historySlot[i];
+    if (hs.tag != TAG_EMPTY && hs.count != 0) {
+      writeRecord(hs, flag);
+      flag = 0;
+    }
+    hs.tag = TAG_EMPTY;
+  }
+  if (flag != 0)
+    putMark(TAG_HOUR | HISTORY_MARK << 4 | HISTORY_SILENT);
+}
+
+void updateHistory(char code, byte kind, int16_t value) {
+  byte sid = sensorIndex(code);
+  if (sid >= MAX_SENSORS || (HISTORY_SENSORS & (1 << sid)) == 0)
+    return;
+  byte tag = (kind << 4) | sid;
+  HistorySlot* hs = 0;
+  for (byte i = 0; i < HISTORY_SLOTS; i++) {
+    if (historySlot[i].tag == tag) {
+      hs = &historySlot[i];
+      break;
+    }
+    if (historySlot[i].tag == TAG_EMPTY && hs == 0)
+      hs = &historySlot[i];
+  }
+  if (hs == 0)
+    return; // all slots are taken by other sensors
+  if (hs->tag != tag) {
+    hs->tag = tag;
+    hs->min = hs->max = value;
+    hs->sum = 0;
+    hs->count = 0;
+  }
+  if (hs->count == 0xff)
+    return; // keep the first 255 samples of the hour
+  if (value < hs->min)
+    hs->min = value;
+  if (value > hs->max)
+    hs->max = value;
+  hs->sum += value;
+  hs->count++;
+}
+
+// Frame: 'W' 'H' <count> <minutes since the start of the current hour> <count * 4 bytes of
+// records> <crc16 lo> <crc16 hi>. Records go from the oldest to the most recent one, the n-th
+// TAG_HOUR flag from the end starts the hour that ended n hours before the current one, unless
+// there is a boot record in between. The CRC covers everything after "WH".
+void dumpHistory() {
+  byte count = historyPos;
+  byte first = 0;
+  if (readTag(historyPos) != TAG_EMPTY) {
+    count = HISTORY_RECORDS;
+    first = historyPos;
+  }
+  byte minutes = (millis() - historyStart) / Timeout::MINUTE;
+  waitPrint();
+  Serial.write('W');
+  Serial.write('H');
+  Serial.write(count);
+  Serial.write(minutes);
+  uint16_t crc = _crc16_update(_crc16_update(0xffff, count), minutes);
+  byte i = first;
+  for (byte n = 0; n < count; n++) {
+    HistoryRecord r;
+    eeprom_read_block(&r, recordAddr(i), sizeof(r));
+    const byte* p = (const byte*)&r;
+    for (byte j = 0; j < sizeof(r); j++) {
+      Serial.write(p[j]);
+      crc = _crc16_update(crc, p[j]);
+    }
+    if (++i == HISTORY_RECORDS)
+      i = 0;
+  }
+  Serial.write(crc & 0xff);
+  Serial.write(crc >> 8);
+}
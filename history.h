@@ -0,0 +1,43 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+
+#include "snapshot.h"
+#include "derived.h"
+
+// Hourly min/max/mean history is kept in a circular EEPROM log between snapshots and the filter.
+// The log starts with a 2-byte layout mark, then come 4-byte records, 160 of them keep 6.7 days
+// for one sensor. The first record of every hour is flagged and an hour without readings
+// leaves a mark record, so records are placed in time by counting flags back from the end.
+// The time while the board was off is not known, a boot mark record stands for it.
+#define HISTORY_ADDR        (SNAPSHOT_ADDR + SNAPSHOT_SLOTS * SNAPSHOT_SLOT_SIZE)
+#define HISTORY_BYTES       644 // up to the filter
+#define HISTORY_RECORD_SIZE 4
+#define HISTORY_RECORDS     ((HISTORY_BYTES - 2) / HISTORY_RECORD_SIZE)
+
+// Mask of SENSOR_CODES positions that are logged (outdoor temperature channel by default)
+#ifndef HISTORY_SENSORS
+#define HISTORY_SENSORS (1 << OUTDOOR_CHANNEL)
+#endif
+
+// Max number of sensors that are logged at the same time
+#define HISTORY_SLOTS 4
+
+// Kinds of logged values, they determine 8-bit quantization in records
+#define HISTORY_TEMP 0 // 0.5 C steps from -40 C
+#define HISTORY_WIND 1 // 0.2 m/s steps
+#define HISTORY_UV   2 // UV index as is
+#define HISTORY_MARK 3 // record without values, its sensor index is one of the marks below
+
+#define HISTORY_SILENT 0 // an hour without readings
+#define HISTORY_BOOT   1 // a reset, the hours before it are older by an unknown time
+
+extern void setupHistory();
+extern void checkHistory();
+// Accumulates value (in sensor units) for the sensor with a given display code
+extern void updateHistory(char code, byte kind, int16_t value);
+// Streams the whole log as a binary frame
+extern void dumpHistory();
+
+#endif
@@ -0,0 +1,53 @@
+
+#include "latency.h"
+#include "xprint.h"
+
+extern "C" {
+#include "osrx.h"
+}
+
+// all values are in timer 1 ticks (4 usec) and are printed in usec
+unsigned long latencyLast[LAT_STAGES + 1]; // the last one is total
+unsigned long latencyMax[LAT_STAGES + 1];
+
+static void latencyPut(byte stage, unsigned long ticks) {
+  latencyLast[stage] = ticks;
+  if (ticks > latencyMax[stage])
+    latencyMax[stage] = ticks;
+}
+
+void latencyStart(LatencyTrace& t, unsigned long edgeTime) {
+  t.active = true;
+  t.origin = edgeTime;
+  t.time = edgeTime;
+}
+
+void latencyMark(LatencyTrace& t, byte stage) {
+  if (!t.active)
+    return;
+  unsigned long now = osrx_now();
+  latencyPut(stage, now - t.time);
+  t.time = now;
+}
+
+void latencyEnd(LatencyTrace& t) {
+  if (!t.active)
+    return;
+  t.active = false;
+  latencyPut(LAT_STAGES, t.time - t.origin);
+}
+
+void dumpLatency() {
+  waitPrint();
+  print_C("{L:");
+  for (byte i = 0; i <= LAT_STAGES; i++) {
+    if (i != 0)
+      Serial.print(' ');
+    Serial.print(latencyLast[i] << 2);
+  }
+  for (byte i = 0; i <= LAT_STAGES; i++) {
+    Serial.print(i == 0 ? '|' : ' ');
+    Serial.print(latencyMax[i] << 2);
+  }
+  print_C("}*\r\n");
+}
@@ -0,0 +1,30 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <Arduino.h>
+
+// Stages of received data from its last RF edge to the serial console and LCD, see pipeline.h
+#define LAT_FRAME   0 // edge capture ISR and framing up to OsRx::get_data()
+#define LAT_PARSE   1 // waiting in the frame queue and parsePacket()
+#define LAT_PACE    2 // waiting in the emit queue and for serial print pace
+#define LAT_SERIAL  3 // writing the line to serial
+#define LAT_DISPLAY 4 // waiting in the render queue and LCD update
+#define LAT_STAGES  5
+
+// Tracing state of one record of received data
+struct LatencyTrace {
+  boolean active;
+  unsigned long origin; // timer 1 ticks (4 usec)
+  unsigned long time;   // end of the last marked stage
+};
+
+// Starts tracing of received data with timestamp of its last edge (see OsRx::packet_time())
+extern void latencyStart(LatencyTrace& t, unsigned long edgeTime);
+// Marks the end of the stage, does nothing when the tracing was not started
+extern void latencyMark(LatencyTrace& t, byte stage);
+// Finishes tracing
+extern void latencyEnd(LatencyTrace& t);
+// Prints the last and maximal latencies of each stage and in total as one record
+extern void dumpLatency();
+
+#endif
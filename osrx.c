@@ -45,10 +45,14 @@
 // http://github.com/kayno/ThermorWeatherRx
 //
 
+#include <string.h>
 #include <Arduino.h>
 #include <avr/interrupt.h>
 
 #include "osrx.h"
+#include "rxstats.h"
+#include "profile.h"
+#include "rawcap.h"
 
 //
 // *** BEGIN DEFINES FOR RF PROTOCOL DECODING
@@ -59,13 +63,22 @@
 #define SET_INPUT_CAPTURE_RISING_EDGE()   (TCCR1B |=  _BV(ICES1))
 #define SET_INPUT_CAPTURE_FALLING_EDGE()  (TCCR1B &= ~_BV(ICES1))
 
+// source of the captured edge time, the benchmark build substitutes canned edges here
+#ifndef OSRX_CAPTURE_TIME
+#define OSRX_CAPTURE_TIME ICR1
+#endif
+
 // Control LED on pin 6
 #define RECEIVING_LED_PIN   6
 #define LED_ON()            digitalWrite(RECEIVING_LED_PIN, LOW);
 #define LED_OFF()           digitalWrite(RECEIVING_LED_PIN, HIGH);
 
 // macro to reset the receive state machine state
-#define WEATHER_RESET() { protocol_version = short_count = long_count = 0; rx_state = RX_STATE_IDLE; }  
+#if OSRX_PROTOCOLS & OSRX_V2
+#define WEATHER_RESET(s) { (s)->protocol_version = (s)->short_count = (s)->long_count = 0; (s)->rx_state = RX_STATE_IDLE; }  
+#else
+#define WEATHER_RESET(s) { (s)->protocol_version = (s)->short_count = 0; (s)->rx_state = RX_STATE_IDLE; }  
+#endif
 //
 // values for timer 2 control registers
 //
@@ -79,6 +92,42 @@
 #define SYNC_COUNT		               20
 // min number of long sync periods to begin a version 2.1 RF message:
 #define LONG_SYNC_COUNT              25
+//
+// Noise gate
+//
+// a cheap receiver outputs noise while nothing transmits and every edge is an invalid period.
+// after this number of invalid periods in a row, that are less than NOISE_GATE_WINDOW apart,
+// capture interrupts are masked until the next timer 2 overflow (2 msec). this loses at most
+// two bits of a preamble, which are spare for both protocols.
+#define NOISE_GATE_RUN                8
+#define NOISE_GATE_WINDOW           500 /* timer ticks, 2 msec */
+//
+// Second receiver
+//
+// with OSRX_RECEIVERS set to 2, the data line of a second receiver is connected to port D4
+// (digital 4). its edges are timed by the pin change interrupt, which reads timer 1 instead
+// of a captured value, so the interrupt latency adds to the period jitter. timer 2 is shared:
+// it runs freely while any receiver waits for the end of a message or of a noise gate and
+// every receiver checks how long ago its own last edge was.
+//
+#define RX2_PIN                     PIND
+#define RX2_BIT                     4   /* PD4, PCINT20 */
+#define RX2_PCMSK                   PCMSK2
+#define RX2_PCIE                    PCIE2
+#define RX2_PCIF                    PCIF2
+// time after the last edge that ends a message or a noise gate, longer than any valid period
+#define TIMEOUT_TICKS               400 /* timer ticks, 1.6 msec */
+//
+// Clock recovery decoder
+//
+// resyncs are how the decoder rides over a glitch, but a colliding transmission is a stream
+// of them. more than one glitch (two edges) in a bit or resyncs less than this number of bits
+// apart are an invalid period, which ends the message. a message that ends less than this
+// number of bits after a resync is cut at the resync, since the edges were most likely noise
+// after the end of the transmission and the checksum is found from the message length.
+// OsRx repairs messages with up to 8 bits lost at the end.
+//
+#define PLL_RESYNC_SPACING          8
 
 // Rx States
 #define RX_STATE_IDLE               0  /* ready to go */
@@ -94,76 +143,372 @@
 // *** RF Protocol Decoding Variables ***
 
 //
-// timer value at last edge capture event. used to compute time interval
-// between previous event and current event.
+// free-running count of timer 1 overflows. together with the timer value it gives
+// a 32-bit timestamp in timer ticks that is used to trace latency of the received data.
 //
-static unsigned int timer1_ovfl_count;
-static unsigned int previous_captured_time;
+static volatile unsigned int timer1_ovfl_total;
 //
-// value of most recently decoded bit.
+// state of the decoder of one receiver. the receive buffer is the last member, so that
+// all other members are in reach of indexed addressing from the start of the state.
 //
-static unsigned int current_bit;
+typedef struct
+{
+  //
+  // timer overflows and timer value at last edge capture event. used to compute time interval
+  // between previous event and current event.
+  //
+  unsigned int ovfl_count;
+  unsigned int previous_captured_time;
+  //
+  // timestamp of the last edge of the message that is being received.
+  //
+  unsigned long packet_end_time;
+  //
+  // value of most recently decoded bit.
+  //
+  unsigned int current_bit;
+  //
+  // receive buffer pointer 
+  // using bit fields like this is platform dependent and generally not recommended.
+  // however, since this code will never (never say never :-O ) run on anything but an Atmel processor,
+  // the risks are minimized. on the plus side, this union with bit fields makes the code
+  // cleaner and easier to understand.
+  //
+  union {
+    unsigned int value;  
+    struct 
+    {
+      unsigned int bit:2;      // two LSBs refer to a bit within the nibble
+      unsigned int nibble:14;  // 14 MSBs refer to a nibble 
+    } portion;
+  } bufptr;
+  //
+  // while looking for a valid preamble, these track the number of 
+  // short and long periods seen. for now, preambles are much less
+  // than 256 pulses long, but use 16-bit counters just to be safe
+  //
+  unsigned int short_count;
+#if OSRX_PROTOCOLS & OSRX_V2
+  unsigned int long_count;
+#endif
+
+  byte protocol_version; // protocol version of the current message
+  //
+  // for the version 2 protocol, this is used as a toggle to cause every
+  // other bit to be "dumped" -- since each bit is repeated once every
+  // other bit is not stored in the buffer.
+  //
+#if OSRX_PROTOCOLS & OSRX_V2
+  boolean dump_bit;
+#endif
+
+  byte rx_state; // current state of the receive state machine
+  //
+  // short periods must occur in pairs in a valid signal. this variable 
+  // toggles every time a short period is found and is used to 
+  // enforce this requirement. also, this lets us know that the 2nd
+  // period of a short pair has occurred -- this is one event that defines
+  // a data bit.
+  //
+  boolean previous_period_was_short;
+  //
+  // noise gate state. noise_run counts invalid periods while looking for preamble,
+  // gated is set while edge interrupts are masked and rearmed marks the first
+  // edge after the gate, whose period is meaningless.
+  //
+  byte noise_run;
+  unsigned int last_noise_time;
+  boolean gated;
+  boolean rearmed;
+  //
+  // set when edges were dropped while the received message waited for the background loop
+  //
+  boolean blocked;
+#if OSRX_DECODER == OSRX_PLL
+  //
+  // clock recovery. short periods with RF on and off are averaged over the preamble, then
+  // the half bit period (1/16 ticks) and the carrier-on shortening (ticks) are derived from them.
+  // phase is the time since the expected middle of the last bit, boundaries has a bit for
+  // each edge half a bit (bit 0) and one and a half bits (bit 1) after it, merged counts glitch
+  // edges since then, resync_wait is the number of bits until the next resync is allowed,
+  // resync_bits is the message length before the last resync and sync_rf_on is the RF level
+  // before the edge in the middle of the sync bit, a zero.
+  //
+  unsigned int short_on;
+  unsigned int short_off;
+  unsigned int half;
+  int skew;
+  int phase;
+  byte boundaries;
+  byte merged;
+  byte resync_wait;
+  byte resync_bits;
+  boolean sync_rf_on;
+#endif
+#if OSRX_RECEIVERS > 1
+  //
+  // set while the end of the message is timed by timer 2, which is shared by all receivers
+  //
+  boolean timing;
+  //
+  // input level at the last pin change, the second receiver has no edge select
+  //
+  boolean rf_on;
+#endif
+  //
+  // receive buffer
+  // only the lower nibble of each byte is used. The upper nibbles
+  // are zeroed in the reset() function and should not be modified
+  // thereafter.
+  //
+  byte packet[MAX_MSG_LEN];
+} rx_decoder;
+
+static rx_decoder decoders[OSRX_RECEIVERS];
+
+volatile RxStats rxStats;
+
+const unsigned long mm_diff = 0x7fffffffUL; 
+
 //
-// receive buffer pointer 
-// using bit fields like this is platform dependent and generally not recommended.
-// however, since this code will never (never say never :-O ) run on anything but an Atmel processor,
-// the risks are minimized. on the plus side, this union with bit fields makes the code
-// cleaner and easier to understand.
+// thresholds for short and long timer periods. the thresholds are different
+// when the RF signal is on and off. the three values in each array are, in order:
+// minimum short period, threshold between short and long periods, and maximum long period.
+// if the timer value is exactly equal to the short/long threshold it does not matter 
+// which choice is made -- this is probably a noise reading anyway. 
+// periods less then the minimum short or maximum long periods are considered noise and
+// rejected.
 //
-static union {
-  unsigned int value;  
-  struct 
+const unsigned int rf_off_thresholds[3] = { 100, 212, 350 };  // for a 4usec timer tick, 400,848,1400 usec
+const unsigned int rf_on_thresholds[3]  = {  50, 137, 275 };  // for a 4usec timer tick, 200,548,1100 usec
+
+//
+// masks edge interrupts of a receiver while its noise gate is closed
+//
+static inline void mask_edges(rx_decoder *s)
+{
+#if OSRX_RECEIVERS > 1
+  if (s != decoders)
+  {
+    RX2_PCMSK &= ~_BV(RX2_BIT);
+    return;
+  }
+#endif
+  TIMSK1 &= ~_BV(ICIE1);
+}
+
+static inline void unmask_edges(rx_decoder *s)
+{
+#if OSRX_RECEIVERS > 1
+  if (s != decoders)
   {
-    unsigned int bit:2;      // two LSBs refer to a bit within the nibble
-    unsigned int nibble:14;  // 14 MSBs refer to a nibble 
-  } portion;
-} bufptr;
+    s->rf_on = (RX2_PIN & _BV(RX2_BIT)) != 0;
+    PCIFR = _BV(RX2_PCIF); // drop pin change while the gate was closed
+    RX2_PCMSK |= _BV(RX2_BIT);
+    return;
+  }
+#endif
+  TIFR1 = _BV(ICF1); // drop edge captured while the gate was closed
+  TIMSK1 |= _BV(ICIE1);
+}
+
 //
-// receive buffer
-// only the lower nibble of each byte is used. The upper nibbles
-// are zeroed in the reset() function and should not be modified
-// thereafter.
+// starts timer 2 for a timeout after the last edge of a receiver. with several receivers
+// the timer is not restarted while another receiver waits for it.
 //
-static byte packet[MAX_MSG_LEN];
+static inline void start_timeout(rx_decoder *s)
+{
+#if OSRX_RECEIVERS > 1
+  byte i;
+  for (i = 0; i < OSRX_RECEIVERS; i++)
+  {
+    rx_decoder *r = &decoders[i];
+    if (r != s && (r->timing || r->gated))
+    {
+      TIMSK2 = PULSE_TIMEOUT_ENABLE;
+      return;
+    }
+  }
+#endif
+  TCNT2 = 0;
+  TIFR2 = _BV(TOV2); // writing one clears overflow flag that was set while the timer was not used
+  TIMSK2 = PULSE_TIMEOUT_ENABLE;
+}
+
 //
-// while looking for a valid preamble, these track the number of 
-// short and long periods seen. for now, preambles are much less
-// than 256 pulses long, but use 16-bit counters just to be safe
+// counts invalid period and closes the noise gate after a run of them, timer 2 opens it again
 //
-static unsigned int short_count;
-static unsigned int long_count;
+static inline void count_noise(rx_decoder *s, unsigned int t)
+{
+  if ((uint16_t)(t - s->last_noise_time) > NOISE_GATE_WINDOW)
+    s->noise_run = 0;
+  s->last_noise_time = t;
+  if (s->noise_run < NOISE_GATE_RUN)
+    s->noise_run++;
+  if (s->noise_run == NOISE_GATE_RUN)
+  {
+    mask_edges(s);
+    s->gated = true;
+    RX_STAT_INC(rxStats.gates);
+    start_timeout(s);
+  }
+}
 
-static byte protocol_version; // protocol version of the current message
 //
-// for the version 2 protocol, this is used as a toggle to cause every
-// other bit to be "dumped" -- since each bit is repeated once every
-// other bit is not stored in the buffer.
+// end of the noise gate. the noise run is not reset, so that the gate closes again
+// on the next invalid period if the noise goes on.
 //
-static boolean dump_bit;
+static inline void end_gate(rx_decoder *s)
+{
+  s->gated = false;
+  s->rearmed = true;
+  s->last_noise_time = TCNT1;
+  unmask_edges(s);
+}
 
-static byte rx_state; // current state of the receive state machine
+#if OSRX_DECODER == OSRX_PLL
 //
-// short periods must occur in pairs in a valid signal. this variable 
-// toggles every time a short period is found and is used to 
-// enforce this requirement. also, this lets us know that the 2nd
-// period of a short pair has occurred -- this is one event that defines
-// a data bit.
+// averages short periods of the preamble by RF level, the first one of each level is taken as is
 //
-static boolean previous_period_was_short = false;
+static inline void pll_preamble(rx_decoder *s, unsigned int period, boolean rf_was_on)
+{
+  unsigned int *avg = rf_was_on ? &s->short_on : &s->short_off;
+  if (s->short_count < 2)
+    *avg = period;
+  else
+    *avg += ((int)period - (int)*avg) >> 2;
+}
 
-const unsigned long mm_diff = 0x7fffffffUL; 
+//
+// starts the clock at the edge in the middle of the sync bit
+//
+static inline void pll_start(rx_decoder *s, boolean rf_was_on)
+{
+  s->half = (s->short_on + s->short_off) << 3;
+  s->skew = ((int)s->short_off - (int)s->short_on) >> 1;
+  s->phase = 0;
+  s->boundaries = 0;
+  s->merged = 0;
+  s->resync_wait = 0;
+  s->sync_rf_on = rf_was_on;
+}
 
 //
-// thresholds for short and long timer periods. the thresholds are different
-// when the RF signal is on and off. the three values in each array are, in order:
-// minimum short period, threshold between short and long periods, and maximum long period.
-// if the timer value is exactly equal to the short/long threshold it does not matter 
-// which choice is made -- this is probably a noise reading anyway. 
-// periods less then the minimum short or maximum long periods are considered noise and
-// rejected.
+// appends a message bit
 //
-const unsigned int rf_off_thresholds[3] = { 100, 212, 350 };  // for a 4usec timer tick, 400,848,1400 usec
-const unsigned int rf_on_thresholds[3]  = {  50, 137, 275 };  // for a 4usec timer tick, 200,548,1100 usec
+static inline void pll_store(rx_decoder *s, byte bit)
+{
+  if (s->bufptr.value >= (MAX_MSG_LEN << 2))
+    return; // overflow is counted after the edge
+  if (bit)
+    s->packet[s->bufptr.portion.nibble] |= 1 << s->bufptr.portion.bit;
+  else
+    s->packet[s->bufptr.portion.nibble] &= ~(1 << s->bufptr.portion.bit);
+  s->bufptr.value++;
+  s->current_bit = bit;
+}
+
+//
+// counts a resync unless the previous one was too recent, see PLL_RESYNC_SPACING
+//
+static inline boolean pll_resync(rx_decoder *s)
+{
+  if (s->resync_wait != 0)
+    return false;
+  s->resync_wait = PLL_RESYNC_SPACING;
+  s->resync_bits = s->bufptr.value;
+  RX_STAT_INC(rxStats.resyncs);
+  return true;
+}
+
+//
+// cuts the message at a recent resync when it ends, see PLL_RESYNC_SPACING
+//
+static inline void pll_end(rx_decoder *s)
+{
+  if (s->rx_state == RX_STATE_RECEIVING_V3 && s->resync_wait != 0)
+    s->bufptr.value = s->resync_bits;
+}
+
+//
+// clock recovery decoder of V3 message bits. every bit has an edge in its middle, whose direction
+// gives the bit, and an edge at its start when it is the same as the previous bit. edges are
+// placed in half bits from the expected middle of the last bit:
+//
+//   1, 3 -- bit boundary, remembered
+//   2    -- middle of the next bit
+//   4    -- middle of the bit after next, the middle of the next bit was lost and the next bit
+//           is the same as the last one when there was an edge at the boundary between them
+//   0    -- glitch, merged into the bit, as are repeated boundaries
+//   5+   -- invalid period, ends the message like in the classifying decoder
+//
+// the edges in the middle of bits pull the phase by half of their error and the period by 1/8 of it.
+// returns false on invalid period, see PLL_RESYNC_SPACING.
+//
+static inline boolean pll_edge(rx_decoder *s, unsigned int period, boolean rf_was_on)
+{
+  unsigned int h = s->half >> 4;
+  if (period > 5 * h)
+    return false;
+  // the carrier-on shortening is taken off both edges of an on pulse, so corrections add up to zero
+  int x = s->phase + (rf_was_on ? (int)period + s->skew : (int)period - s->skew);
+  int t = h >> 1;
+  byte n = 0;
+  while (x >= t)
+  {
+    if (++n == 5)
+      return false;
+    t += h;
+  }
+  if (n == 0 || (n & 1))
+  {
+    byte b = n == 0 ? 0 : n == 1 ? 1 : 2;
+    if (b == 0 || (s->boundaries & b))
+    {
+      if (s->merged == 2 || (s->merged == 0 && !pll_resync(s)))
+        return false;
+      s->merged++;
+    }
+    s->boundaries |= b;
+    s->phase = x;
+    return true;
+  }
+  int e = x - (int)(n * h);
+  byte bit = rf_was_on != s->sync_rf_on;
+  if (n == 4)
+  {
+    if (s->merged == 0 && !pll_resync(s))
+      return false;
+    pll_store(s, (s->boundaries & 1) ? s->current_bit : !s->current_bit);
+    e >>= 1; // the error per bit
+  }
+  pll_store(s, bit);
+  s->half += e;
+  s->phase = e >> 1;
+  s->boundaries = 0;
+  s->merged = 0;
+  if (s->resync_wait != 0)
+    s->resync_wait--;
+  return true;
+}
+#endif
+
+//
+// signals the received message when there are enough bits
+//
+static inline void end_message(rx_decoder *s)
+{
+#if OSRX_DECODER == OSRX_PLL
+  pll_end(s);
+#endif
+  boolean receiving = (s->rx_state == RX_STATE_RECEIVING_V2) || (s->rx_state == RX_STATE_RECEIVING_V3);
+  if (receiving && s->bufptr.value > 40)
+  { 
+    s->rx_state = RX_STATE_PACKET_RECEIVED;
+    RX_STAT_INC(rxStats.packets);
+    PROFILE_PACKET();
+  }
+}
 //
 // Overflow interrupt routine for timer 2
 // When the last bit of a message has been received by the event capture ISR, the state machine will just 
@@ -174,13 +519,45 @@ const unsigned int rf_on_thresholds[3]  = {  50, 137, 275 };  // for a 4usec tim
 //
 ISR(TIMER2_OVF_vect)
 {
+  PROFILE_ISR_ENTER();
   TIMSK2 =  PULSE_TIMEOUT_DISABLE; // disable further interrupts
   TIFR2 = 0; // this may be redundant -- the interrupt is probably cleared automatically for us
-  boolean rx_state = (rx_state == RX_STATE_RECEIVING_V2) || (rx_state == RX_STATE_RECEIVING_V3);
-  if (rx_state && bufptr.value > 40)
-  { 
-    rx_state = RX_STATE_PACKET_RECEIVED;
+#if OSRX_RECEIVERS > 1
+  // the timer was not restarted by the edges of every receiver, so each one checks its own
+  // last edge and the timer goes on while any of them is still waiting
+  unsigned int now = TCNT1;
+  boolean waiting = false;
+  byte i;
+  for (i = 0; i < OSRX_RECEIVERS; i++)
+  {
+    rx_decoder *s = &decoders[i];
+    if (s->gated)
+    {
+      if ((uint16_t)(now - s->last_noise_time) >= TIMEOUT_TICKS)
+        end_gate(s);
+      else
+        waiting = true;
+    }
+    if (s->timing)
+    {
+      if ((uint16_t)(now - (uint16_t)s->packet_end_time) >= TIMEOUT_TICKS)
+      {
+        s->timing = false;
+        end_message(s);
+      }
+      else
+        waiting = true;
+    }
   }
+  if (waiting)
+    TIMSK2 = PULSE_TIMEOUT_ENABLE;
+#else
+  rx_decoder *s = decoders;
+  if (s->gated)
+    end_gate(s);
+  end_message(s);
+#endif
+  PROFILE_ISR_EXIT(timeout);
 }
 //
 // Overflow interrupt vector
@@ -190,18 +567,33 @@ ISR(TIMER2_OVF_vect)
 //
 ISR(TIMER1_OVF_vect)
 {
-  timer1_ovfl_count++;
+  byte i;
+  for (i = 0; i < OSRX_RECEIVERS; i++)
+    decoders[i].ovfl_count++;
+  timer1_ovfl_total++;
 }
 
 //
-// Event capture interrupt routine for timer 1. 
+// extends 16-bit timer 1 value to 32 bits. must be called with interrupts disabled.
+// when the timer has overflowed, but the overflow ISR did not run yet, then small
+// timer values are already past the overflow.
+//
+static unsigned long extend_timer1(unsigned int t)
+{
+  unsigned int ovfl = timer1_ovfl_total;
+  if ((TIFR1 & _BV(TOV1)) && t < 0x8000)
+    ovfl++;
+  return ((unsigned long)ovfl << 16) | t;
+}
+
+//
+// Edge decoder of a receiver, called from its edge interrupt routine.
 // This is the heart of RF protocol decoding.
 //
-// This is fired every time the received RF signal goes on or off. Since every 
-// transition (up or down) is followed by an opposite transition (down or up), the edge detection
-// bit for the timer is flipped with every transition.
+// This is fired every time the received RF signal goes on or off with the time of the edge
+// and the RF level before it.
 //
-// Decoding of the Manchester-coded ASK is performed in this ISR. The technique works by
+// Decoding of the Manchester-coded ASK is performed here. The technique works by
 // examining the time between adjacent RF transitions. This is easy to do using the Atmel
 // processor's "timer 1" which has an input specifically designed to detect the timing of transitions
 // on input bit 0 of port B. This input even has a de-glitching feature which helps to filter
@@ -228,24 +620,10 @@ ISR(TIMER1_OVF_vect)
 // In fact, RF transmissions from OS units do not have a 50% duty cycle so the definition of
 // short and long bit periods are a bit skewed.
 //
-ISR(TIMER1_CAPT_vect)
+static inline void receive_edge(rx_decoder *s, unsigned int captured_time, boolean rf_was_on)
 { 
-  // do the time-sensitive things first
-  TIMSK2 = PULSE_TIMEOUT_DISABLE;
-  unsigned int ovfl = timer1_ovfl_count;
-  timer1_ovfl_count = 0;
-  // grab the event time
-  unsigned int captured_time = ICR1;
-  //
-  // depending on which edge (rising/falling) caused this interrupt, setup to receive the opposite
-  // edge (falling/rising) as the next event.
-  //
-  boolean rf_was_on = INPUT_CAPTURE_IS_FALLING_EDGE();
-
-  if(!rf_was_on)
-    SET_INPUT_CAPTURE_FALLING_EDGE();
-  else 
-    SET_INPUT_CAPTURE_RISING_EDGE();
+  unsigned int ovfl = s->ovfl_count;
+  s->ovfl_count = 0;
   //
   // detect and deal with timer overflows. the timer will overflow about once every
   // 0.26 seconds so it is not all that rare of an occurance. as long as there has only been 
@@ -276,18 +654,18 @@ ISR(TIMER1_CAPT_vect)
     // a period that long. the overflow ISR will force the rx state back to IDLE, which does
     // not care about the result of this calculation.
     //
-    if (captured_time < previous_captured_time)
+    if (captured_time < s->previous_captured_time)
     {
       // do the math using signed 32-bit integers, but convert the result back to a 16-bit integer
-      captured_period = (unsigned int)((long)captured_time + 0x10000L - (long)previous_captured_time);    
+      captured_period = (unsigned int)((long)captured_time + 0x10000L - (long)s->previous_captured_time);    
     }
     else
     {
-      captured_period = captured_time - previous_captured_time;
+      captured_period = captured_time - s->previous_captured_time;
     }
   }
 
-  unsigned int *thresholds = rf_was_on ? rf_on_thresholds : rf_off_thresholds;
+  const unsigned int *thresholds = rf_was_on ? rf_on_thresholds : rf_off_thresholds;
   boolean short_period = false;
   boolean long_period = false;
   if ((captured_period >= thresholds[0]) && (captured_period <= thresholds[1]))
@@ -302,7 +680,12 @@ ISR(TIMER1_CAPT_vect)
     }
   }
 
-  switch (rx_state)
+  if (s->rearmed)
+  {
+    // first edge after the noise gate, it only starts a new period
+    s->rearmed = false;
+  }
+  else switch (s->rx_state)
   {
   case RX_STATE_IDLE:
     //
@@ -321,56 +704,84 @@ ISR(TIMER1_CAPT_vect)
     //
     if (short_period)
     {
-      if ((short_count <= 1) && (long_count > LONG_SYNC_COUNT))
+#if OSRX_PROTOCOLS & OSRX_V2
+      if ((s->short_count <= 1) && (s->long_count > LONG_SYNC_COUNT))
       {
-        protocol_version = 2;
-        dump_bit = false; //true;
-        rx_state = RX_STATE_RECEIVING_V2;
-        previous_period_was_short = true;
+        s->protocol_version = 2;
+        s->dump_bit = false; //true;
+        s->rx_state = RX_STATE_RECEIVING_V2;
+        s->previous_period_was_short = true;
         // this is actually the first bit, which is always a one so record it.
         // it will be repeated, so take that into account also
-        bufptr.value = 0;
-        packet[0] = 0;
-        current_bit = BIT_ONE;        
+        s->bufptr.value = 0;
+        s->packet[0] = 0;
+        s->current_bit = BIT_ONE;        
       }
-      else if (long_count == 0)
+      else if (s->long_count == 0)
+#endif
       {
-        short_count++;  
+#if OSRX_DECODER == OSRX_PLL
+        pll_preamble(s, captured_period, rf_was_on);
+#endif
+        s->short_count++;  
       }
+#if OSRX_PROTOCOLS & OSRX_V2
       else
       {
-        WEATHER_RESET();
+        RX_STAT_INC(rxStats.preambleMiss);
+        count_noise(s, captured_time);
+        WEATHER_RESET(s);
       }
+#endif
     }
     else if (long_period)
     { 
-      if(short_count > SYNC_COUNT) 
+#if OSRX_PROTOCOLS & OSRX_V3
+      if(s->short_count > SYNC_COUNT) 
       {
-        rx_state = RX_STATE_RECEIVING_V3;
-        protocol_version = 3;
-        previous_period_was_short = false;
+        s->rx_state = RX_STATE_RECEIVING_V3;
+        s->protocol_version = 3;
+        s->previous_period_was_short = false;
         // this is actually the first bit, which is always a zero so record it.
-        bufptr.value = 1;
-        packet[0] = 0;
-        current_bit = BIT_ZERO;
+        s->bufptr.value = 1;
+        s->packet[0] = 0;
+        s->current_bit = BIT_ZERO;
+#if OSRX_DECODER == OSRX_PLL
+        pll_start(s, rf_was_on);
+#endif
         // LED_ON();
       } 
-      else if (short_count <= 1)
+      else
+#endif
+#if OSRX_PROTOCOLS & OSRX_V2
+      if (s->short_count <= 1)
       {
-        long_count++;
+        s->long_count++;
       }
       else 
+#endif
       {
-        WEATHER_RESET();
+        RX_STAT_INC(rxStats.preambleMiss);
+        count_noise(s, captured_time);
+        WEATHER_RESET(s);
       }
     } 
     else 
     {
-      WEATHER_RESET();
+      RX_STAT_INC(rxStats.noise);
+      count_noise(s, captured_time);
+      WEATHER_RESET(s);
     }
     break;
 
+#if OSRX_PROTOCOLS & OSRX_V3
   case RX_STATE_RECEIVING_V3:  
+#if OSRX_DECODER == OSRX_PLL
+    if (pll_edge(s, captured_period, rf_was_on))
+    {
+      // the edge was placed against the recovered clock
+    }
+#else
     //
     // while receiving message bits, examine the time between this RF transition and the 
     // previous one. there are three possibilities, a "short" period, a "long" period, 
@@ -383,18 +794,18 @@ ISR(TIMER1_CAPT_vect)
     //
     if (short_period)
     { 
-      if(previous_period_was_short) 
+      if(s->previous_period_was_short) 
       {      
-        if(current_bit)
-          packet[bufptr.portion.nibble] |= 1 << bufptr.portion.bit;          
+        if(s->current_bit)
+          s->packet[s->bufptr.portion.nibble] |= 1 << s->bufptr.portion.bit;          
         else 
-          packet[bufptr.portion.nibble] &= ~(1 << bufptr.portion.bit);
+          s->packet[s->bufptr.portion.nibble] &= ~(1 << s->bufptr.portion.bit);
 
-        bufptr.value++;
-        previous_period_was_short = false;
+        s->bufptr.value++;
+        s->previous_period_was_short = false;
       } 
       else 
-        previous_period_was_short = true;
+        s->previous_period_was_short = true;
     }
     //
     // long periods convey a single transmitted bit each. in this case the transmitted bit
@@ -402,20 +813,22 @@ ISR(TIMER1_CAPT_vect)
     //
     else if (long_period)
     {
-      if (previous_period_was_short)
+      if (s->previous_period_was_short)
       {
-        WEATHER_RESET();       
+        RX_STAT_INC(rxStats.bitErrors);
+        WEATHER_RESET(s);       
       }
 
-      current_bit = 1 - current_bit;
+      s->current_bit = 1 - s->current_bit;
 
-      if(current_bit) 
-        packet[bufptr.portion.nibble] |=  (0x01 << bufptr.portion.bit);
+      if(s->current_bit) 
+        s->packet[s->bufptr.portion.nibble] |=  (0x01 << s->bufptr.portion.bit);
       else 
-        packet[bufptr.portion.nibble] &= ~(0x01 << bufptr.portion.bit);
+        s->packet[s->bufptr.portion.nibble] &= ~(0x01 << s->bufptr.portion.bit);
 
-      bufptr.value++;
+      s->bufptr.value++;
     }
+#endif
     //
     // transition periods outside the valid ranges for long or short periods occur in two
     // situations: (a) a new message has begun before timer2 can produce a timeout to end
@@ -426,13 +839,25 @@ ISR(TIMER1_CAPT_vect)
     //
     else
     {
-      if (bufptr.value > 40) 
-        rx_state = RX_STATE_PACKET_RECEIVED;
+#if OSRX_DECODER == OSRX_PLL
+      pll_end(s);
+#endif
+      if (s->bufptr.value > 40) 
+      {
+        s->rx_state = RX_STATE_PACKET_RECEIVED;
+        RX_STAT_INC(rxStats.packets);
+        PROFILE_PACKET();
+      }
       else
-        WEATHER_RESET();
+      {
+        RX_STAT_INC(rxStats.bitErrors);
+        WEATHER_RESET(s);
+      }
     }
     break;
+#endif
 
+#if OSRX_PROTOCOLS & OSRX_V2
   case RX_STATE_RECEIVING_V2:  
     //
     // while receiving message bits, examine the time between this RF transition and the 
@@ -446,32 +871,33 @@ ISR(TIMER1_CAPT_vect)
     //
     if (short_period)
     { 
-      if(previous_period_was_short) 
+      if(s->previous_period_was_short) 
       {      
-        current_bit = 1 - current_bit;
-        if (dump_bit)
+        s->current_bit = 1 - s->current_bit;
+        if (s->dump_bit)
         {
           // V2 protocol sends bits in pairs. The fact that there are these
           // repeated bits means that the dumped bit must always be the same as the previous bit.
           // A short pair flips the bit, and the following bit must be the same -- this implies
           // that a pair of short periods must always be followed by a long period. If two pairs
           // of short pulses occur together, the bits won't be repeated; this is an error.
-          WEATHER_RESET();
+          RX_STAT_INC(rxStats.bitErrors);
+          WEATHER_RESET(s);
         }
         else
         {
-          if(current_bit) 
-            packet[bufptr.portion.nibble] |=  (0x01 << bufptr.portion.bit);
+          if(s->current_bit) 
+            s->packet[s->bufptr.portion.nibble] |=  (0x01 << s->bufptr.portion.bit);
           else
-            packet[bufptr.portion.nibble] &= ~(0x01 << bufptr.portion.bit);
+            s->packet[s->bufptr.portion.nibble] &= ~(0x01 << s->bufptr.portion.bit);
 
-          bufptr.value++;
-          dump_bit = true; // dump the next bit -- it s/b a repeat of this one
+          s->bufptr.value++;
+          s->dump_bit = true; // dump the next bit -- it s/b a repeat of this one
         }
-        previous_period_was_short = false;
+        s->previous_period_was_short = false;
       } 
       else 
-        previous_period_was_short = true;
+        s->previous_period_was_short = true;
     }
     //
     // long periods convey a single transmitted bit each. in this case the transmitted bit
@@ -483,28 +909,29 @@ ISR(TIMER1_CAPT_vect)
       // short periods must appear in pairs. if "previous_period_was_short" is true, then this long period was
       // preceeded by a single short period -- this is an error.
       //
-      if (previous_period_was_short)
+      if (s->previous_period_was_short)
       {
-        WEATHER_RESET();       
+        RX_STAT_INC(rxStats.bitErrors);
+        WEATHER_RESET(s);       
       }      
 
-      if (dump_bit)
+      if (s->dump_bit)
       {
         //
         // here, the current bit is identical to the previous bit -- this meets
         // the repeated-bit criteria.
         //
-        dump_bit = false;
+        s->dump_bit = false;
       }
       else
       {  
-        if(current_bit) 
-          packet[bufptr.portion.nibble] |=  (0x01 << bufptr.portion.bit);
+        if(s->current_bit) 
+          s->packet[s->bufptr.portion.nibble] |=  (0x01 << s->bufptr.portion.bit);
         else
-          packet[bufptr.portion.nibble] &= ~(0x01 << bufptr.portion.bit);
+          s->packet[s->bufptr.portion.nibble] &= ~(0x01 << s->bufptr.portion.bit);
 
-        bufptr.value++;
-        dump_bit = true; // dump the next bit -- it s/b a repeat
+        s->bufptr.value++;
+        s->dump_bit = true; // dump the next bit -- it s/b a repeat
       }
 
     }
@@ -518,49 +945,124 @@ ISR(TIMER1_CAPT_vect)
     //
     else
     {
-      if (bufptr.value > 40) 
-        rx_state = RX_STATE_PACKET_RECEIVED;
+      if (s->bufptr.value > 40) 
+      {
+        s->rx_state = RX_STATE_PACKET_RECEIVED;
+        RX_STAT_INC(rxStats.packets);
+        PROFILE_PACKET();
+      }
       else
-        WEATHER_RESET();
+      {
+        RX_STAT_INC(rxStats.bitErrors);
+        WEATHER_RESET(s);
+      }
     }
     break;
+#endif
 
   case RX_STATE_PACKET_RECEIVED:
   default:
     // this most often will happen when a new message begins before the background loop has
     // had a chance to read the current message. in this situation, we just let the new message
     // bits go into the bit bucket...
+    s->blocked = true;
     break;
   }
 
-  previous_captured_time = captured_time;
+  s->previous_captured_time = captured_time;
 
   // guard against buffer overflows this could happen if two messages overlap
   // just right -- probably very rare.
-  if (bufptr.value >= (MAX_MSG_LEN << 2))
+  if (s->bufptr.value >= (MAX_MSG_LEN << 2))
   {
-    WEATHER_RESET();
+    RX_STAT_INC(rxStats.overflows);
+    WEATHER_RESET(s);
+    s->bufptr.value = 0; // or this check resets the preamble on every next edge
   }
 
-  if ((rx_state == RX_STATE_RECEIVING_V3) || (rx_state == RX_STATE_RECEIVING_V2)) 
+  if ((s->rx_state == RX_STATE_RECEIVING_V3) || (s->rx_state == RX_STATE_RECEIVING_V2)) 
   {
+    // remember the time of the latest message edge for latency tracing
+    s->packet_end_time = extend_timer1(captured_time);
     // when waiting for another transition, set timer 2 for a timeout
     // in case we have reached the end of the message
-    TCNT2 = 0;
-    TIFR2 = 0;
-    TIMSK2 = PULSE_TIMEOUT_ENABLE;
+#if OSRX_RECEIVERS > 1
+    s->timing = true;
+#endif
+    start_timeout(s);
   }
+}
 
+//
+// Event capture interrupt routine for timer 1, the edges of the first receiver.
+//
+// Since every transition (up or down) is followed by an opposite transition (down or up),
+// the edge detection bit for the timer is flipped with every transition.
+//
+ISR(TIMER1_CAPT_vect)
+{ 
+  // do the time-sensitive things first
+  PROFILE_ISR_ENTER();
+  unsigned int isr_start = TCNT1;
+#if OSRX_RECEIVERS == 1
+  TIMSK2 = PULSE_TIMEOUT_DISABLE;
+#endif
+  // grab the event time
+  unsigned int captured_time = OSRX_CAPTURE_TIME;
+  rxStats.edges++;
+  //
+  // depending on which edge (rising/falling) caused this interrupt, setup to receive the opposite
+  // edge (falling/rising) as the next event.
+  //
+  boolean rf_was_on = INPUT_CAPTURE_IS_FALLING_EDGE();
+
+  if(!rf_was_on)
+    SET_INPUT_CAPTURE_FALLING_EDGE();
+  else 
+    SET_INPUT_CAPTURE_RISING_EDGE();
+
+  RAW_CAPTURE(extend_timer1(captured_time), !rf_was_on);
+  receive_edge(decoders, captured_time, rf_was_on);
+  rxStats.isrTicks += (uint16_t)(TCNT1 - isr_start);
+  PROFILE_ISR_EXIT(capture);
+}
+
+#if OSRX_RECEIVERS > 1
+//
+// Pin change interrupt routine for the second receiver. there is no edge select and no
+// captured time, so the level is read from the pin and the time from the timer. when a
+// pulse is shorter than the interrupt latency, the level did not change and both of its
+// edges are lost.
+//
+ISR(PCINT2_vect)
+{
+  PROFILE_ISR_ENTER();
+  unsigned int captured_time = TCNT1;
+  rx_decoder *s = &decoders[1];
+  boolean rf_on = (RX2_PIN & _BV(RX2_BIT)) != 0;
+  if (rf_on != s->rf_on)
+  {
+    s->rf_on = rf_on;
+    rxStats.edges++;
+    receive_edge(s, captured_time, !rf_on);
+    rxStats.isrTicks += (uint16_t)(TCNT1 - captured_time);
+  }
+  PROFILE_ISR_EXIT(capture);
 }
+#endif
 
 
 void osrx_init()
 {
-  int i;
-  // we never write to the high nibble of packet[] elements so clear them all now.
-  for (i=0; i<MAX_MSG_LEN; packet[i++] = 0);
+  byte r;
+  for (r=0; r<OSRX_RECEIVERS; r++)
+  {
+    rx_decoder *s = &decoders[r];
+    // we never write to the high nibble of packet[] elements so clear them all now.
+    memset(s->packet, 0, MAX_MSG_LEN);
 
-  WEATHER_RESET();
+    WEATHER_RESET(s);
+  }
 
   // 
   // configure ports:
@@ -598,31 +1100,61 @@ void osrx_init()
   TCCR2B = T2_PRESCALE_X128;  // select clk/128. 8-bit timer will overflow every 2 msec
   TCNT2 = 0;  // clear the timer count
   TIMSK2 = PULSE_TIMEOUT_DISABLE; // interrupts are disabled to start with...
+#if OSRX_RECEIVERS > 1
+  //
+  // enable pin change interrupt for the DATA line of the second receiver
+  //
+  decoders[1].rf_on = (RX2_PIN & _BV(RX2_BIT)) != 0;
+  RX2_PCMSK |= _BV(RX2_BIT);
+  PCIFR = _BV(RX2_PCIF);
+  PCICR |= _BV(RX2_PCIE);
+#endif
 }
 
-boolean osrx_data_available()
+boolean osrx_data_available(byte rx)
 {
-  return rx_state == RX_STATE_PACKET_RECEIVED;
+  return decoders[rx].rx_state == RX_STATE_PACKET_RECEIVED;
 }
 
-byte get_osrx_data(byte *buffer, byte length, byte *protocol)
+byte get_osrx_data(byte rx, byte *buffer, byte length, byte *protocol)
 {
-  if (rx_state != RX_STATE_PACKET_RECEIVED) return 0;
-  *protocol = protocol_version;
-  if (bufptr.portion.bit != 0)
+  rx_decoder *s = &decoders[rx];
+  if (s->rx_state != RX_STATE_PACKET_RECEIVED) return 0;
+  *protocol = s->protocol_version;
+  if (s->bufptr.portion.bit != 0)
   {
     // bump up to an even multiple of 4 bits
-    bufptr.value += 4 - bufptr.portion.bit;
+    s->bufptr.value += 4 - s->bufptr.portion.bit;
   }
-  byte cnt = bufptr.portion.nibble;
+  byte cnt = s->bufptr.portion.nibble;
   if (length < cnt) return 0;
-  memcpy(buffer, packet, cnt);
+  memcpy(buffer, s->packet, cnt);
   return cnt;
 }
 
-void start_receiving()
+unsigned long get_osrx_packet_time(byte rx)
 {
-  if (rx_state != RX_STATE_PACKET_RECEIVED) return;
-  WEATHER_RESET();
+  return decoders[rx].packet_end_time;
+}
+
+unsigned long osrx_now()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned long now = extend_timer1(TCNT1);
+  SREG = oldSREG;
+  return now;
+}
+
+void start_receiving(byte rx)
+{
+  rx_decoder *s = &decoders[rx];
+  if (s->rx_state != RX_STATE_PACKET_RECEIVED) return;
+  if (s->blocked)
+  {
+    RX_STAT_INC(rxStats.blocked);
+    s->blocked = false;
+  }
+  WEATHER_RESET(s);
 }
 
@@ -17,6 +17,41 @@
 //
 //=============================================================================
 
+#ifndef OSRX_H
+#define OSRX_H
+
+//
+// protocols to decode. the decoder carries only the code and state needed for
+// the selected ones, e.g. build with -DOSRX_PROTOCOLS=OSRX_V3 for V3 sensors only.
+//
+#define OSRX_V2 1
+#define OSRX_V3 2
+
+#ifndef OSRX_PROTOCOLS
+#define OSRX_PROTOCOLS (OSRX_V2 | OSRX_V3)
+#endif
+
+//
+// decoder of V3 message bits. OSRX_CLASSIFY takes every period as short or long against fixed
+// thresholds and drops the message on any other period. OSRX_PLL recovers the bit clock from
+// the preamble and places every edge against it, so that glitches are merged into the bit and
+// a lost edge in the middle of a bit is split out, e.g. build with -DOSRX_DECODER=OSRX_PLL.
+//
+#define OSRX_CLASSIFY 0
+#define OSRX_PLL      1
+
+#ifndef OSRX_DECODER
+#define OSRX_DECODER OSRX_CLASSIFY
+#endif
+
+//
+// number of receivers. the first one is on ICP1 (digital 8), the second one on PD4 (digital 4)
+// with the pin change interrupt. every receiver has its own decoder state and messages.
+//
+#ifndef OSRX_RECEIVERS
+#define OSRX_RECEIVERS 1
+#endif
+
 // Maximum number of nibbles in a message. Determines buffer size.
 // maximum message length in bits is four times this value
 #define MAX_MSG_LEN                 64 
@@ -30,6 +65,13 @@
 #define MILLIS_CMP(a,b) ( (a==b) ? 0 : ( (a>b) ? (((a-b)>mm_diff) ? -1 : 1) : (((b-a)>mm_diff) ? 1 : -1) ) )
 
 extern void osrx_init();
-extern boolean osrx_data_available();
-extern byte get_osrx_data(byte *buffer, byte length, byte *protocol);
-extern void start_receiving();
+// the functions below take a receiver number from 0 to OSRX_RECEIVERS - 1
+extern boolean osrx_data_available(byte rx);
+extern byte get_osrx_data(byte rx, byte *buffer, byte length, byte *protocol);
+extern void start_receiving(byte rx);
+// timestamp of the last edge of the received message in timer 1 ticks (4 usec)
+extern unsigned long get_osrx_packet_time(byte rx);
+// current time in timer 1 ticks (4 usec)
+extern unsigned long osrx_now();
+
+#endif
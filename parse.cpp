@@ -3,8 +3,15 @@
 #include "parse.h"
 #include "display.h"
 #include "fmt_util.h"
+#include "derived.h"
+#include "wstats.h"
+#include "history.h"
+#include "rxstats.h"
+#include "sensors.h"
+#include "Timeout.h"
 
 #define WIND_DIR_LEN 3
+#define OUTDOOR_TIMEOUT (10 * 60000L) // 10 min
 
 // used for fast generation of ASCII hex strings
 const char STS_CHARS[17] PROGMEM = " ghijklmnoabcdef";
@@ -21,6 +28,19 @@ const char sUVLT[] PROGMEM = "U: --          !";
 const char sWIND[] PROGMEM = "W: --- --- d-- !";
 // POSITIONS                  0123456789012345
 
+// 2m and 10m are average, direction and gust over 1.5-2 and 9.5-10 minutes (see wstats.h)
+// POSITIONS                  0123456789012345678901234567890123456789
+const char xTEMP[] PROGMEM = "dp +??.? hx +??.?";
+const char xRAIN[] PROGMEM = "1h ?????? 24h ??????";
+const char xWIND[] PROGMEM = "2m ??? ??? ??? 10m ??? ??? ??? wc +??.?";
+
+static_assert(sizeof(xWIND) <= EXTRA_LENGTH + 1, "xWIND does not fit into extraBuf");
+// POSITIONS                  0123456789012345678901234567890123456789
+
+// last temperature from OUTDOOR_CHANNEL for wind chill
+int outdoorTemp;
+Timeout outdoorTimeout;
+
 void parseStatus(byte* packet) {
   displayBuf[15] = pgm_read_byte_near(STS_CHARS + packet[7]);
 }
@@ -31,7 +51,7 @@ void parseUnkn(byte* packet, byte len) {
     displayBuf[3 + i] = i < len ? HEX_CHARS[packet[i]] : ' ';
 }
 
-void parseTemp(byte* packet, byte len) {
+void parseTemp(byte* packet, byte len, SensorState& s) {
   strcpy_P(displayBuf, sTEMP);
   byte ch = packet[4];
   int temp = 100 * packet[10] + 10 * packet[9] + packet[8];
@@ -43,26 +63,54 @@ void parseTemp(byte* packet, byte len) {
   formatDecimal(temp, &displayBuf[3], 5, 1 | FMT_SIGN | FMT_SPACE);
   formatDecimal(humidity, &displayBuf[9], 2, FMT_SPACE);
   parseStatus(packet);
+  s.value[0] = temp;
+  s.value[1] = humidity;
+  strcpy_P(extraBuf, xTEMP);
+  formatDecimal(dewPoint(temp, humidity), &extraBuf[3], 5, 1 | FMT_SIGN | FMT_SPACE);
+  formatDecimal(humidex(temp, humidity), &extraBuf[12], 5, 1 | FMT_SIGN | FMT_SPACE);
+  updateHistory(displayBuf[0], HISTORY_TEMP, temp);
+  if (ch == OUTDOOR_CHANNEL) {
+    outdoorTemp = temp;
+    outdoorTimeout.reset(OUTDOOR_TIMEOUT);
+  }
 }
 
-void parseRain(byte* packet, byte len) {
+void parseRain(byte* packet, byte len, SensorState& s) {
   strcpy_P(displayBuf, sRAIN);
-  long total = 100000L * packet[17] + 10000L * packet[16] + 1000 * packet[15] +
+  int32_t total = 100000L * packet[17] + 10000L * packet[16] + 1000 * packet[15] +
               100 * packet[14] + 10 * packet[13] + packet[12];
   int rate = 1000 * packet[11] + 100 * packet[10] + 10 * packet[9] + packet[8];
   formatDecimal(total, &displayBuf[3], 6, FMT_SPACE);
   formatDecimal(rate, &displayBuf[10], 5, 2 | FMT_SPACE);
   parseStatus(packet);
+  updateRain(total);
+  uint32_t hour = rainHour();
+  strcpy_P(extraBuf, xRAIN);
+  formatDecimal((int32_t)hour, &extraBuf[3], 6, FMT_SPACE);
+  formatDecimal((int32_t)rainDay(), &extraBuf[14], 6, FMT_SPACE);
+  s.value[0] = rate;
+  s.value[1] = hour > 0x7fff ? 0x7fff : hour;
+}
+
+void formatWindStats(WindStats& ws, char* pos) {
+  formatDecimal(ws.avg, &pos[0], 3, FMT_SPACE);
+  if (ws.dir >= 0)
+    formatDecimal(ws.dir, &pos[4], 3);
+  else
+    memset(&pos[4], '-', 3);
+  formatDecimal(ws.gust, &pos[8], 3, FMT_SPACE);
 }
 
-void parseUvlt(byte* packet, byte len) {
+void parseUvlt(byte* packet, byte len, SensorState& s) {
   strcpy_P(displayBuf, sUVLT);
   int uv = 10 * packet[9] + packet[8];
   formatDecimal(uv, &displayBuf[3], 2, FMT_SPACE);
   parseStatus(packet);
+  s.value[0] = uv;
+  updateHistory(displayBuf[0], HISTORY_UV, uv);
 }
 
-void parseWind(byte* packet, byte len) {
+void parseWind(byte* packet, byte len, SensorState& s) {
   strcpy_P(displayBuf, sWIND);
   int dir = packet[8];
   int avg = 100 * packet[16] + 10 * packet[15] + packet[14];
@@ -72,32 +120,59 @@ void parseWind(byte* packet, byte len) {
   formatDecimal(dir, &displayBuf[12], 2, 0);
   //memcpy_P(&displayBuf[11], WIND_DIR[dir], WIND_DIR_LEN);
   parseStatus(packet);
+  s.value[0] = avg;
+  s.value[1] = gust;
+  updateWind(dir, avg, gust);
+  updateHistory(displayBuf[0], HISTORY_WIND, avg);
+  strcpy_P(extraBuf, xWIND);
+  WindStats ws;
+  windStats2(ws);
+  formatWindStats(ws, &extraBuf[3]);
+  windStats10(ws);
+  formatWindStats(ws, &extraBuf[19]);
+  outdoorTimeout.check(); // disables itself when outdoor temperature is too old
+  if (outdoorTimeout.enabled())
+    formatDecimal(windChill(outdoorTemp, avg), &extraBuf[34], 5, 1 | FMT_SIGN | FMT_SPACE);
+  else
+    extraBuf[30] = 0;
 }
 
-void parsePacket(byte* packet, byte len) {
+void parsePacket(byte* packet, byte len, unsigned long time, boolean repaired) {
   int id = (packet[0] << 12) | (packet[1] << 8) | (packet[2] << 4) | packet[3];
   byte ch = packet[4];
   byte rc = (packet[5] << 4) | packet[6];
+  SensorState& s = updateSensor(id, ch, rc, time, repaired);
   switch (id) {
   case 0xF824: // THGR810
   case 0xF8B4: // THGR810 (in the anemometer)
   case 0x1D20: // THGR122NX and THGN123N
-    parseTemp(packet, len);
+    parseTemp(packet, len, s);
     break;
   case 0x2914: // Rain Bucket
-    parseRain(packet, len);
+    parseRain(packet, len, s);
     break;
   case 0xD874: // UVN800
   case 0xEC70: // UVR123
-    parseUvlt(packet, len);
+    parseUvlt(packet, len, s);
     break;    
   case 0x1984: // Wind (Anemometer)
   case 0x1994:
-    parseWind(packet, len);
+    parseWind(packet, len, s);
     break;
   default:
+    RX_STAT_INC(rxStats.unknown);
     parseUnkn(packet, len);
   }  
-  updateDisplay(displayBuf);
+  byte sid = sensorIndex(displayBuf[0]);
+  s.code = sid;
+  if ((packet[7] & 0x4) != 0)
+    s.flags |= SENSOR_BATTERY_LOW;
+  else
+    s.flags &= ~SENSOR_BATTERY_LOW;
+  if (sid < RX_SENSORS)
+    RX_STAT_INC(rxStats.sensor[sid]);
+  scheduleStale(sensorTimeout(s) - (millis() - time));
+  if (sid < MAX_SENSORS)
+    adoptSensor(sid); // the last use of s
 }
 
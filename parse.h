@@ -3,7 +3,9 @@
 
 #include <Arduino.h>
 
-extern void parsePacket(byte* packet, byte len);
+// Parses message nibbles after the sync nibble that ended at a given time in millis into
+// displayBuf and extraBuf, repaired is set when the message was valid only with lost trailing bits
+extern void parsePacket(byte* packet, byte len, unsigned long time, boolean repaired);
 
 #endif
 
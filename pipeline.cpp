@@ -0,0 +1,248 @@
+#include "pipeline.h"
+#include "OsReceiver.h"
+#include "parse.h"
+#include "rxstats.h"
+#include "fmt_util.h"
+#include "xprint.h"
+
+struct Record {
+  byte len;           // message nibbles including the sync nibble
+  boolean repaired;   // see OsRx::packet_repaired()
+  byte version;       // protocol version of a passed through message, 0 for a text line
+  unsigned long time; // millis at the last RF edge
+  LatencyTrace trace;
+  union {
+    byte nibbles[MAX_MSG_LEN + 1];   // frame queue
+    struct {
+      char line[DISPLAY_LENGTH + 1];
+      char extra[EXTRA_LENGTH + 1];
+    } text;                          // emit and render queues
+  };
+};
+
+struct Queue {
+  byte head;
+  byte length;
+  byte maxLength;
+  byte item[PIPELINE_QUEUE];
+};
+
+Record records[PIPELINE_RECORDS];
+byte freeRecords[PIPELINE_RECORDS];
+byte freeCount;
+
+Queue frameQueue;
+Queue emitQueue;
+Queue renderQueue;
+
+uint16_t framed;
+uint16_t dropped;
+uint16_t decodeStalls; // times decode started to wait for the emit queue
+uint16_t emitStalls;   // times emit started to wait for the render queue
+uint16_t localDropped;
+boolean decodeStalled;
+boolean emitStalled;
+boolean passthrough = PIPELINE_PASSTHROUGH;
+
+static boolean full(const Queue& q) {
+  return q.length == PIPELINE_QUEUE;
+}
+
+// returns true when the next queue is full, counting the start of every stall
+static boolean stall(const Queue& next, boolean& stalled, uint16_t& stalls) {
+  if (!full(next)) {
+    stalled = false;
+    return false;
+  }
+  if (!stalled)
+    RX_STAT_INC(stalls);
+  stalled = true;
+  return true;
+}
+
+static void push(Queue& q, byte r) {
+  byte i = q.head + q.length;
+  if (i >= PIPELINE_QUEUE)
+    i -= PIPELINE_QUEUE;
+  q.item[i] = r;
+  if (++q.length > q.maxLength)
+    q.maxLength = q.length;
+}
+
+static byte pop(Queue& q) {
+  byte r = q.item[q.head];
+  if (++q.head == PIPELINE_QUEUE)
+    q.head = 0;
+  q.length--;
+  return r;
+}
+
+static void release(byte r) {
+  freeRecords[freeCount++] = r;
+}
+
+void setupPipeline() {
+  for (byte i = 0; i < PIPELINE_RECORDS; i++)
+    freeRecords[i] = i;
+  freeCount = PIPELINE_RECORDS;
+}
+
+static void frameStage() {
+  for (byte n = 0; n < FRAME_BUDGET && OsReceiver.data_available(); n++) {
+    Queue& next = passthrough ? emitQueue : frameQueue;
+    if (full(next) || freeCount == 0) {
+      OsReceiver.skip();
+      RX_STAT_INC(dropped);
+      continue;
+    }
+    byte r = freeRecords[freeCount - 1];
+    Record& rec = records[r];
+    byte version;
+    rec.len = OsReceiver.get_data(rec.nibbles, sizeof(rec.nibbles), &version);
+    if (rec.len <= 1)
+      continue;
+    freeCount--;
+    rec.repaired = OsReceiver.packet_repaired();
+    rec.version = passthrough ? version : 0;
+    rec.time = OsReceiver.packet_millis();
+    latencyStart(rec.trace, OsReceiver.packet_time());
+    latencyMark(rec.trace, LAT_FRAME);
+    push(next, r);
+    RX_STAT_INC(framed);
+  }
+}
+
+// moves displayBuf and extraBuf into the record
+static void takeLine(Record& rec) {
+  memcpy(rec.text.line, displayBuf, sizeof(rec.text.line));
+  memcpy(rec.text.extra, extraBuf, sizeof(rec.text.extra));
+  extraBuf[0] = 0;
+}
+
+static void decodeStage() {
+  for (byte n = 0; n < DECODE_BUDGET && frameQueue.length != 0; n++) {
+    if (stall(emitQueue, decodeStalled, decodeStalls))
+      return;
+    byte r = pop(frameQueue);
+    Record& rec = records[r];
+    parsePacket(&rec.nibbles[1], rec.len - 1, rec.time, rec.repaired);
+    takeLine(rec);
+    latencyMark(rec.trace, LAT_PARSE);
+    push(emitQueue, r);
+  }
+}
+
+// writes OS<version>:<nibbles> <time>, the nibbles are turned into hex digits in place
+static void emitPacket(Record& rec) {
+  byte n = rec.len - 2; // the last two nibbles are after the checksum
+  rec.nibbles[0] = ':';
+  for (byte i = 1; i < n; i++)
+    rec.nibbles[i] = HEX_CHARS[rec.nibbles[i]];
+  Serial.write('O');
+  Serial.write('S');
+  Serial.write('0' + rec.version);
+  Serial.write(rec.nibbles, n);
+  Serial.write(' ');
+  Serial.println(rec.time);
+}
+
+// length of the line of emitLine or emitPacket with CR LF
+static byte lineLength(const Record& rec) {
+  if (rec.version != 0) {
+    byte n = 3 + (rec.len - 2) + 1 + 2;
+    unsigned long t = rec.time;
+    do
+      n++;
+    while ((t /= 10) != 0);
+    return n;
+  }
+  byte n = 2 + strlen(rec.text.line) + 2;
+  if (rec.text.extra[0] != 0)
+    n += 1 + strlen(rec.text.extra);
+  return n;
+}
+
+static void emitStage() {
+  for (byte n = 0; n < EMIT_BUDGET && emitQueue.length != 0; n++) {
+    Record& rec = records[emitQueue.item[emitQueue.head]];
+    boolean text = rec.version == 0;
+    if (text && stall(renderQueue, emitStalled, emitStalls))
+      return;
+    byte len = lineLength(rec);
+    if (Serial.availableForWrite() < (len < EMIT_ROOM ? len : EMIT_ROOM) || !tryPrint())
+      return;
+    byte r = pop(emitQueue);
+    latencyMark(rec.trace, LAT_PACE);
+    if (!text) {
+      emitPacket(rec);
+      latencyMark(rec.trace, LAT_SERIAL);
+      latencyEnd(rec.trace);
+      release(r);
+      continue;
+    }
+    emitLine(rec.text.line, rec.text.extra);
+    latencyMark(rec.trace, LAT_SERIAL);
+    push(renderQueue, r);
+  }
+}
+
+static void renderStage() {
+  for (byte n = 0; n < RENDER_BUDGET && renderQueue.length != 0; n++) {
+    byte r = pop(renderQueue);
+    Record& rec = records[r];
+    if (renderLine(rec.text.line))
+      latencyMark(rec.trace, LAT_DISPLAY);
+    latencyEnd(rec.trace);
+    release(r);
+  }
+}
+
+void postLine() {
+  if (full(emitQueue) || freeCount == 0) {
+    RX_STAT_INC(localDropped);
+    return;
+  }
+  byte r = freeRecords[--freeCount];
+  Record& rec = records[r];
+  rec.trace.active = false;
+  rec.version = 0;
+  takeLine(rec);
+  push(emitQueue, r);
+}
+
+void checkPipeline() {
+  frameStage();
+  decodeStage();
+  emitStage();
+  renderStage();
+}
+
+void passthroughCommand(const char* s) {
+  if (s[0] == '0' || s[0] == '1')
+    passthrough = s[0] == '1';
+  waitPrint();
+  print_C("{O:");
+  Serial.print(passthrough ? 1 : 0);
+  print_C("}*\r\n");
+}
+
+void dumpPipeline() {
+  waitPrint();
+  print_C("{B:");
+  Serial.print(framed);
+  Serial.print(' ');
+  Serial.print(dropped);
+  Serial.print(' ');
+  Serial.print(decodeStalls);
+  Serial.print(' ');
+  Serial.print(emitStalls);
+  Serial.print(' ');
+  Serial.print(localDropped);
+  Serial.print('|');
+  Serial.print(frameQueue.maxLength);
+  Serial.print(' ');
+  Serial.print(emitQueue.maxLength);
+  Serial.print(' ');
+  Serial.print(renderQueue.maxLength);
+  print_C("}*\r\n");
+}
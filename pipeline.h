@@ -0,0 +1,61 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <Arduino.h>
+
+#include "display.h"
+#include "latency.h"
+
+extern "C" {
+#include "osrx.h"
+}
+
+// Received data goes through stages connected by bounded queues of records from a static pool:
+//
+//   frame  -- takes a message from every receiver and re-arms it, drops the message when the
+//             frame queue is full or the pool is empty
+//   decode -- parses the message, updates aggregates (sensors, history, wind and rain windows)
+//             and formats the console and LCD lines
+//   emit   -- writes the console line when the print pace allows and the serial buffer has room
+//   render -- updates the LCD
+//
+// In the passthrough mode a message skips decode and render: the frame stage puts it into the
+// emit queue as it is and emit writes its nibbles for decoding on the host (see gateway/):
+//
+//   OS<protocol version>:<hex nibbles after the sync nibble up to the checksum> <millis>
+//
+// The time is millis at the last RF edge, the rest is the line of WeatherStation Data Logger.
+//
+// Lines of local sensors (BMP085) enter at the emit queue. A stage waits while the next queue
+// is full, so a slow consumer stops the stages before it instead of the receiver and every
+// such stall is counted. The main loop runs each stage for at most its budget of records.
+// Every record takes 81 bytes of SRAM, mostly the nibbles of a message.
+#define PIPELINE_RECORDS 3
+#define PIPELINE_QUEUE   2 // max length of each queue
+
+#define FRAME_BUDGET  OSRX_RECEIVERS
+#define DECODE_BUDGET 1
+#define EMIT_BUDGET   1
+#define RENDER_BUDGET 1
+
+// Free serial buffer space when it is empty. A line is written when the buffer has room for all
+// of it, a longer one (a passed through message can take 80 chars) waits for an empty buffer.
+#define EMIT_ROOM (SERIAL_TX_BUFFER_SIZE - 1)
+
+// set this to "1" to start in the passthrough mode
+#ifndef PIPELINE_PASSTHROUGH
+#define PIPELINE_PASSTHROUGH 0
+#endif
+
+extern void setupPipeline();
+// Adds a line of a local sensor from displayBuf and extraBuf, drops it when the emit queue is full
+extern void postLine();
+// Runs all stages
+extern void checkPipeline();
+// O -- print passthrough mode, O1, O0 -- switch it on or off
+extern void passthroughCommand(const char* s);
+// Prints messages that passed the frame stage, dropped messages, stalls of decode and emit stages,
+// dropped local lines and max length of frame, emit and render queues
+extern void dumpPipeline();
+
+#endif
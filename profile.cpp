@@ -0,0 +1,29 @@
+
+#include "profile.h"
+#include "xprint.h"
+
+#if ENABLE_PROFILE
+
+volatile Profile profile;
+volatile unsigned long profile_packet_time;
+
+void dumpProfile() {
+  // take a consistent copy, since ISR updates histograms
+  Profile p;
+  uint8_t oldSREG = SREG;
+  cli();
+  memcpy(&p, (const void*)&profile, sizeof(p));
+  SREG = oldSREG;
+  waitPrint();
+  print_C("{P:");
+  // histograms are separated with '|'
+  const uint16_t* h = p.capture;
+  for (byte i = 0; i < sizeof(p) / sizeof(uint16_t); i++) {
+    if (i != 0)
+      Serial.print(i % PROFILE_BUCKETS == 0 ? '|' : ' ');
+    Serial.print(h[i]);
+  }
+  print_C("}*\r\n");
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <Arduino.h>
+
+//
+// set this to "1" to collect histograms of ISR durations, interrupt to get_data latency
+// and main loop period. All PROFILE_XXX macros compile to nothing otherwise.
+//
+#ifndef ENABLE_PROFILE
+#define ENABLE_PROFILE 0
+#endif
+
+#if ENABLE_PROFILE
+
+// bucket i counts values in [2^i, 2^(i+1)) microseconds, the last one counts everything above
+#define PROFILE_BUCKETS 20
+
+typedef struct {
+  uint16_t capture[PROFILE_BUCKETS]; // TIMER1_CAPT_vect duration
+  uint16_t timeout[PROFILE_BUCKETS]; // TIMER2_OVF_vect duration
+  uint16_t latency[PROFILE_BUCKETS]; // from complete message in ISR to get_data
+  uint16_t loop[PROFILE_BUCKETS];    // main loop period
+} Profile;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile Profile profile;
+extern volatile unsigned long profile_packet_time;
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline void profile_add(volatile uint16_t* hist, unsigned long us) {
+  uint8_t b = 0;
+  while (us > 1 && b < PROFILE_BUCKETS - 1) {
+    us >>= 1;
+    b++;
+  }
+  if (hist[b] != 0xffff)
+    hist[b]++;
+}
+
+// ISR duration is measured with timer 1 itself, which ticks every 4 usec
+#define PROFILE_ISR_ENTER()    unsigned int profile_isr_start = TCNT1
+#define PROFILE_ISR_EXIT(hist) profile_add(profile.hist, (unsigned long)(unsigned int)(TCNT1 - profile_isr_start) << 2)
+#define PROFILE_PACKET()       profile_packet_time = micros()
+#define PROFILE_GET_DATA()     profile_add(profile.latency, micros() - profile_packet_time)
+#define PROFILE_LOOP()         { static unsigned long last; unsigned long now = micros(); \
+                                 profile_add(profile.loop, now - last); last = now; }
+
+#ifdef __cplusplus
+// Prints all histograms as one record
+extern void dumpProfile();
+#endif
+
+#else
+
+#define PROFILE_ISR_ENTER()
+#define PROFILE_ISR_EXIT(hist)
+#define PROFILE_PACKET()
+#define PROFILE_GET_DATA()
+#define PROFILE_LOOP()
+
+#endif
+
+#endif
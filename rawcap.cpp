@@ -0,0 +1,124 @@
+#include "rawcap.h"
+
+#if ENABLE_RAW_CAPTURE
+
+#include <util/crc16.h>
+
+#include "rxstats.h"
+#include "xprint.h"
+
+extern "C" {
+#include "osrx.h"
+}
+
+#define RAW_MASK (RAW_BUFFER - 1)
+
+volatile boolean raw_capture_on;
+
+volatile byte rawBuf[RAW_BUFFER];
+volatile byte rawHead; // written by the ISR
+volatile byte rawTail; // written by the main loop
+volatile uint16_t rawDropped; // edges dropped since the last frame
+unsigned long rawLastTime;
+byte rawSeq;
+unsigned long rawFrameTime; // millis of the last frame
+
+void raw_capture_edge(unsigned long time, boolean rf_on) {
+  // a capture latched before the capture mode started counts as no time
+  long period = time - rawLastTime;
+  uint32_t v = ((uint32_t)(period > 0 ? period : 0) << 1) | rf_on;
+  byte rec[5];
+  byte n = 0;
+  do {
+    byte b = v & 0x7f;
+    v >>= 7;
+    if (v != 0)
+      b |= 0x80;
+    rec[n++] = b;
+  } while (v != 0);
+  byte head = rawHead;
+  if ((byte)(RAW_BUFFER - (byte)(head - rawTail)) < n) {
+    RX_STAT_INC(rawDropped);
+    return;
+  }
+  for (byte i = 0; i < n; i++)
+    rawBuf[(byte)(head + i) & RAW_MASK] = rec[i];
+  rawHead = head + n;
+  rawLastTime = time;
+}
+
+static void printMode() {
+  print_C("{C:");
+  Serial.print(raw_capture_on ? 1 : 0);
+  Serial.print(' ');
+  Serial.print(raw_capture_on ? RAW_BAUD : CONSOLE_BAUD);
+  print_C("}*\r\n");
+}
+
+void rawCommand(const char* s) {
+  if (s[0] == '1' && !raw_capture_on) {
+    // the reply goes at the old baud, so the host switches after it
+    waitPrint();
+    raw_capture_on = true;
+    printMode();
+    Serial.flush();
+    Serial.begin(RAW_BAUD);
+    uint8_t oldSREG = SREG;
+    cli();
+    rawHead = rawTail = 0;
+    rawDropped = 0;
+    rawLastTime = osrx_now();
+    SREG = oldSREG;
+    rawFrameTime = millis();
+    return;
+  }
+  if (s[0] == '0' && raw_capture_on) {
+    raw_capture_on = false;
+    Serial.flush();
+    Serial.begin(CONSOLE_BAUD);
+  }
+  waitPrint();
+  printMode();
+}
+
+// Frame: 'W' 'R' <seq> <dropped lo> <dropped hi> <length> <length bytes of records> <crc16 lo> <crc16 hi>
+// Frames end on record boundaries, dropped counts edges since the previous frame and
+// the CRC covers everything after "WR".
+void checkRawCapture() {
+  if (!raw_capture_on)
+    return;
+  byte tail = rawTail;
+  byte n = rawHead - tail;
+  if (n < RAW_BATCH && millis() - rawFrameTime < RAW_LINGER)
+    return;
+  if (n > RAW_FRAME)
+    n = RAW_FRAME;
+  while (n != 0 && (rawBuf[(byte)(tail + n - 1) & RAW_MASK] & 0x80))
+    n--;
+  if ((n == 0 && rawDropped == 0) || Serial.availableForWrite() < n + 8)
+    return;
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t dropped = rawDropped;
+  rawDropped = 0;
+  SREG = oldSREG;
+  byte header[4] = { rawSeq++, (byte)(dropped & 0xff), (byte)(dropped >> 8), n };
+  Serial.write('W');
+  Serial.write('R');
+  uint16_t crc = 0xffff;
+  for (byte i = 0; i < sizeof(header); i++) {
+    Serial.write(header[i]);
+    crc = _crc16_update(crc, header[i]);
+  }
+  for (byte i = 0; i < n; i++) {
+    byte b = rawBuf[(byte)(tail + i) & RAW_MASK];
+    Serial.write(b);
+    crc = _crc16_update(crc, b);
+  }
+  Serial.write(crc & 0xff);
+  Serial.write(crc >> 8);
+  rawTail = tail + n;
+  rawFrameTime = millis();
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef RAWCAP_H
+#define RAWCAP_H
+
+#include <Arduino.h>
+
+//
+// set this to "1" to build the raw capture mode, where every edge that the capture ISR sees
+// is streamed over serial for decoding on the host (see rawcap/). RAW_CAPTURE compiles to
+// nothing otherwise.
+//
+#ifndef ENABLE_RAW_CAPTURE
+#define ENABLE_RAW_CAPTURE 0
+#endif
+
+#if ENABLE_RAW_CAPTURE
+
+// Console runs at this baud during raw capture, it is exact at 16 MHz
+#define RAW_BAUD 500000
+
+// Edges are recorded as varints of (period in timer 1 ticks << 1 | RF level after the edge),
+// 7 bits per byte from the lowest ones, the high bit is set in all bytes but the last one.
+// An edge that does not fit into the buffer is dropped and counted, the next period spans it.
+#define RAW_BUFFER 128 // power of two up to 128
+#define RAW_FRAME  48  // max payload of a frame, so that a whole frame fits into the serial buffer
+#define RAW_BATCH  16  // payload to send a frame before RAW_LINGER
+#define RAW_LINGER 10  // max ms that an edge waits for a frame
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile boolean raw_capture_on;
+
+// Adds an edge at a given timestamp in timer 1 ticks (4 usec), called from the capture ISR
+extern void raw_capture_edge(unsigned long time, boolean rf_on);
+
+#ifdef __cplusplus
+}
+
+// C -- print raw capture mode: on/off and baud
+// C1 -- switch console to RAW_BAUD and start streaming, C0 -- stop and switch it back
+extern void rawCommand(const char* s);
+// Writes captured edges as frames when the serial buffer has room
+extern void checkRawCapture();
+#endif
+
+#define RAW_CAPTURE(time, rf_on) { if (raw_capture_on) raw_capture_edge(time, rf_on); }
+
+#else
+
+#define RAW_CAPTURE(time, rf_on)
+
+#endif
+
+#endif
@@ -0,0 +1,220 @@
+// Host recorder of WeatherCentral raw capture mode (ENABLE_RAW_CAPTURE in ../rawcap.h).
+// Reads "WR" frames of receiver edges from the console, writes them as a pulse trace that
+// wcsim plays back, and reports edges that the firmware dropped and frames lost on the way.
+// Other console output is passed to stdout.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <string>
+
+#include "trace.h"
+
+#define CONSOLE_BAUD B57600
+#define RAW_BAUD     B500000 // RAW_BAUD in ../rawcap.h
+#define TICK_US      4       // timer 1 tick
+
+#define FRAME_HEADER 6 // 'W' 'R' seq dropped-lo dropped-hi length
+#define FRAME_CRC    2
+
+static void usage() {
+  fprintf(stderr,
+    "Usage: rawcap [options] [input]\n"
+    "Records raw capture frames from a serial port, or from a file or stdin with the console\n"
+    "output (e.g. wcsim -c 1:C1 ... | rawcap -o trace).\n"
+    "  -p <port>      serial port: start raw capture with C1 and stop it with C0 on exit\n"
+    "  -t <sec>       recording time with -p (default: until interrupted)\n"
+    "  -o <file>      write edges as a trace\n");
+}
+
+struct Stats {
+  unsigned long frames;
+  unsigned long edges;
+  unsigned long dropped;    // edges that did not fit the firmware buffer
+  unsigned long lostFrames; // gaps in frame sequence numbers
+  unsigned long badFrames;  // CRC failures
+};
+
+static Stats stats;
+static std::vector<SimEdge> edges;
+static sim_time_t edgeTime;
+static int lastSeq = -1;
+static volatile bool stop;
+
+static uint16_t crc16Update(uint16_t crc, uint8_t a) {
+  crc ^= a;
+  for (int i = 0; i < 8; i++)
+    crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  return crc;
+}
+
+static void decodeFrame(const uint8_t* p) {
+  uint8_t seq = p[2];
+  if (lastSeq >= 0)
+    stats.lostFrames += (uint8_t)(seq - lastSeq - 1);
+  lastSeq = seq;
+  stats.frames++;
+  stats.dropped += p[3] | (p[4] << 8);
+  uint8_t len = p[5];
+  uint64_t v = 0;
+  int shift = 0;
+  for (int i = 0; i < len; i++) {
+    uint8_t b = p[FRAME_HEADER + i];
+    v |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+    if (b & 0x80)
+      continue;
+    edgeTime += SIM_US((v >> 1) * TICK_US);
+    edges.push_back({ edgeTime, (uint8_t)(v & 1) });
+    stats.edges++;
+    v = 0;
+    shift = 0;
+  }
+}
+
+// Consumes frames and console output from the buffer, leaves an incomplete frame in it
+static void parse(std::vector<uint8_t>& buf) {
+  size_t i = 0;
+  while (i < buf.size()) {
+    if (buf[i] != 'W') {
+      putchar(buf[i++]);
+      continue;
+    }
+    if (i + 1 < buf.size() && buf[i + 1] != 'R') {
+      putchar(buf[i++]);
+      continue;
+    }
+    if (i + FRAME_HEADER > buf.size())
+      break;
+    size_t size = FRAME_HEADER + buf[i + 5] + FRAME_CRC;
+    if (i + size > buf.size())
+      break;
+    uint16_t crc = 0xffff;
+    for (size_t j = 2; j < size - FRAME_CRC; j++)
+      crc = crc16Update(crc, buf[i + j]);
+    if ((crc & 0xff) != buf[i + size - 2] || (crc >> 8) != buf[i + size - 1]) {
+      stats.badFrames++;
+      putchar(buf[i++]);
+      continue;
+    }
+    decodeFrame(&buf[i]);
+    i += size;
+  }
+  buf.erase(buf.begin(), buf.begin() + i);
+  fflush(stdout);
+}
+
+static bool setBaud(int fd, speed_t baud) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0)
+    return false;
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 1; // reads return every 100 ms
+  cfsetispeed(&tio, baud);
+  cfsetospeed(&tio, baud);
+  return tcsetattr(fd, TCSAFLUSH, &tio) == 0;
+}
+
+static void onSignal(int) {
+  stop = true;
+}
+
+// Sends C1 at console baud, waits for the reply and switches to RAW_BAUD
+static bool startCapture(int fd) {
+  if (!setBaud(fd, CONSOLE_BAUD) || write(fd, "C1\r\n", 4) != 4)
+    return false;
+  std::string reply;
+  for (int n = 0; n < 30 && !stop; n++) { // 3 s
+    char b[64];
+    ssize_t len = read(fd, b, sizeof(b));
+    if (len < 0)
+      return false;
+    reply.append(b, len);
+    if (reply.find("{C:1 ") != std::string::npos)
+      return setBaud(fd, RAW_BAUD);
+  }
+  return false;
+}
+
+int main(int argc, char* argv[]) {
+  const char* port = 0;
+  const char* traceFile = 0;
+  const char* input = 0;
+  double limit = -1;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = i + 1 < argc ? argv[i + 1] : 0;
+    if (arg[0] != '-' || arg[1] == 0) {
+      input = arg;
+      continue;
+    }
+    if (!val || arg[2] != 0) {
+      usage();
+      return 1;
+    }
+    switch (arg[1]) {
+    case 'p': port = val; break;
+    case 't': limit = atof(val); break;
+    case 'o': traceFile = val; break;
+    default:
+      usage();
+      return 1;
+    }
+    i++;
+  }
+  if (port && input) {
+    usage();
+    return 1;
+  }
+  int fd = 0;
+  if (port) {
+    fd = open(port, O_RDWR | O_NOCTTY);
+    if (fd < 0 || !startCapture(fd)) {
+      fprintf(stderr, "rawcap: cannot start raw capture on %s\n", port);
+      return 1;
+    }
+  } else if (input && strcmp(input, "-") != 0) {
+    fd = open(input, O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "rawcap: cannot read %s\n", input);
+      return 1;
+    }
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  time_t start = time(0);
+  std::vector<uint8_t> buf;
+  while (!stop && (limit < 0 || difftime(time(0), start) < limit)) {
+    uint8_t b[4096];
+    ssize_t len = read(fd, b, sizeof(b));
+    if (len < 0)
+      break;
+    if (len == 0) {
+      if (!port)
+        break; // end of file
+      continue;
+    }
+    buf.insert(buf.end(), b, b + len);
+    parse(buf);
+  }
+  if (port) {
+    if (write(fd, "C0\r\n", 4) != 4 || tcdrain(fd) != 0 || !setBaud(fd, CONSOLE_BAUD))
+      fprintf(stderr, "rawcap: cannot stop raw capture on %s\n", port);
+  }
+  if (traceFile && !writeTrace(traceFile, edges, edgeTime + SIM_MS(10))) {
+    fprintf(stderr, "rawcap: cannot write trace %s\n", traceFile);
+    return 1;
+  }
+  fprintf(stderr, "rawcap: %lu frames, %lu edges, %.3f s\n",
+    stats.frames, stats.edges, (double)edgeTime / SIM_F_CPU);
+  fprintf(stderr, "rawcap: %lu edges dropped by firmware, %lu frames lost, %lu bad frames\n",
+    stats.dropped, stats.lostFrames, stats.badFrames);
+  return 0;
+}
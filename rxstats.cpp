@@ -0,0 +1,38 @@
+#include <stddef.h>
+
+#include "rxstats.h"
+#include "xprint.h"
+
+extern "C" {
+#include "osrx.h"
+}
+
+#define RX_COUNTERS ((sizeof(RxStats) - offsetof(RxStats, noise)) / sizeof(uint16_t))
+
+uint32_t lastIsrTicks;
+unsigned long lastTime;
+
+void dumpRxStats() {
+  // take a consistent copy, since ISR updates counters
+  RxStats s;
+  uint8_t oldSREG = SREG;
+  cli();
+  memcpy(&s, (const void*)&rxStats, sizeof(s));
+  SREG = oldSREG;
+  unsigned long time = osrx_now();
+  unsigned long busy = (s.isrTicks - lastIsrTicks) / ((time - lastTime) / 1000 + 1);
+  lastIsrTicks = s.isrTicks;
+  lastTime = time;
+  waitPrint();
+  print_C("{S:");
+  Serial.print(s.edges);
+  Serial.print(' ');
+  Serial.print(busy);
+  // all other counters are 16-bit, per-sensor counters are separated with '|'
+  const uint16_t* c = &s.noise;
+  for (byte i = 0; i < RX_COUNTERS; i++) {
+    Serial.print(i == RX_COUNTERS - RX_SENSORS ? '|' : ' ');
+    Serial.print(c[i]);
+  }
+  print_C("}*\r\n");
+}
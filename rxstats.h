@@ -0,0 +1,49 @@
+#ifndef RXSTATS_H
+#define RXSTATS_H
+
+#include <Arduino.h>
+
+#define RX_SENSORS 16 // same as MAX_SENSORS in display.h
+
+//
+// Receive pipeline counters. They are updated from the edge capture ISR in osrx.c,
+// from OsReceiver.cpp and from parse.cpp, and are never reset. 16-bit counters saturate.
+//
+typedef struct {
+  uint32_t edges;         // all captured edges
+  uint32_t isrTicks;      // time spent in the edge capture ISR, timer 1 ticks (4 usec)
+  uint16_t noise;         // invalid periods while looking for preamble
+  uint16_t preambleMiss;  // broken preamble sequences
+  uint16_t bitErrors;     // resets on malformed periods while receiving
+  uint16_t overflows;     // receive buffer overflows
+  uint16_t packets;       // complete messages from the ISR
+  uint16_t syncErrors;    // messages with wrong sync nibble
+  uint16_t checksumFail;  // messages with invalid checksum
+  uint16_t repaired;      // messages that were valid only with lost trailing bits
+  uint16_t repeats;       // dropped copies: version 2.1 message repeats and messages from another receiver
+  uint16_t unknown;       // valid messages with unknown sensor id
+  uint16_t gates;         // capture interrupts masked by the noise gate
+  uint16_t filtered;      // messages dropped by the sensor filter
+  uint16_t blocked;       // messages that were waiting for the main loop while edges were dropped
+  uint16_t resyncs;       // glitches merged and lost edges split out by the clock recovery decoder
+  uint16_t sensor[RX_SENSORS]; // parsed messages by position in SENSOR_CODES
+} RxStats;
+
+#define RX_STAT_INC(c) { if ((c) != 0xffff) (c)++; }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile RxStats rxStats;
+
+#ifdef __cplusplus
+}
+
+// Prints all counters as one record, the second field is the share of time spent in
+// the edge capture ISR since the previous record in 1/1000
+extern void dumpRxStats();
+
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#include "schedule.h"
+#include "sensors.h"
+#include "rxstats.h"
+#include "xprint.h"
+
+uint16_t scheduleDeferred;
+uint16_t scheduleForced;
+unsigned long scheduleDelay;
+
+boolean Deferred::ready(boolean due, unsigned long busy) {
+  unsigned long time = millis();
+  if (due && _due == 0)
+    _due = time != 0 ? time : 1;
+  if (_due == 0)
+    return false;
+  unsigned long delay = time - _due;
+  if (delay < SCHEDULE_MAX_DELAY && !rxQuiet(busy))
+    return false;
+  if (delay != 0) {
+    RX_STAT_INC(scheduleDeferred);
+    scheduleDelay += delay;
+  }
+  if (delay >= SCHEDULE_MAX_DELAY)
+    RX_STAT_INC(scheduleForced);
+  _due = 0;
+  return true;
+}
+
+void dumpSchedule() {
+  waitPrint();
+  print_C("{D:");
+  Serial.print(scheduleDeferred);
+  Serial.print(' ');
+  Serial.print(scheduleForced);
+  Serial.print(' ');
+  Serial.print(scheduleDelay);
+  print_C("}*\r\n");
+}
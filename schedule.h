@@ -0,0 +1,28 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <Arduino.h>
+
+// Periodic work that blocks the main loop (BMP085 conversions and EEPROM writes) is deferred
+// out of predicted receive windows, see rxQuiet. When predictions drift so that no quiet
+// interval is found, the work runs anyway after SCHEDULE_MAX_DELAY.
+#define SCHEDULE_MAX_DELAY (10 * 1000L) // 10 s
+
+// Worst case main loop blocking of the deferred work in ms
+#define BUSY_BMP085   50  // conversions
+#define BUSY_SNAPSHOT 400 // 114 bytes of EEPROM at 3.4 ms
+#define BUSY_HISTORY  60  // 16 bytes of EEPROM
+
+class Deferred {
+  private:
+    unsigned long _due; // millis when the work became due, 0 when it is not due
+  public:
+    Deferred() : _due(0) {}
+    // Returns true when the work that became due (now or before) can run for the given time
+    boolean ready(boolean due, unsigned long busy);
+};
+
+// Prints the number of deferred works, the ones that ran after SCHEDULE_MAX_DELAY and total delay in ms
+extern void dumpSchedule();
+
+#endif
@@ -0,0 +1,234 @@
+#include "sensors.h"
+#include "rxstats.h"
+#include "xprint.h"
+
+#define SLOT_MASK (SENSOR_SLOTS - 1)
+
+static_assert((SENSOR_SLOTS & SLOT_MASK) == 0, "SENSOR_SLOTS must be a power of two");
+
+SensorState sensors[SENSOR_SLOTS];
+byte sensorCount;
+uint16_t sensorEvictions;
+uint16_t sensorRebinds;
+
+static byte sensorHash(uint16_t id, byte channel) {
+  byte h = (id >> 8) ^ id ^ (channel << 4) ^ channel;
+  return (h ^ (h >> 4)) & SLOT_MASK;
+}
+
+// Removes the sensor, moving back the following sensors of the probe sequence
+// into the freed slot when it is on their way from their home slot
+static void removeSensor(byte i) {
+  byte j = i;
+  while (true) {
+    sensors[i].flags = 0;
+    byte h;
+    do {
+      j = (j + 1) & SLOT_MASK;
+      if (sensors[j].flags == 0)
+        return;
+      h = sensorHash(sensors[j].id, sensors[j].channel);
+    } while (i <= j ? (i < h && h <= j) : (i < h || h <= j));
+    sensors[i] = sensors[j];
+    i = j;
+  }
+}
+
+static byte leastRecentSensor(unsigned long time) {
+  byte lru = 0;
+  for (byte i = 1; i < SENSOR_SLOTS; i++)
+    if (time - sensors[i].lastTime > time - sensors[lru].lastTime)
+      lru = i;
+  return lru;
+}
+
+static SensorState& addSensor(uint16_t id, byte channel, byte rc, unsigned long time) {
+  if (sensorCount == SENSOR_SLOTS) {
+    removeSensor(leastRecentSensor(time));
+    sensorCount--;
+    RX_STAT_INC(sensorEvictions);
+  }
+  byte i = sensorHash(id, channel);
+  while (sensors[i].flags != 0)
+    i = (i + 1) & SLOT_MASK;
+  sensorCount++;
+  SensorState& s = sensors[i];
+  memset(&s, 0, sizeof(s));
+  s.id = id;
+  s.channel = channel;
+  s.rc = rc;
+  s.flags = SENSOR_USED;
+  s.lastTime = time;
+  return s;
+}
+
+#define EWMA_ONE 0xffffL
+
+// moves the average 1/16 of the way to the sample
+static void ewma(uint16_t& avg, long sample) {
+  avg += (sample - (long)avg) >> SENSOR_EWMA_SHIFT;
+}
+
+static void updateQuality(SensorState& s, unsigned long time, boolean repaired) {
+  unsigned long gap = time - s.lastTime;
+  if (gap < SENSOR_PERIOD_MIN)
+    return; // another copy of the same message
+  unsigned long periods = 1; // number of transmit periods in the gap
+  if (s.period == 0 || gap < s.period - s.period / 4) {
+    // the first gap is the period or its multiple when messages were missed, shorter gaps fix it
+    if (gap <= SENSOR_PERIOD_MAX)
+      s.period = gap;
+  } else {
+    periods = (gap + s.period / 2) / s.period;
+    long error = (long)(gap - periods * s.period);
+    s.period += (error / (long)periods + (1 << (SENSOR_EWMA_SHIFT - 1))) >> SENSOR_EWMA_SHIFT;
+    if (error < 0)
+      error = -error;
+    ewma(s.jitter, error < EWMA_ONE ? error : EWMA_ONE);
+  }
+  s.expected = s.expected + periods < 0xffff ? s.expected + periods : 0xffff;
+  // the average has forgotten everything before after 64 missed messages
+  for (byte i = 1; i < periods && i <= 64; i++)
+    ewma(s.loss, EWMA_ONE);
+  ewma(s.loss, 0);
+  ewma(s.repair, repaired ? EWMA_ONE : 0);
+}
+
+unsigned long sensorTimeout(const SensorState& s) {
+  return s.period != 0 ? s.period * SENSOR_STALE_PERIODS : SENSOR_TIMEOUT;
+}
+
+boolean rxQuiet(unsigned long interval) {
+  unsigned long time = millis();
+  for (byte i = 0; i < SENSOR_SLOTS; i++) {
+    SensorState& s = sensors[i];
+    if (s.flags == 0 || s.period == 0)
+      continue;
+    unsigned long since = time - s.lastTime;
+    if (since >= sensorTimeout(s))
+      continue; // stale, nothing to predict
+    unsigned long periods = since / s.period;
+    unsigned long phase = since - periods * s.period;
+    unsigned long guard = SENSOR_GUARD + 4UL * s.jitter * (periods + 1);
+    // late message of the previous period or the next one starting within the interval
+    if ((periods > 0 && phase < guard) || s.period - phase < interval + SENSOR_AIR_TIME + guard)
+      return false;
+  }
+  return true;
+}
+
+SensorState& updateSensor(uint16_t id, byte channel, byte rc, unsigned long time, boolean repaired) {
+  byte i = sensorHash(id, channel);
+  byte found = SENSOR_SLOTS;
+  for (byte n = 0; n < SENSOR_SLOTS && sensors[i].flags != 0; n++, i = (i + 1) & SLOT_MASK) {
+    SensorState& s = sensors[i];
+    if (s.id != id || s.channel != channel)
+      continue;
+    if (s.rc == rc) {
+      found = i;
+      break;
+    }
+    // the first silent sensor with another rolling code is re-bound unless this one is found
+    if (found == SENSOR_SLOTS && time - s.lastTime >= SENSOR_REBIND_TIME)
+      found = i;
+  }
+  SensorState* s;
+  if (found == SENSOR_SLOTS) {
+    s = &addSensor(id, channel, rc, time);
+    s->expected = 1;
+    ewma(s->repair, repaired ? EWMA_ONE : 0);
+  } else {
+    s = &sensors[found];
+    if (s->rc != rc) {
+      s->rc = rc;
+      RX_STAT_INC(sensorRebinds);
+    }
+    updateQuality(*s, time, repaired);
+  }
+  s->lastTime = time;
+  RX_STAT_INC(s->packets);
+  return *s;
+}
+
+void restoreSensor(byte code, unsigned long lastTime) {
+  addSensor(0, code, 0, lastTime).code = code;
+}
+
+void adoptSensor(byte code) {
+  byte i = sensorHash(0, code);
+  for (byte n = 0; n < SENSOR_SLOTS && sensors[i].flags != 0; n++, i = (i + 1) & SLOT_MASK) {
+    if (sensors[i].id == 0 && sensors[i].channel == code) {
+      removeSensor(i);
+      sensorCount--;
+      return;
+    }
+  }
+}
+
+static void printSensorKey(const SensorState& s) {
+  Serial.print('|');
+  printHex(s.id, 4);
+  Serial.print('/');
+  printHex(s.channel, 1);
+  Serial.print('/');
+  printHex(s.rc, 2);
+}
+
+// prints average share in 1/1000
+static void printShare(uint16_t share) {
+  Serial.print(' ');
+  Serial.print((share * 1000UL + 0x8000) >> 16);
+}
+
+void dumpQuality() {
+  waitPrint();
+  print_C("{Q:");
+  Serial.print(sensorCount);
+  for (byte i = 0; i < SENSOR_SLOTS; i++) {
+    SensorState& s = sensors[i];
+    if (s.flags == 0 || s.id == 0)
+      continue;
+    printSensorKey(s);
+    Serial.print(' ');
+    Serial.print(s.period);
+    Serial.print(' ');
+    Serial.print(s.expected);
+    Serial.print(' ');
+    Serial.print(s.packets);
+    printShare(s.loss);
+    printShare(s.repair);
+    Serial.print(' ');
+    Serial.print(s.jitter);
+  }
+  print_C("}*\r\n");
+}
+
+void dumpSensors() {
+  unsigned long time = millis();
+  waitPrint();
+  print_C("{T:");
+  Serial.print(sensorCount);
+  Serial.print(' ');
+  Serial.print(sensorEvictions);
+  Serial.print(' ');
+  Serial.print(sensorRebinds);
+  for (byte i = 0; i < SENSOR_SLOTS; i++) {
+    SensorState& s = sensors[i];
+    if (s.flags == 0)
+      continue;
+    printSensorKey(s);
+    Serial.print(' ');
+    Serial.print(s.code);
+    Serial.print(' ');
+    Serial.print((time - s.lastTime) / 1000);
+    Serial.print(' ');
+    Serial.print(s.packets);
+    Serial.print(' ');
+    Serial.print(s.flags & SENSOR_BATTERY_LOW ? 'L' : '-');
+    Serial.print(' ');
+    Serial.print(s.value[0]);
+    Serial.print(' ');
+    Serial.print(s.value[1]);
+  }
+  print_C("}*\r\n");
+}
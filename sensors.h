@@ -0,0 +1,74 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <Arduino.h>
+
+// Every sensor that is heard is tracked by (id, channel, rolling code) in an open-addressed
+// table with linear probing on hash of (id, channel), so sensors that differ only by
+// rolling code are found in the same probe sequence. The least recently seen sensor is
+// evicted when the table is full.
+#ifndef SENSOR_SLOTS
+#define SENSOR_SLOTS 8 // power of two, 28 bytes of SRAM each
+#endif
+
+// A new rolling code of the sensor with the same id and channel that was silent for this
+// long is a battery swap, so the sensor keeps its state (with other neighbours heard)
+#define SENSOR_REBIND_TIME (3 * 60000L) // 3 min
+
+// Transmit period of every sensor is estimated from arrival gaps, the gap is rounded to a
+// number of periods to count missed messages. A sensor is stale when SENSOR_STALE_PERIODS
+// periods pass without a message, or after SENSOR_TIMEOUT while its period is not known yet.
+#define SENSOR_PERIOD_MIN    (5 * 1000L)   // 5 s
+#define SENSOR_PERIOD_MAX    (150 * 1000L) // 2.5 min
+#define SENSOR_STALE_PERIODS 4
+#define SENSOR_TIMEOUT       (10 * 60000L) // 10 min
+
+// A message is expected on air during SENSOR_AIR_TIME before its predicted end, give or take
+// SENSOR_GUARD and 4 average jitters for every period since the sensor was last heard
+#define SENSOR_AIR_TIME 250 // ms
+#define SENSOR_GUARD    50  // ms
+
+// Loss, repair and jitter averages are exponentially weighted with 1/16 weight of a new sample,
+// loss and repair rates are fractions of 0x10000
+#define SENSOR_EWMA_SHIFT 4
+
+#define SENSOR_USED        0x01
+#define SENSOR_BATTERY_LOW 0x02
+
+struct SensorState {
+  uint16_t id;           // 0 for a sensor restored from the warm start snapshot
+  byte channel;          // nibble after the id as it is in the message
+  byte rc;               // rolling code
+  byte code;             // position of its display code in SENSOR_CODES
+  byte flags;            // SENSOR_XXX flags, 0 for an empty slot
+  uint16_t packets;      // received messages (saturates)
+  uint16_t expected;     // messages that were sent since the first one (saturates)
+  uint16_t loss;         // average share of missed messages
+  uint16_t repair;       // average share of messages with lost trailing bits
+  uint16_t jitter;       // average deviation of arrival from the period in ms
+  unsigned long period;  // estimated transmit period in ms, 0 when not known yet
+  unsigned long lastTime; // millis at the end of the last message
+  int16_t value[2];      // last reading in sensor units: temperature and humidity,
+                         // rain rate and rain over the last hour, wind average and gust, UV index
+};
+
+extern SensorState sensors[SENSOR_SLOTS];
+
+// Finds the sensor (adding or re-binding it when needed) and updates its reception quality
+// with the message that ended at a given time in millis
+extern SensorState& updateSensor(uint16_t id, byte channel, byte rc, unsigned long time, boolean repaired);
+// Time in millis from the last message of the sensor until it is stale
+extern unsigned long sensorTimeout(const SensorState& s);
+// Returns true when no sensor is expected to transmit during the next interval ms
+extern boolean rxQuiet(unsigned long interval);
+// Adds a sensor without id that was last seen at a given time for the display code
+extern void restoreSensor(byte code, unsigned long lastTime);
+// Removes the sensor without id of the display code once a sensor with that code is heard,
+// entries may move, so references to the table are not valid after it
+extern void adoptSensor(byte code);
+// Prints the table
+extern void dumpSensors();
+// Prints reception quality of every sensor
+extern void dumpQuality();
+
+#endif
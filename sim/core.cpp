@@ -0,0 +1,293 @@
+// Virtual clock, timers and interrupts of the simulated ATmega328
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+#include <stdio.h>
+
+#include "sim.h"
+
+extern "C" {
+void TIMER1_CAPT_vect(void);
+void TIMER1_OVF_vect(void);
+void TIMER2_OVF_vect(void);
+// the second receiver is there only when the firmware is built for it
+void PCINT2_vect(void) __attribute__((weak));
+
+volatile uint8_t SREG;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint16_t ICR1;
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, TIMSK2;
+volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t PINB, PIND;
+}
+
+SimFlagRegister TIFR1, TIFR2, PCIFR;
+
+#define SREG_I 0x80
+
+// timer 1 runs at clk/64, timer 2 at clk/128 and overflows after 256 counts
+#define T1_PRESCALE 64
+#define T2_PERIOD   (256 * 128)
+
+// TCNT2 is restarted when firmware writes zero to it. The simulator keeps a non-zero value
+// there while the timer runs to notice the next write.
+#define T2_RUNNING 1
+
+// data line of the second receiver
+#define RX2_BIT 4 // PD4, PCINT20
+
+sim_time_t sim_now;
+SimCosts sim_costs = {
+  SIM_US(1),    // call
+  SIM_US(20),   // loop
+  SIM_US(25),   // isr
+  SIM_US(210),  // lcdWrite
+  SIM_US(90),   // i2cByte
+  SIM_US(3400), // eepromWrite
+};
+SimStats sim_stats;
+
+static std::vector<SimEdge> rf[SIM_RECEIVERS];
+static size_t rfPos[SIM_RECEIVERS];
+static sim_time_t t1NextOverflow = (sim_time_t)T1_PRESCALE << 16;
+static sim_time_t t2Start;
+static bool inIsr;
+
+extern "C" uint16_t sim_tcnt1(void) {
+  return (uint16_t)(sim_now / T1_PRESCALE);
+}
+
+extern "C" void cli(void) {
+  SREG &= ~SREG_I;
+}
+
+extern "C" void sei(void) {
+  SREG |= SREG_I;
+}
+
+void sim_set_rf(int receiver, const std::vector<SimEdge>& edges) {
+  rf[receiver] = edges;
+  rfPos[receiver] = 0;
+}
+
+static void checkTimer2Restart() {
+  if (TCNT2 == 0) {
+    t2Start = sim_now;
+    TCNT2 = T2_RUNNING;
+  }
+}
+
+static void runIsr(void (*isr)(void)) {
+  inIsr = true;
+  SREG &= ~SREG_I;
+  sim_time_t start = sim_now;
+  isr();
+  checkTimer2Restart();
+  sim_now += sim_costs.isr;
+  sim_stats.isrs++;
+  sim_stats.isrTime += sim_now - start;
+  SREG |= SREG_I;
+  inIsr = false;
+}
+
+// Serves pending interrupts in the order of AVR vector priority
+static void dispatch() {
+  while (!inIsr && (SREG & SREG_I)) {
+    if ((PCIFR & _BV(PCIF2)) && (PCICR & _BV(PCIE2)) && PCINT2_vect) {
+      PCIFR.value &= ~_BV(PCIF2);
+      sim_stats.captures++;
+      runIsr(PCINT2_vect);
+    } else if ((TIFR2 & _BV(TOV2)) && (TIMSK2 & _BV(TOIE2))) {
+      TIFR2.value &= ~_BV(TOV2);
+      runIsr(TIMER2_OVF_vect);
+    } else if ((TIFR1 & _BV(ICF1)) && (TIMSK1 & _BV(ICIE1))) {
+      TIFR1.value &= ~_BV(ICF1);
+      sim_stats.captures++;
+      runIsr(TIMER1_CAPT_vect);
+    } else if ((TIFR1 & _BV(TOV1)) && (TIMSK1 & _BV(TOIE1))) {
+      TIFR1.value &= ~_BV(TOV1);
+      runIsr(TIMER1_OVF_vect);
+    } else
+      break;
+  }
+}
+
+static void deliverEdge(const SimEdge& e) {
+  sim_stats.edges++;
+  if (e.level)
+    PINB |= 1;
+  else
+    PINB &= ~1;
+  bool rising = (TCCR1B & _BV(ICES1)) != 0;
+  if (rising != (e.level != 0))
+    return;
+  if ((TIFR1 & _BV(ICF1)) && (TIMSK1 & _BV(ICIE1)))
+    sim_stats.lostCaptures++;
+  ICR1 = sim_tcnt1();
+  TIFR1.value |= _BV(ICF1);
+}
+
+// pin change of the second receiver, the flag is set on any change of an enabled pin
+static void deliverEdge2(const SimEdge& e) {
+  sim_stats.edges++;
+  if (e.level)
+    PIND |= _BV(RX2_BIT);
+  else
+    PIND &= ~_BV(RX2_BIT);
+  if (!(PCMSK2 & _BV(RX2_BIT)))
+    return;
+  if ((PCIFR & _BV(PCIF2)) && (PCICR & _BV(PCIE2)))
+    sim_stats.lostCaptures++;
+  PCIFR.value |= _BV(PCIF2);
+}
+
+void sim_advance_to(sim_time_t time) {
+  if (time < sim_now)
+    time = sim_now;
+  checkTimer2Restart();
+  while (true) {
+    sim_time_t next = t1NextOverflow;
+    int event = 0;
+    for (int r = 0; r < SIM_RECEIVERS; r++) {
+      if (rfPos[r] < rf[r].size() && rf[r][rfPos[r]].time < next) {
+        next = rf[r][rfPos[r]].time;
+        event = 3 + r;
+      }
+    }
+    if (t2Start + T2_PERIOD < next) {
+      next = t2Start + T2_PERIOD;
+      event = 2;
+    }
+    if (next > time)
+      break;
+    if (next > sim_now)
+      sim_now = next;
+    switch (event) {
+    case 0:
+      TIFR1.value |= _BV(TOV1);
+      t1NextOverflow += (sim_time_t)T1_PRESCALE << 16;
+      break;
+    case 3:
+      deliverEdge(rf[0][rfPos[0]++]);
+      break;
+    case 4:
+      deliverEdge2(rf[1][rfPos[1]++]);
+      break;
+    case 2:
+      TIFR2.value |= _BV(TOV2);
+      t2Start += T2_PERIOD;
+      break;
+    }
+    dispatch();
+    checkTimer2Restart();
+  }
+  // interrupts served above may have run past the time
+  if (time > sim_now)
+    sim_now = time;
+  dispatch();
+}
+
+void sim_advance(sim_time_t cycles) {
+  sim_advance_to(sim_now + cycles);
+}
+
+//================= ARDUINO CORE =================
+
+extern "C" unsigned long millis(void) {
+  sim_advance(sim_costs.call);
+  return (unsigned long)(sim_now / SIM_MS(1));
+}
+
+extern "C" unsigned long micros(void) {
+  sim_advance(sim_costs.call);
+  return (unsigned long)(sim_now / SIM_US(1));
+}
+
+extern "C" void delay(unsigned long ms) {
+  sim_advance(SIM_MS(ms));
+}
+
+extern "C" void delayMicroseconds(unsigned int us) {
+  sim_advance(SIM_US(us));
+}
+
+extern "C" void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+extern "C" void digitalWrite(uint8_t pin, uint8_t val) {
+}
+
+extern "C" int digitalRead(uint8_t pin) {
+  if (pin == 8)
+    return PINB & 1;
+  if (pin == 4)
+    return (PIND >> RX2_BIT) & 1;
+  return LOW;
+}
+
+//================= EEPROM =================
+
+static uint8_t eeprom[E2END + 1];
+static bool eepromInit;
+
+static uint8_t* eepromCell(const void* addr) {
+  if (!eepromInit) {
+    memset(eeprom, 0xff, sizeof(eeprom)); // erased
+    eepromInit = true;
+  }
+  return &eeprom[(size_t)addr & E2END];
+}
+
+extern "C" uint8_t eeprom_read_byte(const uint8_t* addr) {
+  return *eepromCell(addr);
+}
+
+extern "C" void eeprom_write_byte(uint8_t* addr, uint8_t value) {
+  sim_advance(sim_costs.eepromWrite);
+  *eepromCell(addr) = value;
+}
+
+extern "C" void eeprom_update_byte(uint8_t* addr, uint8_t value) {
+  if (*eepromCell(addr) != value)
+    eeprom_write_byte(addr, value);
+}
+
+extern "C" void eeprom_read_block(void* dst, const void* src, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    ((uint8_t*)dst)[i] = eeprom_read_byte((const uint8_t*)src + i);
+}
+
+extern "C" void eeprom_write_block(const void* src, void* dst, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    eeprom_write_byte((uint8_t*)dst + i, ((const uint8_t*)src)[i]);
+}
+
+extern "C" void eeprom_update_block(const void* src, void* dst, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    eeprom_update_byte((uint8_t*)dst + i, ((const uint8_t*)src)[i]);
+}
+
+extern "C" int eeprom_is_ready(void) {
+  return 1;
+}
+
+bool sim_eeprom_load(const char* file) {
+  eepromCell(0);
+  FILE* f = fopen(file, "rb");
+  if (!f)
+    return false;
+  size_t n = fread(eeprom, 1, sizeof(eeprom), f);
+  fclose(f);
+  return n == sizeof(eeprom);
+}
+
+bool sim_eeprom_save(const char* file) {
+  eepromCell(0);
+  FILE* f = fopen(file, "wb");
+  if (!f)
+    return false;
+  size_t n = fwrite(eeprom, 1, sizeof(eeprom), f);
+  fclose(f);
+  return n == sizeof(eeprom);
+}
@@ -0,0 +1,89 @@
+// Arduino API stand-in for the host simulator
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define LOW  0
+#define HIGH 1
+#define INPUT  0
+#define OUTPUT 1
+
+#define DEC 10
+#define HEX 16
+
+#define interrupts()   sei()
+#define noInterrupts() cli()
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+#ifdef __cplusplus
+}
+
+class Print {
+public:
+  virtual size_t write(uint8_t ch) = 0;
+  size_t write(const char* s);
+  size_t write(const uint8_t* buf, size_t n);
+  size_t print(const char* s);
+  size_t print(char ch);
+  size_t print(unsigned char n, int base = DEC);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t println();
+  size_t println(const char* s);
+  size_t println(char ch);
+  size_t println(unsigned char n, int base = DEC);
+  size_t println(int n, int base = DEC);
+  size_t println(unsigned int n, int base = DEC);
+  size_t println(long n, int base = DEC);
+  size_t println(unsigned long n, int base = DEC);
+private:
+  size_t printNumber(unsigned long n, int base);
+};
+
+// same as the Arduino core, one byte of the buffer is always free
+#define SERIAL_TX_BUFFER_SIZE 64
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud);
+  void end();
+  int available();
+  int peek();
+  int read();
+  int availableForWrite();
+  void flush();
+  virtual size_t write(uint8_t ch);
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
+
+#endif
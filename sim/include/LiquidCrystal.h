@@ -0,0 +1,28 @@
+// LiquidCrystal stand-in for the host simulator, keeps LCD contents in memory
+#ifndef LiquidCrystal_h
+#define LiquidCrystal_h
+
+#include <Arduino.h>
+
+#define LCD_COLS 16
+#define LCD_ROWS 2
+
+class LiquidCrystal : public Print {
+public:
+  LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+  void begin(uint8_t cols, uint8_t rows);
+  void clear();
+  void setCursor(uint8_t col, uint8_t row);
+  virtual size_t write(uint8_t ch);
+  using Print::write;
+  // contents of the given row (for the simulator)
+  const char* row(uint8_t r) const { return _text[r]; }
+private:
+  char _text[LCD_ROWS][LCD_COLS + 1];
+  uint8_t _col;
+  uint8_t _row;
+};
+
+extern LiquidCrystal* sim_lcd;
+
+#endif
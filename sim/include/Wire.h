@@ -0,0 +1,20 @@
+// Wire (I2C) stand-in for the host simulator, talks to the simulated BMP085
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+  void begin();
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission();
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  int available();
+  int read();
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,26 @@
+// EEPROM stand-in for the host simulator (ATmega328 has 1 KB)
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define E2END 0x3FF
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint8_t eeprom_read_byte(const uint8_t* addr);
+void eeprom_write_byte(uint8_t* addr, uint8_t value);
+void eeprom_update_byte(uint8_t* addr, uint8_t value);
+void eeprom_read_block(void* dst, const void* src, size_t n);
+void eeprom_write_block(const void* src, void* dst, size_t n);
+void eeprom_update_block(const void* src, void* dst, size_t n);
+int eeprom_is_ready(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,78 @@
+// AVR registers and interrupts stand-in for the host simulator.
+// Only the registers that are used by the firmware are defined.
+#ifndef SIM_INTERRUPT_H
+#define SIM_INTERRUPT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define ISR(vector) extern "C" void vector(void)
+extern "C" {
+#else
+#define ISR(vector) void vector(void)
+#endif
+
+void cli(void);
+void sei(void);
+
+// status register, bit 7 is the global interrupt enable
+extern volatile uint8_t SREG;
+
+// timer 1 (input capture), counter is read through the virtual clock
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t ICR1;
+uint16_t sim_tcnt1(void);
+#define TCNT1 (sim_tcnt1())
+
+// timer 2 (pulse timeout), the simulator restarts the timer when firmware writes zero to TCNT2
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, TIMSK2;
+
+// pin change interrupts and port inputs, PCIFR is a flag register below
+extern volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t PINB, PIND;
+
+#ifdef __cplusplus
+}
+
+// Interrupt flag register, firmware clears a flag by writing one to it like on the real chip.
+// Flag registers are available to C++ only, so osrx.c is compiled as C++ (see osrx.cpp).
+struct SimFlagRegister {
+  volatile uint8_t value;
+  operator uint8_t() const { return value; }
+  void operator=(uint8_t v) { value &= ~v; }
+  // read-modify-write writes back ones of all pending flags and clears them
+  void operator|=(uint8_t v) { value &= ~(value | v); }
+  void operator&=(uint8_t v) { value &= ~(value & v); }
+};
+
+extern SimFlagRegister TIFR1, TIFR2, PCIFR;
+#endif
+
+#define _BV(bit) (1 << (bit))
+
+#define TOIE1  0
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1  5
+#define TOV1   0
+#define ICF1   5
+#define CS10   0
+#define CS11   1
+#define CS12   2
+#define ICES1  6
+#define ICNC1  7
+
+#define TOIE2  0
+#define TOV2   0
+#define CS20   0
+#define CS21   1
+#define CS22   2
+
+#define PCIE0  0
+#define PCIE1  1
+#define PCIE2  2
+#define PCIF0  0
+#define PCIF1  1
+#define PCIF2  2
+
+#endif
@@ -0,0 +1,23 @@
+// Program memory is ordinary memory in the host simulator
+#ifndef SIM_PGMSPACE_H
+#define SIM_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+
+#define pgm_read_byte(p)       (*(const uint8_t*)(p))
+#define pgm_read_byte_near(p)  (*(const uint8_t*)(p))
+#define pgm_read_word(p)       (*(const uint16_t*)(p))
+#define pgm_read_word_near(p)  (*(const uint16_t*)(p))
+#define pgm_read_dword(p)      (*(const uint32_t*)(p))
+
+#define strcpy_P(d, s)     strcpy(d, s)
+#define strncpy_P(d, s, n) strncpy(d, s, n)
+#define strlen_P(s)        strlen(s)
+#define memcpy_P(d, s, n)  memcpy(d, s, n)
+
+#endif
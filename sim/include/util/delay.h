@@ -0,0 +1 @@
+// busy-wait delays are not used directly by the firmware
@@ -0,0 +1,41 @@
+// 16x2 character LCD of the simulated board
+
+#include <LiquidCrystal.h>
+
+#include "sim.h"
+
+LiquidCrystal* sim_lcd;
+
+LiquidCrystal::LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3) {
+  memset(_text, ' ', sizeof(_text));
+  for (uint8_t r = 0; r < LCD_ROWS; r++)
+    _text[r][LCD_COLS] = 0;
+  _col = _row = 0;
+  sim_lcd = this;
+}
+
+void LiquidCrystal::begin(uint8_t cols, uint8_t rows) {
+  sim_advance(SIM_MS(50)); // power-up delay in the library
+  clear();
+}
+
+void LiquidCrystal::clear() {
+  sim_advance(SIM_MS(2));
+  for (uint8_t r = 0; r < LCD_ROWS; r++)
+    memset(_text[r], ' ', LCD_COLS);
+  _col = _row = 0;
+}
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+  sim_advance(sim_costs.lcdWrite);
+  _col = col;
+  _row = row < LCD_ROWS ? row : LCD_ROWS - 1;
+}
+
+size_t LiquidCrystal::write(uint8_t ch) {
+  sim_advance(sim_costs.lcdWrite);
+  if (_col < LCD_COLS)
+    _text[_row][_col] = ch;
+  _col++;
+  return 1;
+}
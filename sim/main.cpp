@@ -0,0 +1,220 @@
+// Host simulator of WeatherCentral firmware.
+// Runs setup() and loop() against a virtual 16 MHz clock with RF input from pulse traces,
+// serial console on stdout, LCD, EEPROM and BMP085 stand-ins, and reports timing summary.
+
+#include <Arduino.h>
+#include <LiquidCrystal.h>
+
+#include <stdio.h>
+#include <algorithm>
+
+#include "sim.h"
+#include "trace.h"
+#include "rfgen.h"
+#include "../rxstats.h"
+#include "../OsReceiver.h"
+
+void setup();
+void loop();
+
+static void usage() {
+  fprintf(stderr,
+    "Usage: wcsim [options] [trace ...]\n"
+    "Runs WeatherCentral firmware on a virtual clock, traces are played one after another.\n"
+    "  -t <sec>       simulated time (default: until the end of traces plus 1 sec)\n"
+    "  -g <sensors>   generate traffic of a given number of sensors instead of traces\n"
+    "  -j <usec>      generator: max edge jitter (default 20)\n"
+    "  -d <ppm>       generator: max sensor clock drift (default 100)\n"
+    "  -k <usec>      generator: carrier-on pulse shortening (default 90)\n"
+    "  -b <per min>   generator: noise bursts per minute (default 0)\n"
+    "  -B <msec>      generator: mean noise burst length (default 20)\n"
+    "  -n <per sec>   generator: background noise edges per second (default 0)\n"
+    "  -G <per sec>   generator: glitches that invert the receiver output for 10-100 usec (default 0)\n"
+    "  -r <count>     generator: receivers, the second one needs make RECEIVERS=2 (default 1)\n"
+    "  -f <percent>   generator: messages that every receiver loses on its own (default 0)\n"
+    "  -S <percent>   generator: sensors in a dead spot of every receiver (default 0)\n"
+    "  -s <seed>      generator: random seed (default 1)\n"
+    "  -o <file>      write generated traffic of the first receiver as a trace\n"
+    "  -R <trace>     trace of the second receiver, played from the start\n"
+    "  -c <sec>:<cmd> send console command at a given time\n"
+    "  -e <file>      load EEPROM image from file and save it back on exit\n"
+    "  -l <usec>      cost of one loop() pass (default 20)\n"
+    "  -i <usec>      cost of one interrupt (default 25)\n"
+    "  -q             do not echo console output\n");
+}
+
+static double seconds(sim_time_t t) {
+  return (double)t / SIM_F_CPU;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<SimEdge> edges[SIM_RECEIVERS];
+  sim_time_t traceEnd = 0;
+  sim_time_t trace2End = 0;
+  double limit = -1;
+  const char* eepromFile = 0;
+  const char* traceFile = 0;
+  RfGenConfig gen;
+  rfDefaults(gen);
+  gen.sensors = 0;
+  if (argc < 2) {
+    usage();
+    return 1;
+  }
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = i + 1 < argc ? argv[i + 1] : 0;
+    if (arg[0] != '-') {
+      if (!readTrace(arg, traceEnd, edges[0], traceEnd)) {
+        fprintf(stderr, "wcsim: cannot read trace %s\n", arg);
+        return 1;
+      }
+      continue;
+    }
+    if (arg[1] == 'q') {
+      sim_set_echo(false);
+      continue;
+    }
+    if (!val || arg[2] != 0) {
+      usage();
+      return 1;
+    }
+    i++;
+    switch (arg[1]) {
+    case 't':
+      limit = atof(val);
+      break;
+    case 'c': {
+      const char* cmd = strchr(val, ':');
+      if (!cmd) {
+        usage();
+        return 1;
+      }
+      sim_input((sim_time_t)(atof(val) * SIM_F_CPU), cmd + 1);
+      break;
+    }
+    case 'e':
+      eepromFile = val;
+      sim_eeprom_load(eepromFile);
+      break;
+    case 'g':
+      gen.sensors = atoi(val);
+      break;
+    case 'j':
+      gen.jitter = atof(val);
+      break;
+    case 'd':
+      gen.drift = atof(val);
+      break;
+    case 'k':
+      gen.skew = atof(val);
+      break;
+    case 'b':
+      gen.bursts = atof(val);
+      break;
+    case 'B':
+      gen.burstLength = atof(val);
+      break;
+    case 'n':
+      gen.noise = atof(val);
+      break;
+    case 'G':
+      gen.glitches = atof(val);
+      break;
+    case 'r':
+      gen.receivers = std::min(std::max(atoi(val), 1), SIM_RECEIVERS);
+      break;
+    case 'f':
+      gen.fade = atof(val);
+      break;
+    case 'S':
+      gen.deadSpots = atof(val);
+      break;
+    case 'R':
+      if (!readTrace(val, trace2End, edges[1], trace2End)) {
+        fprintf(stderr, "wcsim: cannot read trace %s\n", val);
+        return 1;
+      }
+      traceEnd = std::max(traceEnd, trace2End);
+      break;
+    case 's':
+      gen.seed = atoi(val);
+      break;
+    case 'o':
+      traceFile = val;
+      break;
+    case 'l':
+      sim_costs.loop = (sim_time_t)(atof(val) * SIM_CYCLES_PER_US);
+      break;
+    case 'i':
+      sim_costs.isr = (sim_time_t)(atof(val) * SIM_CYCLES_PER_US);
+      break;
+    default:
+      usage();
+      return 1;
+    }
+  }
+  long sent = -1;
+  if (gen.sensors > 0 || gen.noise > 0 || gen.bursts > 0 || gen.glitches > 0) {
+    gen.duration = limit >= 0 ? (sim_time_t)(limit * SIM_F_CPU) : SIM_MS(600000);
+    sent = rfGenerate(gen, edges);
+    traceEnd = gen.duration;
+    if (traceFile && !writeTrace(traceFile, edges[0], traceEnd)) {
+      fprintf(stderr, "wcsim: cannot write trace %s\n", traceFile);
+      return 1;
+    }
+  }
+  if (!edges[1].empty() && OSRX_RECEIVERS < 2)
+    fprintf(stderr, "wcsim: firmware has one receiver, edges of the second one are ignored\n");
+  for (int r = 0; r < SIM_RECEIVERS; r++)
+    sim_set_rf(r, edges[r]);
+  sim_time_t end = limit >= 0 ? (sim_time_t)(limit * SIM_F_CPU) : traceEnd + SIM_MS(1000);
+
+  // reset state of the chip
+  sei();
+  setup();
+  sim_time_t loops = 0;
+  sim_time_t maxLoop = 0;
+  while (sim_now < end) {
+    sim_time_t start = sim_now;
+    loop();
+    sim_advance(sim_costs.loop);
+    maxLoop = std::max(maxLoop, sim_now - start);
+    loops++;
+  }
+  fflush(stdout);
+
+  if (eepromFile && !sim_eeprom_save(eepromFile))
+    fprintf(stderr, "wcsim: cannot write EEPROM image %s\n", eepromFile);
+
+  RxStats rx;
+  memcpy(&rx, (const void*)&rxStats, sizeof(rx));
+  fprintf(stderr, "sim: %.3f s simulated, %llu loops, max loop %.3f ms\n",
+    seconds(sim_now), (unsigned long long)loops, seconds(maxLoop) * 1000);
+  fprintf(stderr, "sim: %llu edges, %llu captures, %llu lost captures, %.2f%% time in interrupts\n",
+    (unsigned long long)sim_stats.edges, (unsigned long long)sim_stats.captures,
+    (unsigned long long)sim_stats.lostCaptures, 100.0 * sim_stats.isrTime / (sim_now ? sim_now : 1));
+  fprintf(stderr, "sim: %u packets, %u sync errors, %u checksum failures, %u repaired, %u repeats, %u noise gates, %u filtered, %u blocked, %u resyncs\n",
+    rx.packets, rx.syncErrors, rx.checksumFail, rx.repaired, rx.repeats, rx.gates, rx.filtered, rx.blocked, rx.resyncs);
+  if (sent >= 0) {
+    unsigned long received = 0;
+    for (int i = 0; i < RX_SENSORS; i++)
+      received += rx.sensor[i];
+    fprintf(stderr, "sim: %ld readings sent, %lu received, yield %.1f%%, %.2f readings/min\n",
+      sent, received, sent ? 100.0 * received / sent : 0.0, received * 60 / seconds(sim_now));
+  }
+#if OSRX_RECEIVERS > 1
+  for (int r = 0; r < OSRX_RECEIVERS; r++) {
+    fprintf(stderr, "sim: receiver %d: %u messages heard, %u delivered first", r + 1,
+      OsReceiver.heard[r], OsReceiver.first[r]);
+    if (sent > 0)
+      fprintf(stderr, ", yield %.1f%%", 100.0 * OsReceiver.heard[r] / sent);
+    fprintf(stderr, "\n");
+  }
+#endif
+  fprintf(stderr, "sim: %llu console lines, %.3f s waiting for serial\n",
+    (unsigned long long)sim_stats.lines, seconds(sim_stats.txStall));
+  if (sim_lcd)
+    fprintf(stderr, "sim: LCD |%s|%s|\n", sim_lcd->row(0), sim_lcd->row(1));
+  return 0;
+}
@@ -0,0 +1,11 @@
+// Receiver ISRs of osrx.c compiled as C++, so that the firmware writes to interrupt flag
+// registers clear flags like on the real chip
+
+#include <Arduino.h>
+
+#include "../rxstats.h"
+#include "../profile.h"
+
+extern "C" {
+#include "../osrx.c"
+}
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <random>
+
+#include "rfgen.h"
+
+// nominal half-bit and bit periods of both protocols (1024 Hz data rate)
+#define SHORT_US 488.0
+#define LONG_US  976.0
+
+#define V2_REPEAT_GAP_US 10000.0
+#define MAX_NIBBLES 32
+
+struct Model {
+  uint16_t id;
+  uint8_t protocol;
+  uint8_t length;   // nibbles after the sync nibble up to the checksum
+  double period;    // transmit period on the first channel, sec
+  double step;      // period increase with every next channel, sec
+};
+
+// transmit periods are approximate
+static const Model THGR810   = { 0xF824, 3, 16, 53, 6 };
+static const Model THGR122NX = { 0x1D20, 2, 16, 39, 2 };
+static const Model WGR800    = { 0x1984, 3, 17, 14, 0 };
+static const Model PCR800    = { 0x2914, 3, 18, 47, 0 };
+static const Model UVN800    = { 0xD874, 3, 12, 73, 0 };
+
+struct Sensor {
+  const Model* model;
+  uint8_t channel;
+  uint8_t rc;
+  double clock;   // 1 + clock error
+  double period;  // sec
+  double next;    // time of the next transmission, sec
+  bool dead[SIM_RECEIVERS]; // the receiver is in a dead spot of the sensor
+};
+
+struct Interval {
+  sim_time_t start;
+  sim_time_t end;
+  bool operator<(const Interval& o) const { return start < o.start; }
+};
+
+typedef std::mt19937 Random;
+
+static double uniform(Random& rnd, double a, double b) {
+  return std::uniform_real_distribution<double>(a, b)(rnd);
+}
+
+static double exponential(Random& rnd, double mean) {
+  return std::exponential_distribution<double>(1 / mean)(rnd);
+}
+
+void rfDefaults(RfGenConfig& cfg) {
+  cfg.sensors = 1;
+  cfg.duration = SIM_MS(600000);
+  cfg.jitter = 20;
+  cfg.drift = 100;
+  cfg.skew = 90;
+  cfg.bursts = 0;
+  cfg.burstLength = 20;
+  cfg.noise = 0;
+  cfg.glitches = 0;
+  cfg.receivers = 1;
+  cfg.fade = 0;
+  cfg.deadSpots = 0;
+  cfg.seed = 1;
+}
+
+// The first sensors are the anemometer, rain gauge and UV sensor of the station, the rest
+// are thermo-hygrometers on V3 and V2.1 protocols with channels going round.
+static const Model* sensorModel(int i, uint8_t& channel) {
+  channel = 1;
+  switch (i) {
+  case 1: return &WGR800;
+  case 2: return &PCR800;
+  case 3: return &UVN800;
+  }
+  int t = i < 4 ? 0 : i - 3;
+  if (t % 3 == 2) {
+    channel = 1 + (t / 3) % 3;
+    return &THGR122NX;
+  }
+  channel = 1 + (t - t / 3) % 9;
+  return &THGR810;
+}
+
+// Nibbles of the message: sync, data with plausible readings, checksum and two trailing nibbles
+static int makeMessage(const Sensor& s, Random& rnd, uint8_t* n) {
+  const Model& m = *s.model;
+  n[0] = 0xA;
+  uint8_t* d = &n[1];
+  for (int i = 0; i < m.length; i++)
+    d[i] = rnd() % 10;
+  d[0] = m.id >> 12;
+  d[1] = (m.id >> 8) & 0xf;
+  d[2] = (m.id >> 4) & 0xf;
+  d[3] = m.id & 0xf;
+  d[4] = s.channel;
+  d[5] = s.rc >> 4;
+  d[6] = s.rc & 0xf;
+  d[7] = 0;
+  if (&m == &THGR810 || &m == &THGR122NX)
+    d[11] = rnd() % 4 == 0 ? 8 : 0; // sign
+  uint8_t sum = 0;
+  for (int i = 0; i < m.length; i++)
+    sum += d[i];
+  d[m.length] = sum & 0xf;
+  d[m.length + 1] = sum >> 4;
+  d[m.length + 2] = rnd() & 0xf;
+  d[m.length + 3] = rnd() & 0xf;
+  return m.length + 5;
+}
+
+static inline int messageBit(const uint8_t* n, int i) {
+  return (n[i >> 2] >> (i & 3)) & 1;
+}
+
+// Periods between edges as the decoder sees them, see makeV3/makeV2 in bench/bench.cpp
+static void makePeriods(int protocol, const uint8_t* n, int count, std::vector<double>& p) {
+  p.clear();
+  if (protocol == 3) {
+    for (int i = 0; i < 48; i++)
+      p.push_back(SHORT_US); // 24 one bits
+    int prev = 1;
+    for (int i = 0; i < count * 4; i++) {
+      int b = messageBit(n, i);
+      if (b != prev) {
+        p.push_back(LONG_US);
+      } else {
+        p.push_back(SHORT_US);
+        p.push_back(SHORT_US);
+      }
+      prev = b;
+    }
+  } else {
+    for (int i = 0; i < 32; i++)
+      p.push_back(LONG_US);
+    p.push_back(SHORT_US);
+    p.push_back(SHORT_US);
+    p.push_back(LONG_US);
+    int prev = 0;
+    for (int i = 1; i < count * 4; i++) {
+      int b = messageBit(n, i);
+      if (b != prev) {
+        p.push_back(SHORT_US);
+        p.push_back(SHORT_US);
+      } else
+        p.push_back(LONG_US);
+      p.push_back(LONG_US);
+      prev = b;
+    }
+  }
+}
+
+// Appends carrier-on intervals of one message that starts at a given time, returns its end time
+static double addMessage(const RfGenConfig& cfg, const Sensor& s, double start, const std::vector<double>& p,
+    Random& rnd, std::vector<Interval>& on) {
+  double t = start;
+  double edge = t;
+  for (size_t i = 0; i < p.size(); i++) {
+    double next = t + p[i] * s.clock;
+    bool carrier = (i & 1) == 0;
+    double nextEdge = next + uniform(rnd, -cfg.jitter, cfg.jitter) - (carrier ? cfg.skew : 0);
+    if (carrier && nextEdge > edge)
+      on.push_back({ SIM_US(edge), SIM_US(nextEdge) });
+    edge = nextEdge;
+    t = next;
+  }
+  return t;
+}
+
+// Appends random pulses with given widths between start and end, except during sorted quiet intervals
+static void addNoise(double start, double end, double minWidth, double maxWidth, double meanGap,
+    Random& rnd, std::vector<Interval>& on, const std::vector<Interval>& quiet) {
+  size_t q = 0;
+  double t = start + exponential(rnd, meanGap);
+  while (t < end) {
+    double w = uniform(rnd, minWidth, maxWidth);
+    while (q < quiet.size() && quiet[q].end < SIM_US(t))
+      q++;
+    if (q == quiet.size() || SIM_US(t + w) < quiet[q].start)
+      on.push_back({ SIM_US(t), SIM_US(t + w) });
+    t += w + exponential(rnd, meanGap);
+  }
+}
+
+// Inverts the level for 10-100 usec at random times, two edges at the same time cancel out
+static void addGlitches(double duration, double perSec, Random& rnd, std::vector<SimEdge>& edges) {
+  std::vector<sim_time_t> toggles;
+  for (size_t i = 0; i < edges.size(); i++)
+    toggles.push_back(edges[i].time);
+  for (double t = exponential(rnd, 1e6 / perSec); t < duration; t += exponential(rnd, 1e6 / perSec)) {
+    double w = uniform(rnd, 10, 100);
+    toggles.push_back(SIM_US(t));
+    toggles.push_back(SIM_US(t + w));
+    t += w;
+  }
+  std::sort(toggles.begin(), toggles.end());
+  edges.clear();
+  for (size_t i = 0; i < toggles.size(); i++) {
+    if (i + 1 < toggles.size() && toggles[i + 1] == toggles[i]) {
+      i++;
+      continue;
+    }
+    edges.push_back({ toggles[i], (uint8_t)(edges.size() % 2 == 0) });
+  }
+}
+
+// Appends one copy of the message to the carriers of every receiver that hears it
+static double addCopy(const RfGenConfig& cfg, const Sensor& s, double start, const std::vector<double>& p,
+    Random rnd[], Random& link, std::vector<Interval> on[]) {
+  std::vector<Interval> copy;
+  double end = start;
+  for (int r = 0; r < cfg.receivers; r++) {
+    copy.clear();
+    end = addMessage(cfg, s, start, p, rnd[r], copy);
+    bool faded = cfg.fade > 0 && uniform(link, 0, 100) < cfg.fade;
+    if (!s.dead[r] && !faded)
+      on[r].insert(on[r].end(), copy.begin(), copy.end());
+  }
+  return end;
+}
+
+long rfGenerate(const RfGenConfig& cfg, std::vector<SimEdge> edges[]) {
+  // the first receiver draws jitter and noise from the generator of sensors and messages
+  Random rnd[SIM_RECEIVERS];
+  for (int r = 0; r < SIM_RECEIVERS; r++)
+    rnd[r].seed(cfg.seed + 1000 * r);
+  Random link(cfg.seed + 1);
+  double duration = (double)cfg.duration / SIM_US(1); // usec
+  std::vector<Sensor> sensors;
+  for (int i = 0; i < cfg.sensors; i++) {
+    Sensor s;
+    s.model = sensorModel(i, s.channel);
+    s.rc = rnd[0]() & 0xff;
+    s.clock = 1 + uniform(rnd[0], -cfg.drift, cfg.drift) * 1e-6;
+    s.period = (s.model->period + s.model->step * (s.channel - 1)) * s.clock;
+    s.next = uniform(rnd[0], 0, s.period);
+    for (int r = 0; r < SIM_RECEIVERS; r++)
+      s.dead[r] = cfg.deadSpots > 0 && uniform(link, 0, 100) < cfg.deadSpots;
+    sensors.push_back(s);
+  }
+  std::vector<Interval> on[SIM_RECEIVERS];
+  std::vector<Interval> messages;
+  std::vector<double> periods;
+  uint8_t nibbles[MAX_NIBBLES];
+  long readings = 0;
+  for (size_t i = 0; i < sensors.size(); i++) {
+    Sensor& s = sensors[i];
+    for (double t = s.next * 1e6; t < duration; t += s.period * 1e6) {
+      int count = makeMessage(s, rnd[0], nibbles);
+      makePeriods(s.model->protocol, nibbles, count, periods);
+      double end = addCopy(cfg, s, t, periods, rnd, link, on);
+      if (s.model->protocol == 2)
+        end = addCopy(cfg, s, end + V2_REPEAT_GAP_US, periods, rnd, link, on);
+      messages.push_back({ SIM_US(t), SIM_US(end) });
+      readings++;
+    }
+  }
+  std::sort(messages.begin(), messages.end());
+  for (int r = 0; r < cfg.receivers; r++) {
+    // receiver noise when nothing transmits, the receiver is captured by a transmission
+    if (cfg.noise > 0)
+      addNoise(0, duration, 20, 400, 2e6 / cfg.noise, rnd[r], on[r], messages);
+    // interference bursts that collide with transmissions
+    if (cfg.bursts > 0) {
+      std::vector<Interval> none;
+      for (double t = exponential(rnd[r], 60e6 / cfg.bursts); t < duration; t += exponential(rnd[r], 60e6 / cfg.bursts)) {
+        double length = exponential(rnd[r], cfg.burstLength * 1000);
+        addNoise(t, t + length, 50, 600, 300, rnd[r], on[r], none);
+        t += length;
+      }
+    }
+    // OR all carriers together
+    std::sort(on[r].begin(), on[r].end());
+    edges[r].clear();
+    for (size_t i = 0; i < on[r].size(); ) {
+      sim_time_t start = on[r][i].start;
+      sim_time_t end = on[r][i].end;
+      for (i++; i < on[r].size() && on[r][i].start <= end; i++)
+        end = std::max(end, on[r][i].end);
+      edges[r].push_back({ start, 1 });
+      edges[r].push_back({ end, 0 });
+    }
+    if (cfg.glitches > 0)
+      addGlitches(duration, cfg.glitches, rnd[r], edges[r]);
+  }
+  return readings;
+}
@@ -0,0 +1,34 @@
+// Synthetic RF traffic of Oregon Scientific V2.1 and V3 sensors for the simulator
+#ifndef RFGEN_H
+#define RFGEN_H
+
+#include "sim.h"
+
+struct RfGenConfig {
+  int sensors;          // number of transmitting sensors
+  sim_time_t duration;  // length of generated traffic
+  double jitter;        // max random shift of every edge, usec
+  double drift;         // max clock error of a sensor, ppm
+  double skew;          // carrier-on pulses are shorter by this much, usec
+  double bursts;        // noise bursts per minute
+  double burstLength;   // mean length of a noise burst, msec
+  double noise;         // background noise edges per second when nothing transmits
+  double glitches;      // short inversions of the receiver output per second, also during transmissions
+  int receivers;        // number of receivers, each one gets its own edges
+  double fade;          // share of messages that every receiver loses on its own, percent
+  double deadSpots;     // share of sensors that every receiver never hears, percent
+  unsigned seed;
+};
+
+// Default configuration: one receiver, no noise and fades, 20 usec jitter, 100 ppm drift,
+// 90 usec shorter carrier-on pulses
+void rfDefaults(RfGenConfig& cfg);
+
+// Generates edges of all transmissions and noise OR'ed together with glitches over them for
+// every receiver, returns number of readings that were transmitted (a V2.1 message and its
+// repeat is one reading).
+// The first receiver gets the same edges for the same seed regardless of the number of
+// receivers, the others have independent jitter, fades and noise.
+long rfGenerate(const RfGenConfig& cfg, std::vector<SimEdge> edges[]);
+
+#endif
@@ -0,0 +1,175 @@
+// Print and serial console of the simulated board
+
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <deque>
+
+#include "sim.h"
+
+HardwareSerial Serial;
+
+static sim_time_t charTime = SIM_US(174); // 57600 baud, 10 bits per char
+static sim_time_t txDoneTime;            // when the last queued char leaves the wire
+static bool echo = true;
+
+struct InputChar {
+  sim_time_t time;
+  char ch;
+};
+
+static std::deque<InputChar> input;
+
+void sim_set_echo(bool e) {
+  echo = e;
+}
+
+void sim_input(sim_time_t time, const char* text) {
+  for (const char* p = text; *p; p++)
+    input.push_back({ time, *p });
+  input.push_back({ time, '\n' });
+}
+
+//================= PRINT =================
+
+size_t Print::write(const char* s) {
+  return write((const uint8_t*)s, strlen(s));
+}
+
+size_t Print::write(const uint8_t* buf, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    write(buf[i]);
+  return n;
+}
+
+size_t Print::print(const char* s) {
+  return write(s);
+}
+
+size_t Print::print(char ch) {
+  return write((uint8_t)ch);
+}
+
+size_t Print::printNumber(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char* p = &buf[sizeof(buf) - 1];
+  *p = 0;
+  do {
+    byte d = n % base;
+    *--p = d < 10 ? '0' + d : 'A' + d - 10;
+    n /= base;
+  } while (n != 0);
+  return write(p);
+}
+
+size_t Print::print(unsigned char n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(int n, int base) {
+  return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0)
+    return print('-') + printNumber(-(unsigned long)n, base);
+  return printNumber((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
+
+size_t Print::println(const char* s) {
+  return print(s) + println();
+}
+
+size_t Print::println(char ch) {
+  return print(ch) + println();
+}
+
+size_t Print::println(unsigned char n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(unsigned int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(unsigned long n, int base) {
+  return print(n, base) + println();
+}
+
+//================= SERIAL =================
+
+void HardwareSerial::begin(unsigned long baud) {
+  charTime = 10 * SIM_F_CPU / baud;
+}
+
+void HardwareSerial::end() {
+}
+
+int HardwareSerial::available() {
+  sim_advance(sim_costs.call);
+  int n = 0;
+  for (size_t i = 0; i < input.size() && input[i].time <= sim_now; i++)
+    n++;
+  return n;
+}
+
+int HardwareSerial::peek() {
+  if (input.empty() || input.front().time > sim_now)
+    return -1;
+  return (uint8_t)input.front().ch;
+}
+
+int HardwareSerial::read() {
+  int ch = peek();
+  if (ch >= 0)
+    input.pop_front();
+  return ch;
+}
+
+int HardwareSerial::availableForWrite() {
+  sim_advance(sim_costs.call);
+  if (txDoneTime <= sim_now)
+    return SERIAL_TX_BUFFER_SIZE - 1;
+  int queued = (int)((txDoneTime - sim_now + charTime - 1) / charTime);
+  return queued < SERIAL_TX_BUFFER_SIZE - 1 ? SERIAL_TX_BUFFER_SIZE - 1 - queued : 0;
+}
+
+void HardwareSerial::flush() {
+  sim_advance_to(txDoneTime);
+}
+
+size_t HardwareSerial::write(uint8_t ch) {
+  // block while the transmit buffer is full, like the Arduino core does
+  sim_time_t ready = txDoneTime > (SERIAL_TX_BUFFER_SIZE - 1) * charTime ? txDoneTime - (SERIAL_TX_BUFFER_SIZE - 1) * charTime : 0;
+  if (ready > sim_now) {
+    sim_stats.txStall += ready - sim_now;
+    sim_advance_to(ready);
+  }
+  sim_advance(sim_costs.call);
+  txDoneTime = (txDoneTime > sim_now ? txDoneTime : sim_now) + charTime;
+  if (ch == '\n')
+    sim_stats.lines++;
+  if (echo)
+    putchar(ch);
+  return 1;
+}
@@ -0,0 +1,67 @@
+// Host simulator of WeatherCentral firmware: virtual clock, interrupts and devices
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <vector>
+
+#define SIM_F_CPU 16000000ULL
+#define SIM_CYCLES_PER_US 16
+
+// Virtual time is measured in CPU cycles
+typedef uint64_t sim_time_t;
+
+#define SIM_US(us) ((sim_time_t)(us) * SIM_CYCLES_PER_US)
+#define SIM_MS(ms) ((sim_time_t)(ms) * 1000 * SIM_CYCLES_PER_US)
+
+#define SIM_RECEIVERS 2
+
+struct SimEdge {
+  sim_time_t time;
+  uint8_t level; // 1 when RF carrier is on
+};
+
+// Simulated costs of operations that take time on the real hardware
+struct SimCosts {
+  sim_time_t call;      // millis() and micros() calls, so that busy waits progress
+  sim_time_t loop;      // one pass of loop() besides everything that is simulated explicitly
+  sim_time_t isr;       // entry, exit and body of an interrupt service routine
+  sim_time_t lcdWrite;  // one LCD command or character in 4-bit mode
+  sim_time_t i2cByte;   // one byte over I2C at 100 kHz
+  sim_time_t eepromWrite; // one EEPROM byte write
+};
+
+struct SimStats {
+  uint64_t edges;       // RF edges in the trace that were delivered
+  uint64_t captures;    // edge capture and pin change interrupts that were serviced
+  uint64_t lostCaptures; // edges that were overwritten before the capture interrupt was serviced
+  uint64_t isrs;        // all interrupts that were serviced
+  sim_time_t isrTime;   // time spent in interrupts
+  uint64_t lines;       // console lines
+  uint64_t txStall;     // time spent waiting for serial transmit buffer
+};
+
+extern sim_time_t sim_now;
+extern SimCosts sim_costs;
+extern SimStats sim_stats;
+
+// Moves virtual clock, serving all interrupts that become due
+void sim_advance(sim_time_t cycles);
+void sim_advance_to(sim_time_t time);
+
+// Sets edges for the receiver on ICP1 (PB0), or with receiver 1 for the second receiver
+// on the pin change interrupt of PD4
+void sim_set_rf(int receiver, const std::vector<SimEdge>& edges);
+// Schedules console input at a given time
+void sim_input(sim_time_t time, const char* text);
+// Echo of console output to stdout
+void sim_set_echo(bool echo);
+
+// EEPROM image persistence
+bool sim_eeprom_load(const char* file);
+bool sim_eeprom_save(const char* file);
+
+// Simulated BMP085 raw temperature and pressure readings
+void sim_bmp085_set(uint16_t ut, uint32_t up);
+
+#endif
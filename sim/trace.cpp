@@ -0,0 +1,48 @@
+#include <stdio.h>
+
+#include "trace.h"
+
+bool readTrace(const char* file, sim_time_t start, std::vector<SimEdge>& edges, sim_time_t& end) {
+  FILE* f = fopen(file, "r");
+  if (!f)
+    return false;
+  char line[128];
+  sim_time_t time = start;
+  int lastLevel = -1;
+  bool ok = true;
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+      continue;
+    int level;
+    double duration;
+    if (sscanf(line, "%d %lf", &level, &duration) != 2 || duration < 0) {
+      ok = false;
+      break;
+    }
+    level = level != 0;
+    if (level != lastLevel)
+      edges.push_back({ time, (uint8_t)level });
+    lastLevel = level;
+    time += (sim_time_t)(duration * SIM_CYCLES_PER_US + 0.5);
+  }
+  fclose(f);
+  end = time;
+  return ok;
+}
+
+bool writeTrace(const char* file, const std::vector<SimEdge>& edges, sim_time_t end) {
+  FILE* f = fopen(file, "w");
+  if (!f)
+    return false;
+  sim_time_t time = 0;
+  int level = 0;
+  for (size_t i = 0; i <= edges.size(); i++) {
+    sim_time_t next = i < edges.size() ? edges[i].time : end;
+    if (next > time)
+      fprintf(f, "%d %.3f\n", level, (double)(next - time) / SIM_CYCLES_PER_US);
+    if (i < edges.size())
+      level = edges[i].level;
+    time = next;
+  }
+  return fclose(f) == 0;
+}
@@ -0,0 +1,14 @@
+// Pulse traces of the RF receiver output
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "sim.h"
+
+// Reads a text trace with one "<level> <duration in usec>" pulse per line, where level
+// is 1 when RF carrier is on. Empty lines and lines starting with '#' are ignored.
+// Edges are appended to the list starting at a given time, returns the end time of the trace.
+bool readTrace(const char* file, sim_time_t start, std::vector<SimEdge>& edges, sim_time_t& end);
+// Writes edges as a text trace that ends at a given time
+bool writeTrace(const char* file, const std::vector<SimEdge>& edges, sim_time_t end);
+
+#endif
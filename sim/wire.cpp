@@ -0,0 +1,99 @@
+// I2C bus of the simulated board with a BMP085 pressure sensor on it
+
+#include <Wire.h>
+
+#include "sim.h"
+
+#define BMP085_ADDRESS 0x77
+#define BMP085_CALIB   0xAA
+#define BMP085_CONTROL 0xF4
+#define BMP085_DATA    0xF6
+
+TwoWire Wire;
+
+// calibration values from the example in BMP085 datasheet
+static const int16_t CALIB[11] = { 408, -72, -14383, (int16_t)32741, (int16_t)32757, 23153, 6190, 4, (int16_t)-32768, -8711, 2868 };
+
+static uint16_t rawTemp = 27898;
+static uint32_t rawPres = 23843;
+
+static uint8_t regs[256];
+static uint8_t regPtr;
+static uint8_t txAddr;
+static uint8_t txBuf[32];
+static uint8_t txLen;
+static uint8_t rxBuf[32];
+static uint8_t rxLen;
+static uint8_t rxPos;
+
+void sim_bmp085_set(uint16_t ut, uint32_t up) {
+  rawTemp = ut;
+  rawPres = up;
+}
+
+static void writeReg(uint8_t reg, uint8_t value) {
+  regs[reg] = value;
+  if (reg != BMP085_CONTROL)
+    return;
+  if (value == 0x2E) {
+    regs[BMP085_DATA] = rawTemp >> 8;
+    regs[BMP085_DATA + 1] = rawTemp;
+    regs[BMP085_DATA + 2] = 0;
+  } else if ((value & 0x3f) == 0x34) {
+    uint8_t oss = value >> 6;
+    uint32_t up = rawPres << (8 - oss);
+    regs[BMP085_DATA] = up >> 16;
+    regs[BMP085_DATA + 1] = up >> 8;
+    regs[BMP085_DATA + 2] = up;
+  }
+}
+
+void TwoWire::begin() {
+  for (uint8_t i = 0; i < 11; i++) {
+    regs[BMP085_CALIB + 2 * i] = (uint16_t)CALIB[i] >> 8;
+    regs[BMP085_CALIB + 2 * i + 1] = CALIB[i];
+  }
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddr = address;
+  txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLen >= sizeof(txBuf))
+    return 0;
+  txBuf[txLen++] = data;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission() {
+  sim_advance((txLen + 1) * sim_costs.i2cByte);
+  if (txAddr != BMP085_ADDRESS)
+    return 2; // address NACK
+  if (txLen > 0)
+    regPtr = txBuf[0];
+  for (uint8_t i = 1; i < txLen; i++)
+    writeReg(regPtr++, txBuf[i]);
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  sim_advance((quantity + 1) * sim_costs.i2cByte);
+  rxLen = rxPos = 0;
+  if (address != BMP085_ADDRESS)
+    return 0;
+  if (quantity > sizeof(rxBuf))
+    quantity = sizeof(rxBuf);
+  for (uint8_t i = 0; i < quantity; i++)
+    rxBuf[rxLen++] = regs[regPtr++];
+  return rxLen;
+}
+
+int TwoWire::available() {
+  return rxLen - rxPos;
+}
+
+int TwoWire::read() {
+  return rxPos < rxLen ? rxBuf[rxPos++] : -1;
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Sweeps generated RF traffic over sensor count and noise level and prints CSV:
+#   sensors,noise,bursts,sent,received,yield_percent,readings_per_min
+# Usage: sim/yield.sh [sensor counts] [noise edges/sec] [bursts/min]
+# Set TIME (sec, default 1800), SEEDS (default "1 2 3") and ARGS for other wcsim options.
+
+cd "$(dirname "$0")" || exit 1
+make -s wcsim || exit 1
+
+SENSORS=${1:-"1 2 4 8 14 20"}
+NOISE=${2:-"0 100 1000"}
+BURSTS=${3:-"0"}
+TIME=${TIME:-1800}
+SEEDS=${SEEDS:-"1 2 3"}
+
+echo "sensors,noise,bursts,sent,received,yield_percent,readings_per_min"
+for b in $BURSTS; do
+  for n in $NOISE; do
+    for g in $SENSORS; do
+      for s in $SEEDS; do
+        ./wcsim -q -t "$TIME" -g "$g" -n "$n" -b "$b" -s "$s" $ARGS 2>&1 | grep "readings sent"
+      done | awk -v g="$g" -v n="$n" -v b="$b" -v t="$TIME" '
+        { sent += $2; received += $5 }
+        END { printf "%d,%s,%s,%d,%d,%.1f,%.2f\n", g, n, b, sent, received,
+              sent ? 100 * received / sent : 0, received * 60 / t / NR }'
+    done
+  done
+done
@@ -0,0 +1,76 @@
+
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include "snapshot.h"
+#include "display.h"
+#include "wstats.h"
+#include "Timeout.h"
+#include "schedule.h"
+
+// RainState goes first, so the struct has no padding inside on the host either
+struct Snapshot {
+  RainState rain;
+  DisplayState display;
+  uint16_t seq;
+  uint16_t crc;
+};
+
+// bytes that are written, padding after the CRC (on the host) is not
+#define SNAPSHOT_BYTES (offsetof(Snapshot, crc) + sizeof(uint16_t))
+
+static_assert(SNAPSHOT_BYTES <= SNAPSHOT_SLOT_SIZE, "Snapshot does not fit into EEPROM slot");
+
+Timeout snapshotPeriod(SNAPSHOT_PERIOD);
+Deferred snapshotDeferred;
+byte snapshotSlot; // next slot to write
+uint16_t snapshotSeq; // next sequence number to write
+
+static uint16_t snapshotCrc(const Snapshot& s) {
+  uint16_t crc = 0xffff;
+  const byte* p = (const byte*)&s;
+  for (byte i = 0; i < offsetof(Snapshot, crc); i++)
+    crc = _crc16_update(crc, p[i]);
+  return crc;
+}
+
+static void* slotAddr(byte slot) {
+  return (void*)(size_t)(SNAPSHOT_ADDR + slot * SNAPSHOT_SLOT_SIZE);
+}
+
+void setupSnapshot() {
+  Snapshot s;
+  boolean found = false;
+  byte last = 0;
+  for (byte slot = 0; slot < SNAPSHOT_SLOTS; slot++) {
+    eeprom_read_block(&s, slotAddr(slot), sizeof(s));
+    if (s.crc != snapshotCrc(s))
+      continue; // never written or torn by a reset in the middle of the write
+    if (!found || (int16_t)(s.seq - snapshotSeq) >= 0) {
+      found = true;
+      last = slot;
+      snapshotSeq = s.seq;
+    }
+  }
+  if (!found)
+    return;
+  eeprom_read_block(&s, slotAddr(last), sizeof(s));
+  restoreDisplay(s.display);
+  restoreRain(s.rain);
+  snapshotSeq++;
+  snapshotSlot = last + 1 == SNAPSHOT_SLOTS ? 0 : last + 1;
+}
+
+void checkSnapshot() {
+  if (!snapshotDeferred.ready(snapshotPeriod.check(), BUSY_SNAPSHOT))
+    return;
+  snapshotPeriod.reset(SNAPSHOT_PERIOD);
+  Snapshot s;
+  s.seq = snapshotSeq++;
+  saveDisplay(s.display);
+  saveRain(s.rain);
+  s.crc = snapshotCrc(s);
+  eeprom_update_block(&s, slotAddr(snapshotSlot), SNAPSHOT_BYTES);
+  if (++snapshotSlot == SNAPSHOT_SLOTS)
+    snapshotSlot = 0;
+}
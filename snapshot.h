@@ -0,0 +1,19 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <Arduino.h>
+
+// Warm start snapshots are written in a ring of EEPROM slots to spread the wear.
+// Each slot is written once per SNAPSHOT_SLOTS * SNAPSHOT_PERIOD (45 min), so
+// 100000 EEPROM write cycles last for more than 8 years.
+#define SNAPSHOT_ADDR      0
+#define SNAPSHOT_SLOTS     3
+#define SNAPSHOT_SLOT_SIZE 116 // a snapshot takes 114 bytes on AVR, 116 on the host
+#define SNAPSHOT_PERIOD    (15 * 60000L) // 15 min
+
+// Restores state from the most recent valid snapshot (if any)
+extern void setupSnapshot();
+// Periodically writes snapshot
+extern void checkSnapshot();
+
+#endif
@@ -0,0 +1,64 @@
+// Checks derived metrics against double precision formulas over the full input ranges and
+// prints the max error of each, fails when one exceeds the bound stated in derived.h
+
+#include <stdio.h>
+#include <math.h>
+
+#include "derived.h"
+
+// bounds of derived.h in C or hPa
+#define DEW_POINT_ERROR     0.12 // dew points above -30 C
+#define DEW_POINT_ERROR_LOW 0.25 // dew points from -40 to -30 C
+#define HUMIDEX_ERROR       0.1
+#define WIND_CHILL_ERROR    0.1
+#define QNH_ERROR           0.1
+
+// Magnus formula, the same constants as ES_TABLE
+static double vapourPressure(double t) {
+  return 6.112 * exp(17.62 * t / (243.12 + t));
+}
+
+static int failures;
+
+static void check(const char* name, double error, double bound) {
+  printf("derived_test: %-20s max error %.4f, bound %.2f\n", name, error, bound);
+  if (error > bound) {
+    fprintf(stderr, "derived_test: %s error is out of bound\n", name);
+    failures++;
+  }
+}
+
+static void update(double& maxError, double value, double reference) {
+  double e = fabs(value - reference);
+  if (e > maxError)
+    maxError = e;
+}
+
+int main() {
+  double dp = 0, dpLow = 0, hx = 0, wc = 0, qnh = 0;
+  for (int t = -400; t <= 600; t++) {
+    for (int h = 1; h <= 100; h++) {
+      double e = vapourPressure(t / 10.0) * h / 100;
+      double l = log(e / 6.112);
+      double td = 243.12 * l / (17.62 - l);
+      if (td >= -40)
+        update(td > -30 ? dp : dpLow, dewPoint(t, h) / 10.0, td);
+      update(hx, humidex(t, h) / 10.0, t / 10.0 + 5.0 / 9 * (e - 10));
+    }
+  }
+  // formula range: T <= 10 C, V >= 4.8 km/h, up to 50 m/s
+  for (int t = -400; t <= 100; t++) {
+    for (int v = 14; v <= 500; v++) {
+      double p = pow(v * 0.36, 0.16);
+      update(wc, windChill(t, v) / 10.0, 13.12 + 0.6215 * t / 10 - 11.37 * p + 0.3965 * t / 10 * p);
+    }
+  }
+  for (int p = 3000; p <= 11000; p++)
+    update(qnh, seaLevelPressure(p) / 10.0, p / 10.0 / pow(1 - STATION_ALTITUDE / 44330.0, 5.255));
+  check("dew point", dp, DEW_POINT_ERROR);
+  check("dew point below -30", dpLow, DEW_POINT_ERROR_LOW);
+  check("humidex", hx, HUMIDEX_ERROR);
+  check("wind chill", wc, WIND_CHILL_ERROR);
+  check("qnh", qnh, QNH_ERROR);
+  return failures == 0 ? 0 : 1;
+}
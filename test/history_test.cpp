@@ -0,0 +1,185 @@
+// Logs hours with and without readings over resets, dumps the log and checks that every
+// hour starts with a flagged record, that silent hours leave a mark, that a reset leaves
+// one boot record, that hours are placed over the wrap of the log and that a log of an older
+// layout is erased
+
+#include <stdio.h>
+#include <string.h>
+
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include "history.h"
+#include "display.h"
+#include "xprint.h"
+#include "Timeout.h"
+#include "schedule.h"
+
+extern byte historyPos;
+extern byte historyLap;
+
+static uint8_t eeprom[E2END + 1];
+static unsigned long now = 1000;
+static uint8_t frame[8 + HISTORY_BYTES];
+static size_t frameLen;
+
+//================= STAND-INS =================
+
+uint8_t eeprom_read_byte(const uint8_t* addr) {
+  return eeprom[(size_t)addr];
+}
+
+void eeprom_update_byte(uint8_t* addr, uint8_t value) {
+  eeprom[(size_t)addr] = value;
+}
+
+void eeprom_read_block(void* dst, const void* src, size_t n) {
+  memcpy(dst, eeprom + (size_t)src, n);
+}
+
+void eeprom_update_block(const void* src, void* dst, size_t n) {
+  memcpy(eeprom + (size_t)dst, src, n);
+}
+
+unsigned long millis() {
+  return now;
+}
+
+boolean Deferred::ready(boolean due, unsigned long busy) {
+  return due;
+}
+
+byte sensorIndex(char code) {
+  return code == 'T' ? OUTDOOR_CHANNEL : MAX_SENSORS;
+}
+
+void waitPrint() {
+}
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t ch) {
+  if (frameLen < sizeof(frame))
+    frame[frameLen++] = ch;
+  return 1;
+}
+
+//================= TEST =================
+
+static int failures;
+
+static void expect(bool ok, const char* what, int a, int b) {
+  if (ok)
+    return;
+  if (failures++ < 10)
+    fprintf(stderr, "history_test: %s: %d, expected %d\n", what, a, b);
+}
+
+static void reset() {
+  historyPos = 0;
+  historyLap = 0;
+  setupHistory();
+}
+
+// runs an hour, with a reading of the outdoor temperature or without
+static void hour(bool reading) {
+  if (reading)
+    updateHistory('T', HISTORY_TEMP, 215);
+  now += Timeout::HOUR;
+  checkHistory();
+}
+
+// dumps the log, checks the frame and returns the number of records
+static int dump() {
+  frameLen = 0;
+  dumpHistory();
+  expect(frameLen >= 6 && frame[0] == 'W' && frame[1] == 'H', "frame header", frameLen, 6);
+  int count = frame[2];
+  expect(frameLen == 6 + 4 * (size_t)count, "frame length", frameLen, 6 + 4 * count);
+  uint16_t crc = 0xffff;
+  for (size_t i = 2; i < frameLen - 2; i++)
+    crc = _crc16_update(crc, frame[i]);
+  expect((frame[frameLen - 2] | frame[frameLen - 1] << 8) == crc, "frame crc",
+    frame[frameLen - 2] | frame[frameLen - 1] << 8, crc);
+  return count;
+}
+
+static const uint8_t* record(int i) {
+  return &frame[4 + 4 * i];
+}
+
+static bool isMark(const uint8_t* r, byte mark) {
+  return (r[0] & 0x3f) == (HISTORY_MARK << 4 | mark);
+}
+
+static bool startsHour(const uint8_t* r) {
+  return (r[0] & 0x40) != 0;
+}
+
+int main() {
+  memset(eeprom, 0xff, sizeof(eeprom)); // erased
+  reset();
+  // readings in hours 0 and 1, silent hours 2 and 3, a reading in hour 4
+  hour(true);
+  hour(true);
+  hour(false);
+  hour(false);
+  hour(true);
+  int count = dump();
+  expect(count == 5, "records", count, 5);
+  static const bool SILENT[] = { false, false, true, true, false };
+  for (int i = 0; i < 5 && i < count; i++) {
+    const uint8_t* r = record(i);
+    expect(startsHour(r), "hour flag", r[0], r[0] | 0x40);
+    expect(isMark(r, HISTORY_SILENT) == SILENT[i], "silent mark", r[0], i);
+  }
+  // a reset adds a boot record, a second one adds nothing
+  reset();
+  reset();
+  count = dump();
+  expect(count == 6, "records after resets", count, 6);
+  expect(isMark(record(5), HISTORY_BOOT) && !startsHour(record(5)), "boot record", record(5)[0],
+    HISTORY_MARK << 4 | HISTORY_BOOT);
+  // over the wrap of the log with a reset every 100 hours
+  for (int h = 0; h < 700; h++) {
+    if (h % 100 == 99)
+      reset();
+    hour(h % 7 != 3);
+  }
+  reset();
+  count = dump();
+  expect(count == HISTORY_RECORDS, "records of the full log", count, HISTORY_RECORDS);
+  // walk back from the end: the last record is the boot one, every hour before it has
+  // exactly one flagged record, a silent one for each 7th hour of the loop
+  expect(isMark(record(count - 1), HISTORY_BOOT), "last boot record", record(count - 1)[0],
+    HISTORY_MARK << 4 | HISTORY_BOOT);
+  int h = 700;
+  int boots = 0;
+  for (int i = count - 2; i >= 0; i--) {
+    const uint8_t* r = record(i);
+    if (isMark(r, HISTORY_BOOT)) {
+      boots++;
+      expect(h % 100 == 99, "hour of a boot record", h, h / 100 * 100 + 99);
+      continue;
+    }
+    h--;
+    expect(startsHour(r), "hour flag", r[0], r[0] | 0x40);
+    if (h % 7 == 3) {
+      expect(isMark(r, HISTORY_SILENT), "silent mark", r[0], HISTORY_MARK << 4 | HISTORY_SILENT);
+      continue;
+    }
+    expect(r[3] == r[2] && r[2] == (215 + 400) / 5, "value of record", r[2], (215 + 400) / 5);
+  }
+  expect(boots >= 1, "boot records", boots, 1);
+  // a log of an older layout is erased
+  eeprom[HISTORY_ADDR] = 0x01;
+  reset();
+  count = dump();
+  expect(count == 0, "records of an older log", count, 0);
+  reset();
+  hour(true);
+  count = dump();
+  expect(count == 1 && startsHour(record(0)), "records after the erase", count, 1);
+  printf("history_test: %d failures\n", failures);
+  return failures == 0 ? 0 : 1;
+}
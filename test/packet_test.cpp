@@ -0,0 +1,133 @@
+// Writes a canned message of every model of the gateway decoder as a passthrough line,
+// decodes it on the gateway side and compares the display line with the one of the
+// firmware parsePacket for the same nibbles. Models that only the gateway knows are
+// compared with the firmware line of a model with the same layout.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "packet.h"
+#include "parse.h"
+#include "display.h"
+#include "fmt_util.h"
+#include "rxstats.h"
+#include "sensors.h"
+
+char displayBuf[DISPLAY_LENGTH + 1];
+char extraBuf[EXTRA_LENGTH + 1];
+volatile RxStats rxStats;
+
+//================= STAND-INS =================
+
+static SensorState sensor;
+
+unsigned long millis() {
+  return 1000;
+}
+
+byte sensorIndex(char code) {
+  return MAX_SENSORS;
+}
+
+void scheduleStale(unsigned long interval) {
+}
+
+SensorState& updateSensor(uint16_t id, byte channel, byte rc, unsigned long time, boolean repaired) {
+  return sensor;
+}
+
+unsigned long sensorTimeout(const SensorState& s) {
+  return 0;
+}
+
+void adoptSensor(byte code) {
+}
+
+void updateHistory(char code, byte kind, int16_t value) {
+}
+
+//================= TEST =================
+
+struct Message {
+  uint16_t parseAs; // id that the firmware parses the same way, 0 for the id of the message
+  uint8_t nibble[PACKET_NIBBLES]; // data nibbles after the sync nibble, the checksum is added
+  int len;
+};
+
+// one of every model in packet.cpp, status nibbles cover battery and other flags
+static const Message MESSAGES[] = {
+  { 0, { 0xF, 0x8, 0x2, 0x4, 1, 0xA, 0x5, 0, 3, 1, 2, 0, 5, 4 }, 14 },
+  { 0, { 0xF, 0x8, 0xB, 0x4, 2, 0x3, 0x1, 4, 7, 0, 0, 8, 9, 0 }, 14 },
+  { 0, { 0x1, 0xD, 0x2, 0x0, 3, 0xC, 0x6, 0, 0, 0, 0, 0, 0, 1 }, 14 },
+  { 0xF824, { 0x1, 0xA, 0x2, 0xD, 1, 0x2, 0x2, 8, 9, 9, 9, 1, 9, 9 }, 14 },
+  { 0xF824, { 0x1, 0xA, 0x3, 0xD, 4, 0x7, 0x0, 0, 5, 2, 0, 0, 3, 6 }, 14 },
+  { 0, { 0x2, 0x9, 0x1, 0x4, 1, 0x3, 0xC, 0, 5, 2, 0, 0, 7, 4, 3, 1, 0, 0 }, 18 },
+  { 0, { 0xD, 0x8, 0x7, 0x4, 1, 0x6, 0x1, 4, 4, 1 }, 10 },
+  { 0, { 0xE, 0xC, 0x7, 0x0, 1, 0x6, 0x1, 0, 9, 0 }, 10 },
+  { 0, { 0x1, 0x9, 0x8, 0x4, 1, 0x2, 0x7, 0, 6, 0, 0, 3, 4, 0, 5, 2, 0 }, 17 },
+  { 0, { 0x1, 0x9, 0x9, 0x4, 1, 0x2, 0x7, 0xC, 0xF, 0, 0, 9, 9, 9, 0, 0, 1 }, 17 },
+  // unknown model
+  { 0, { 0x5, 0xD, 0x6, 0x0, 1, 0x4, 0x4, 0, 1, 2, 3, 4, 5, 6 }, 14 },
+};
+
+#define COUNT (int)(sizeof(MESSAGES) / sizeof(MESSAGES[0]))
+
+static int failures;
+
+static void fail(const char* what, int i, const char* a, const char* b) {
+  if (failures++ < 10)
+    fprintf(stderr, "packet_test: message %d: %s: \"%s\", expected \"%s\"\n", i, what, a, b);
+}
+
+// line of emitPacket in pipeline.cpp
+static size_t writeLine(const Message& m, char* line) {
+  uint8_t sum = 0;
+  for (int i = 0; i < m.len; i++)
+    sum += m.nibble[i];
+  int n = sprintf(line, "OS3:");
+  for (int i = 0; i < m.len; i++)
+    line[n++] = HEX_CHARS[m.nibble[i]];
+  line[n++] = HEX_CHARS[sum & 0xf];
+  line[n++] = HEX_CHARS[sum >> 4];
+  return n + sprintf(line + n, " 123456");
+}
+
+int main() {
+  for (int i = 0; i < COUNT; i++) {
+    const Message& m = MESSAGES[i];
+    char line[2 * PACKET_NIBBLES];
+    size_t len = writeLine(m, line);
+    Packet p;
+    if (!parsePacket((const uint8_t*)line, len, p)) {
+      fail("not parsed", i, line, "");
+      continue;
+    }
+    if (p.version != 3 || p.millis != 123456 || p.len != m.len + 2)
+      fail("message", i, line, "");
+    char display[PACKET_DISPLAY + 1] = { 0 };
+    decodePacket(p, display);
+    // the firmware parses nibbles after the sync nibble with two more after the checksum
+    byte nibbles[PACKET_NIBBLES + 2] = { 0 };
+    memcpy(nibbles, p.nibble, p.len);
+    if (m.parseAs != 0) {
+      nibbles[0] = m.parseAs >> 12;
+      nibbles[1] = (m.parseAs >> 8) & 0xf;
+      nibbles[2] = (m.parseAs >> 4) & 0xf;
+      nibbles[3] = m.parseAs & 0xf;
+    }
+    parsePacket(nibbles, p.len + 2, 1000, false);
+    if (memcmp(display, displayBuf, PACKET_DISPLAY) != 0)
+      fail("display line", i, display, displayBuf);
+  }
+  // a wrong checksum and other lines are not messages
+  char line[2 * PACKET_NIBBLES];
+  size_t len = writeLine(MESSAGES[0], line);
+  Packet p;
+  line[6] = line[6] == '0' ? '1' : '0';
+  if (parsePacket((const uint8_t*)line, len, p))
+    fail("wrong checksum is parsed", 0, line, "");
+  if (parsePacket((const uint8_t*)"[1:  21.3 45%    ]", 18, p))
+    fail("reading is parsed", 0, "", "");
+  printf("packet_test: %d messages, %d failures\n", COUNT, failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// Adds samples to the rollups of the gateway in a temporary directory and checks the
+// aggregates read back: min, max and sum, duplicates, rain counter resets and late totals,
+// vector wind and periods around the end of a common year
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <vector>
+
+#include "rollup.h"
+
+#define MINUTE_MS (60 * 1000LL)
+#define HOUR_MS   (60 * MINUTE_MS)
+#define Y2027     1798761600000LL // 2027-01-01 00:00 UTC, 2026 has 365 days
+
+static std::string dir;
+static int failures;
+
+static void expect(bool ok, const char* what, double a, double b) {
+  if (ok)
+    return;
+  if (failures++ < 10)
+    fprintf(stderr, "rollup_test: %s: %g, expected %g\n", what, a, b);
+}
+
+static Sample sample(int64_t time, int32_t a, int32_t b = 0, int32_t c = 0) {
+  Sample s = { time, { a, b, c } };
+  return s;
+}
+
+static void collect(const RollupRecord& r, char code, int columns, void* ctx) {
+  ((std::vector<RollupRecord>*)ctx)->push_back(r);
+}
+
+static std::vector<RollupRecord> scan(char code, int level, int64_t from, int64_t to) {
+  std::vector<RollupRecord> v;
+  scanRollups(dir, "s", code, level, from, to, collect, &v);
+  return v;
+}
+
+int main() {
+  char tmp[] = "/tmp/rollup_testXXXXXX";
+  if (!mkdtemp(tmp)) {
+    perror("rollup_test");
+    return 1;
+  }
+  dir = tmp;
+  int64_t t0 = Y2027 - 10 * MINUTE_MS; // 2026-12-31 23:50
+  {
+    Rollups r(dir);
+    // temperature and humidity over the new year
+    r.add("s", '1', 2, sample(t0, 215, 40));
+    r.add("s", '1', 2, sample(Y2027, -30, 60));
+    r.add("s", '1', 2, sample(Y2027 + 30 * MINUTE_MS, 10, 50));
+    expect(!r.add("s", '1', 2, sample(Y2027, -30, 60)), "duplicate is added", 0, 1);
+    r.add("s", '1', 2, sample(Y2027 + HOUR_MS, 50, 55));
+    expect(r.duplicates == 1, "duplicates", r.duplicates, 1);
+    // rain: a counter reset and a late total count no increase
+    int64_t h = Y2027 + 2 * HOUR_MS;
+    r.add("s", 'R', 2, sample(h, 100));
+    r.add("s", 'R', 2, sample(h + 10 * MINUTE_MS, 150));
+    r.add("s", 'R', 2, sample(h + 20 * MINUTE_MS, 40)); // reset
+    r.add("s", 'R', 2, sample(h + 5 * MINUTE_MS, 120)); // late
+    r.add("s", 'R', 2, sample(h + 30 * MINUTE_MS, 60));
+    r.add("s", 'R', 2, sample(h + 70 * MINUTE_MS, 65));
+    // wind: north and east at the same speed average to north-east
+    r.add("s", 'W', 3, sample(h, 30, 40, 0));
+    r.add("s", 'W', 3, sample(h + MINUTE_MS, 30, 50, 4));
+    expect(r.errors == 0, "errors", r.errors, 0);
+  }
+  // the new year goes to the 2027 files
+  std::vector<RollupRecord> v = scan('1', ROLLUP_HOUR, Y2027, Y2027 + 24 * HOUR_MS);
+  expect(v.size() == 2, "hours of Jan 1", v.size(), 2);
+  if (v.size() == 2) {
+    expect(v[0].start == Y2027 && v[0].slot.count == 2, "samples of the first hour", v[0].slot.count, 2);
+    expect(v[0].value[0].min == -30 && v[0].value[0].max == 10, "min of the first hour", v[0].value[0].min, -30);
+    expect(v[0].value[0].sum == -20 && v[0].value[1].sum == 110, "sum of the first hour", v[0].value[0].sum, -20);
+    expect(v[1].start == Y2027 + HOUR_MS && v[1].slot.count == 1, "second hour", v[1].slot.count, 1);
+  }
+  v = scan('1', ROLLUP_DAY, Y2027, Y2027 + 24 * HOUR_MS);
+  expect(v.size() == 1 && v[0].slot.count == 3, "samples of Jan 1", v.size() ? v[0].slot.count : 0, 3);
+  v = scan('1', ROLLUP_DAY, t0 - 24 * HOUR_MS, Y2027);
+  expect(v.size() == 1 && v[0].slot.count == 1, "samples of Dec 31", v.size() ? v[0].slot.count : 0, 1);
+  expect(v.size() == 1 && v[0].value[0].max == 215, "max of Dec 31", v.size() ? v[0].value[0].max : 0, 215);
+  v = scan('1', ROLLUP_MINUTE, t0, Y2027 + 2 * HOUR_MS);
+  expect(v.size() == 4, "minutes", v.size(), 4);
+  v = scan('1', ROLLUP_DAY, 0, INT64_MAX);
+  expect(v.size() == 2, "days", v.size(), 2);
+  // rain: 50 up to the reset, 20 after it in the first hour, 5 in the second
+  v = scan('R', ROLLUP_HOUR, Y2027, Y2027 + 24 * HOUR_MS);
+  expect(v.size() == 2, "rain hours", v.size(), 2);
+  if (v.size() == 2) {
+    expect(v[0].slot.increase == 70, "rain of the first hour", v[0].slot.increase, 70);
+    expect(v[0].slot.count == 5, "rain samples", v[0].slot.count, 5);
+    expect(v[1].slot.increase == 5, "rain of the second hour", v[1].slot.increase, 5);
+  }
+  v = scan('W', ROLLUP_HOUR, Y2027, Y2027 + 24 * HOUR_MS);
+  expect(v.size() == 1, "wind hours", v.size(), 1);
+  if (v.size() == 1) {
+    double d = rollupWindDir(v[0]);
+    expect(fabs(d - 45) < 0.01, "wind direction", d, 45);
+    expect(v[0].value[1].max == 50, "gust", v[0].value[1].max, 50);
+  }
+  system(("rm -rf " + dir).c_str());
+  printf("rollup_test: %d failures\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+// Writes warm start snapshots into an EEPROM image, tears writes at every byte and checks
+// that the newest complete snapshot is restored after the reset, that the next one goes to
+// the following slot and that the sequence number wraps over 0xffff
+
+#include <stdio.h>
+#include <string.h>
+
+#include <avr/eeprom.h>
+
+#include "snapshot.h"
+#include "display.h"
+#include "wstats.h"
+#include "Timeout.h"
+#include "schedule.h"
+
+extern byte snapshotSlot;
+extern uint16_t snapshotSeq;
+
+static uint8_t eeprom[E2END + 1];
+static long writeBudget = -1; // bytes until the reset that tears a write, -1 for none
+static size_t writeSize;      // of the last write, the size of a snapshot
+
+static uint32_t savedMark;    // goes into the next snapshot
+static uint32_t restoredMark; // of the restored snapshot, 0 when none
+static bool writeDue;
+
+//================= STAND-INS =================
+
+void eeprom_read_block(void* dst, const void* src, size_t n) {
+  memcpy(dst, eeprom + (size_t)src, n);
+}
+
+void eeprom_update_block(const void* src, void* dst, size_t n) {
+  writeSize = n;
+  for (size_t i = 0; i < n; i++) {
+    if (writeBudget == 0)
+      return;
+    if (writeBudget > 0)
+      writeBudget--;
+    eeprom[(size_t)dst + i] = ((const uint8_t*)src)[i];
+  }
+}
+
+boolean Timeout::check() {
+  return true;
+}
+
+void Timeout::reset(unsigned long interval) {
+}
+
+boolean Deferred::ready(boolean due, unsigned long busy) {
+  return writeDue;
+}
+
+// the mark is spread over both parts, so that a torn write is seen in any of them
+void saveDisplay(DisplayState& ds) {
+  memset(&ds, (uint8_t)savedMark, sizeof(ds));
+  memcpy(ds.line, &savedMark, sizeof(savedMark));
+}
+
+void restoreDisplay(const DisplayState& ds) {
+  memcpy(&restoredMark, ds.line, sizeof(restoredMark));
+}
+
+void saveRain(RainState& rs) {
+  memset(&rs, (uint8_t)(savedMark >> 8), sizeof(rs));
+  rs.lastTotal = savedMark;
+}
+
+void restoreRain(const RainState& rs) {
+  if ((uint32_t)rs.lastTotal != restoredMark)
+    restoredMark = 0xffffffff; // parts of different snapshots
+}
+
+//================= TEST =================
+
+static int failures;
+
+static void expect(bool ok, const char* what, uint32_t a, uint32_t b) {
+  if (ok)
+    return;
+  if (failures++ < 10)
+    fprintf(stderr, "snapshot_test: %s: %lu, expected %lu\n", what, (unsigned long)a, (unsigned long)b);
+}
+
+static void reset() {
+  snapshotSlot = 0;
+  snapshotSeq = 0;
+  restoredMark = 0;
+  writeBudget = -1;
+  setupSnapshot();
+}
+
+static void write(uint32_t mark) {
+  savedMark = mark;
+  writeDue = true;
+  checkSnapshot();
+  writeDue = false;
+}
+
+// writes count snapshots after a reset, tears the next one after a given number of bytes
+// and checks the restored snapshot and the next slot and sequence number after another reset
+static void run(uint32_t& mark, int count, long tearAt) {
+  reset();
+  uint32_t last = restoredMark;
+  byte lastSlot = 0;
+  uint16_t lastSeq = 0;
+  for (int i = 0; i < count; i++) {
+    lastSlot = snapshotSlot;
+    lastSeq = snapshotSeq;
+    write(last = ++mark);
+  }
+  writeBudget = tearAt;
+  write(++mark);
+  reset();
+  expect(restoredMark == last, "restored snapshot", restoredMark, last);
+  if (last != 0) {
+    expect(snapshotSlot == (lastSlot + 1) % SNAPSHOT_SLOTS, "next slot", snapshotSlot,
+      (lastSlot + 1) % SNAPSHOT_SLOTS);
+    expect(snapshotSeq == (uint16_t)(lastSeq + 1), "next sequence number", snapshotSeq,
+      (uint16_t)(lastSeq + 1));
+  }
+}
+
+int main() {
+  memset(eeprom, 0xff, sizeof(eeprom)); // erased
+  reset();
+  expect(restoredMark == 0, "snapshot in erased EEPROM", restoredMark, 0);
+  uint32_t mark = 0;
+  write(++mark);
+  int runs = 0;
+  // every tear point of writes into every slot
+  for (int count = 1; count <= 2 * SNAPSHOT_SLOTS; count++) {
+    for (long tearAt = 0; tearAt < (long)writeSize; tearAt++) {
+      run(mark, count, tearAt);
+      runs++;
+    }
+  }
+  // a full ring of writes over the wrap of the sequence number from 0xffff to 0
+  memset(eeprom, 0xff, sizeof(eeprom));
+  reset();
+  snapshotSeq = 0xffff - SNAPSHOT_SLOTS;
+  for (int i = 0; i < 2 * SNAPSHOT_SLOTS; i++)
+    write(++mark);
+  uint16_t seq = snapshotSeq;
+  reset();
+  expect(restoredMark == mark, "restored snapshot after the wrap", restoredMark, mark);
+  expect(snapshotSeq == seq, "sequence number after the wrap", snapshotSeq, seq);
+  for (long tearAt = 0; tearAt < (long)writeSize; tearAt++) {
+    run(mark, 1, tearAt);
+    runs++;
+  }
+  printf("snapshot_test: %d torn writes, %d failures\n", runs, failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// Writes samples with deltas at every bucket edge of the codec into a store in a temporary
+// directory, scans them back over ranges around segment and block edges, then cuts the
+// last block short and checks that it is dropped and that appending goes on after it
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+#include "store.h"
+
+#define DAY 1772323200000LL // 2026-03-01 00:00 UTC
+
+static std::string dir;
+static int failures;
+
+static void expect(bool ok, const char* what, long long a, long long b) {
+  if (ok)
+    return;
+  if (failures++ < 10)
+    fprintf(stderr, "store_test: %s: %lld, expected %lld\n", what, a, b);
+}
+
+static uint32_t seed = 1;
+
+static uint32_t next() {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// value deltas around the bucket sizes of 4, 8, 16 and 32 bits
+static const int64_t EDGES[] = { 0, 1, -1, 7, 8, -8, -9, 127, 128, -128, -129, 32767, 32768,
+  -32768, -32769, 2147483647LL, -2147483647LL - 1 };
+
+static std::vector<Sample> makeSamples(int count) {
+  std::vector<Sample> v;
+  int64_t time = DAY + 500;
+  int64_t gap = 0;
+  int32_t value[READING_VALUES] = { 0, 0, 0 };
+  for (int i = 0; i < count; i++) {
+    // delta of delta: repeated gaps, jitter and jumps over every time bucket
+    switch (i % 7) {
+    case 0: break;
+    case 1: gap += (int64_t)(next() % 256) - 128; break;
+    case 2: gap += (int64_t)(next() % 8192) - 4096; break;
+    case 3: gap = i % 1000 == 3 ? 600000 : 5000; break; // a silent station hits the last bucket
+    case 4: gap = 0; break; // readings of one read share a time
+    default: gap = 5000 + next() % 40000;
+    }
+    if (gap < 0)
+      gap = -gap;
+    time += gap;
+    Sample s;
+    s.time = time;
+    for (int c = 0; c < READING_VALUES; c++) {
+      int64_t d = EDGES[(i + c * 5) % (sizeof(EDGES) / sizeof(EDGES[0]))];
+      // the extremes go to the other end of the range and back
+      if (d > 0x7fff || d < -0x8000)
+        value[c] = (int32_t)d;
+      else
+        value[c] += (int32_t)d;
+      s.value[c] = value[c];
+    }
+    v.push_back(s);
+  }
+  return v;
+}
+
+static void append(const std::vector<Sample>& v, size_t from, size_t to) {
+  Store store(dir, STORE_DAY_MS);
+  for (size_t i = from; i < to; i++) {
+    Reading r;
+    r.code = 'W';
+    r.count = READING_VALUES;
+    memcpy(r.value, v[i].value, sizeof(r.value));
+    expect(store.append("s", r, v[i].time), "append", i, 0);
+  }
+}
+
+static void collect(const Sample& s, int columns, void* ctx) {
+  ((std::vector<Sample>*)ctx)->push_back(s);
+}
+
+static void checkRange(const std::vector<Sample>& v, size_t count, int64_t from, int64_t to) {
+  std::vector<Sample> got;
+  bool ok = scanFile(storePath(dir, "s", 'W', DAY), from, to, collect, &got);
+  expect(ok, "file can be read", 0, 1);
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (v[i].time < from || v[i].time >= to)
+      continue;
+    if (n < got.size()) {
+      expect(got[n].time == v[i].time, "time", got[n].time, v[i].time);
+      for (int c = 0; c < READING_VALUES; c++)
+        expect(got[n].value[c] == v[i].value[c], "value", got[n].value[c], v[i].value[c]);
+    }
+    n++;
+  }
+  expect(got.size() == n, "samples in range", got.size(), n);
+}
+
+static void checkAll(const std::vector<Sample>& v, size_t count) {
+  checkRange(v, count, INT64_MIN, INT64_MAX);
+  // from and to at, before and after every segment and block start
+  for (size_t i = 0; i < count; i += STORE_SEGMENT) {
+    int64_t t = v[i].time;
+    for (int64_t d = -1; d <= 1; d++) {
+      checkRange(v, count, t + d, INT64_MAX);
+      checkRange(v, count, INT64_MIN, t + d);
+      checkRange(v, count, t + d, t + d + 100000);
+    }
+  }
+  checkRange(v, count, v[count - 1].time + 1, INT64_MAX);
+  checkRange(v, count, v[5].time, v[5].time); // empty
+}
+
+int main() {
+  char tmp[] = "/tmp/store_testXXXXXX";
+  if (!mkdtemp(tmp)) {
+    perror("store_test");
+    return 1;
+  }
+  dir = tmp;
+  std::vector<Sample> v = makeSamples(2 * STORE_BLOCK + 300);
+  expect(v.back().time < DAY + STORE_DAY_MS, "samples fit a day", v.back().time, DAY + STORE_DAY_MS);
+  size_t first = STORE_BLOCK + 500;
+  append(v, 0, first); // a full block and a partial one
+  checkAll(v, first);
+  // a crash in the middle of writing the last block
+  std::string path = storePath(dir, "s", 'W', DAY);
+  struct stat st;
+  stat(path.c_str(), &st);
+  append(v, first, first + 100);
+  if (truncate(path.c_str(), st.st_size + 40) != 0)
+    perror("store_test");
+  checkAll(v, first);
+  // the torn block is dropped when the day is opened for writing again
+  append(v, first, v.size());
+  checkAll(v, v.size());
+  system(("rm -rf " + dir).c_str());
+  printf("store_test: %d samples, %d failures\n", (int)v.size(), failures);
+  return failures == 0 ? 0 : 1;
+}
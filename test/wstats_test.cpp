@@ -0,0 +1,81 @@
+// Feeds rain totals with large jumps and counter resets over two days and checks that
+// the hour and day sums stay equal to the totals of their buckets and clear when the
+// buckets rotate out, then checks how long a wind gust stays in the 2 and 10 minute windows
+
+#include <stdio.h>
+
+#include "wstats.h"
+
+extern uint16_t rainHourBucket[RAIN_HOUR_BUCKETS];
+extern uint16_t rainDayBucket[RAIN_DAY_BUCKETS];
+
+static unsigned long now = 1000;
+
+unsigned long millis() {
+  return now;
+}
+
+static int failures;
+
+static void expect(bool ok, const char* what, unsigned long minute) {
+  if (ok)
+    return;
+  if (failures++ < 10)
+    fprintf(stderr, "wstats_test: %s at %lu\n", what, minute);
+}
+
+static void checkSums(unsigned long minute) {
+  uint32_t hour = 0;
+  for (int i = 0; i < RAIN_HOUR_BUCKETS; i++)
+    hour += rainHourBucket[i];
+  uint32_t day = 0;
+  for (int i = 0; i < RAIN_DAY_BUCKETS; i++)
+    day += rainDayBucket[i];
+  expect(rainHour() == hour, "hour sum differs from its buckets", minute);
+  expect(rainDay() == day, "day sum differs from its buckets", minute);
+}
+
+int main() {
+  int32_t total = 0;
+  updateRain(total);
+  unsigned long minute = 0;
+  // a day of rain every minute: steps up to 3 bucket saturations and a reset every 5 hours
+  for (; minute < 24 * 60; minute++) {
+    now += 60000;
+    total = minute % 300 == 299 ? 0 : total + (int32_t)(minute * 7919 % 200000);
+    updateRain(total);
+    checkSums(minute);
+  }
+  // a dry day rotates everything out
+  for (; minute < 48 * 60; minute++) {
+    now += 60000;
+    updateRain(total);
+    checkSums(minute);
+    if (minute >= 24 * 60 + 60)
+      expect(rainHour() == 0, "hour sum is not clear after a dry hour", minute);
+  }
+  expect(rainDay() == 0, "day sum is not clear after a dry day", minute);
+  // a gust among calm samples every 10 s leaves the windows after 1.5-2 and 9.5-10 minutes,
+  // it comes late in a bucket of 30 s (and of a minute), where the windows are the shortest
+  updateWind(0, 0, 0);
+  now += 55000;
+  updateWind(4, 30, 150);
+  unsigned long gust = now;
+  for (int s = 10; s <= 11 * 60; s += 10) {
+    now = gust + s * 1000L;
+    updateWind(0, 0, 0);
+    WindStats ws2, ws10;
+    windStats2(ws2);
+    windStats10(ws10);
+    if (s < 90)
+      expect(ws2.gust == 150 && ws2.dir == 90, "gust is not in the 2 min window", s);
+    if (s >= 120)
+      expect(ws2.gust == 0 && ws2.dir == -1, "gust stays in the 2 min window", s);
+    if (s < 570)
+      expect(ws10.gust == 150 && ws10.dir == 90, "gust is not in the 10 min window", s);
+    if (s >= 600)
+      expect(ws10.gust == 0 && ws10.dir == -1, "gust stays in the 10 min window", s);
+  }
+  printf("wstats_test: %lu minutes, %d failures\n", minute, failures);
+  return failures == 0 ? 0 : 1;
+}
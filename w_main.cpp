@@ -7,40 +7,23 @@
 #include "fmt_util.h"
 #include "xprint.h"
 #include "bmp085.h"
+#include "snapshot.h"
+#include "history.h"
+#include "command.h"
+#include "profile.h"
+#include "filter.h"
+#include "pipeline.h"
+#include "rawcap.h"
 
 const char BANNER[] PROGMEM = "{W:WeatherCentral started}*\r\n";
 
-// Serialize packet for WeatherStation Data Logger Software
-//void serialize(byte* packet, byte len, byte version) {
-//  char cPacket[70];
-//  int dest = 0;
-//
-//  cPacket[dest++] = 'O'; 
-//  cPacket[dest++] = 'S';
-//  cPacket[dest++] = version + '0';
-//  cPacket[dest++] = ':';
-//
-//  for (byte k = 1; k + 2 < len && k + 2 < (byte)sizeof(cPacket); k++)
-//    cPacket[dest++] = HEX_CHARS[packet[k]];
-//  cPacket[dest++] = 0;
-//  Serial.println(cPacket);
-//}
-
-void receiveWeatherData() {
-  if (!OsReceiver.data_available())
-    return;
-  byte packet[65];
-  byte version;
-  byte len = OsReceiver.get_data(packet, sizeof(packet), &version);
-  if (len <= 1)
-    return;
-  //serialize(&packet[0], len, version);
-  parsePacket(&packet[1], len - 1);
-}
-
 void setup() {
   setupPrint();
   setupDisplay();
+  setupSnapshot();
+  setupHistory();
+  setupFilter();
+  setupPipeline();
   OsReceiver.init();
   setupBMP085();
   waitPrint();
@@ -48,8 +31,15 @@ void setup() {
 }
 
 void loop() {
-  receiveWeatherData();
+  PROFILE_LOOP();
+  checkPipeline();
   checkDisplay();
   checkBMP085();
+  checkSnapshot();
+  checkHistory();
+  checkCommand();
+#if ENABLE_RAW_CAPTURE
+  checkRawCapture();
+#endif
 }
 
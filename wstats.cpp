@@ -0,0 +1,220 @@
+
+#include <avr/pgmspace.h>
+
+#include "wstats.h"
+
+#define RAIN_BUCKET_PERIOD (5 * 60000L) // 5 min
+#define WIND_BUCKET_PERIOD 30000L       // 30 s
+
+#define NO_TOTAL (-1L)
+
+// sin of 16 wind sectors (N = 0, clockwise) in 1/64 units
+const int8_t SECTOR_SIN[16] PROGMEM = { 0, 24, 45, 59, 64, 59, 45, 24, 0, -24, -45, -59, -64, -59, -45, -24 };
+
+// atan(k/16) for k = 0..16 in 0.1 degree
+const uint16_t ATAN_TABLE[17] PROGMEM = { 0, 36, 71, 106, 140, 174, 206, 236, 266, 294, 320, 345, 369, 391, 412, 432, 450 };
+
+//================= RAIN =================
+
+uint16_t rainHourBucket[RAIN_HOUR_BUCKETS]; // buckets saturate at 0xffff
+uint16_t rainDayBucket[RAIN_DAY_BUCKETS];
+uint32_t rainHourSum; // always the total of the buckets
+uint32_t rainDaySum;
+byte rainHourPos;
+byte rainDayPos;
+int32_t rainLastTotal = NO_TOTAL;
+unsigned long rainBucketTime;
+
+// Rotates 5 min buckets (and hour buckets on every 12th one) for the time that has passed
+static void advanceRain(unsigned long time) {
+  uint16_t n = 0;
+  while (time - rainBucketTime >= RAIN_BUCKET_PERIOD && n < RAIN_DAY_BUCKETS * RAIN_HOUR_BUCKETS) {
+    rainBucketTime += RAIN_BUCKET_PERIOD;
+    n++;
+    if (++rainHourPos == RAIN_HOUR_BUCKETS) {
+      rainHourPos = 0;
+      if (++rainDayPos == RAIN_DAY_BUCKETS)
+        rainDayPos = 0;
+      rainDaySum -= rainDayBucket[rainDayPos];
+      rainDayBucket[rainDayPos] = 0;
+    }
+    rainHourSum -= rainHourBucket[rainHourPos];
+    rainHourBucket[rainHourPos] = 0;
+  }
+  if (n == RAIN_DAY_BUCKETS * RAIN_HOUR_BUCKETS)
+    rainBucketTime = time; // everything is clear after a very long silence
+}
+
+// Adds to a bucket up to its saturation, returns what was added
+static uint16_t addRain(uint16_t& bucket, uint16_t delta) {
+  uint16_t room = 0xffff - bucket;
+  if (delta > room)
+    delta = room;
+  bucket += delta;
+  return delta;
+}
+
+void updateRain(int32_t total) {
+  unsigned long time = millis();
+  if (rainLastTotal == NO_TOTAL) {
+    rainBucketTime = time;
+    rainLastTotal = total;
+    return;
+  }
+  advanceRain(time);
+  // counter restarts from zero when sensor batteries are replaced
+  int32_t delta = total >= rainLastTotal ? total - rainLastTotal : total;
+  rainLastTotal = total;
+  if (delta > 0xffff)
+    delta = 0xffff;
+  rainHourSum += addRain(rainHourBucket[rainHourPos], delta);
+  rainDaySum += addRain(rainDayBucket[rainDayPos], delta);
+}
+
+uint32_t rainHour() {
+  advanceRain(millis());
+  return rainHourSum;
+}
+
+uint32_t rainDay() {
+  advanceRain(millis());
+  return rainDaySum;
+}
+
+void saveRain(RainState& rs) {
+  advanceRain(millis());
+  rs.lastTotal = rainLastTotal;
+  memcpy(rs.hour, rainHourBucket, sizeof(rainHourBucket));
+  memcpy(rs.day, rainDayBucket, sizeof(rainDayBucket));
+  rs.hourPos = rainHourPos;
+  rs.dayPos = rainDayPos;
+}
+
+// Time while the device was off is not known, so windows continue from the saved moment
+void restoreRain(const RainState& rs) {
+  rainLastTotal = rs.lastTotal;
+  memcpy(rainHourBucket, rs.hour, sizeof(rainHourBucket));
+  memcpy(rainDayBucket, rs.day, sizeof(rainDayBucket));
+  rainHourPos = rs.hourPos % RAIN_HOUR_BUCKETS;
+  rainDayPos = rs.dayPos % RAIN_DAY_BUCKETS;
+  rainHourSum = 0;
+  for (byte i = 0; i < RAIN_HOUR_BUCKETS; i++)
+    rainHourSum += rainHourBucket[i];
+  rainDaySum = 0;
+  for (byte i = 0; i < RAIN_DAY_BUCKETS; i++)
+    rainDaySum += rainDayBucket[i];
+  rainBucketTime = millis();
+}
+
+//================= WIND =================
+
+struct WindBucket {
+  int16_t x;      // sum of north components of unit direction vectors
+  int16_t y;      // sum of east components of unit direction vectors
+  uint16_t speed; // sum of average speeds
+  int16_t gust;   // maximal gust
+  byte count;     // number of samples
+};
+
+WindBucket windBucket[WIND_BUCKETS];
+WindBucket windSum; // running sums over all buckets, gust is maximum over all buckets
+byte windPos;
+unsigned long windBucketTime;
+
+static void advanceWind(unsigned long time) {
+  byte n = 0;
+  while (time - windBucketTime >= WIND_BUCKET_PERIOD && n < WIND_BUCKETS) {
+    windBucketTime += WIND_BUCKET_PERIOD;
+    n++;
+    if (++windPos == WIND_BUCKETS)
+      windPos = 0;
+    WindBucket& b = windBucket[windPos];
+    windSum.x -= b.x;
+    windSum.y -= b.y;
+    windSum.speed -= b.speed;
+    windSum.count -= b.count;
+    memset(&b, 0, sizeof(b));
+  }
+  if (n == WIND_BUCKETS)
+    windBucketTime = time; // everything is clear after a long silence
+  if (n == 0)
+    return;
+  // maximum is not subtractable, so recompute it once per bucket rotation
+  windSum.gust = 0;
+  for (byte i = 0; i < WIND_BUCKETS; i++)
+    if (windBucket[i].gust > windSum.gust)
+      windSum.gust = windBucket[i].gust;
+}
+
+void updateWind(uint8_t dir, int16_t avg, int16_t gust) {
+  advanceWind(millis());
+  WindBucket& b = windBucket[windPos];
+  if (avg > 0) {
+    // calm samples have no direction
+    int8_t x = pgm_read_byte(&SECTOR_SIN[(dir + 4) & 0x0f]);
+    int8_t y = pgm_read_byte(&SECTOR_SIN[dir & 0x0f]);
+    b.x += x;
+    b.y += y;
+    windSum.x += x;
+    windSum.y += y;
+  }
+  b.speed += avg;
+  windSum.speed += avg;
+  b.count++;
+  windSum.count++;
+  if (gust > b.gust)
+    b.gust = gust;
+  if (gust > windSum.gust)
+    windSum.gust = gust;
+}
+
+// Returns direction of vector (x = north, y = east) in degrees 0..359 or -1 for zero vector
+static int16_t vectorDirection(int16_t x, int16_t y) {
+  uint16_t ax = abs(x);
+  uint16_t ay = abs(y);
+  if (ax == 0 && ay == 0)
+    return -1;
+  boolean swap = ay > ax;
+  uint16_t t = swap ? ((uint32_t)ax << 8) / ay : ((uint32_t)ay << 8) / ax; // tan in 1/256 (0..256)
+  byte i = t >> 4;
+  int16_t a = pgm_read_word(&ATAN_TABLE[i]);
+  if (i < 16)
+    a += ((pgm_read_word(&ATAN_TABLE[i + 1]) - a) * (t & 0x0f) + 8) >> 4;
+  if (swap)
+    a = 900 - a;
+  if (x < 0)
+    a = 1800 - a;
+  if (y < 0)
+    a = 3600 - a;
+  a = (a + 5) / 10;
+  return a == 360 ? 0 : a;
+}
+
+static void fillStats(WindStats& ws, int16_t x, int16_t y, uint16_t speed, byte count, int16_t gust) {
+  ws.avg = count == 0 ? 0 : speed / count;
+  ws.dir = vectorDirection(x, y);
+  ws.gust = gust;
+}
+
+void windStats2(WindStats& ws) {
+  advanceWind(millis());
+  WindBucket s;
+  memset(&s, 0, sizeof(s));
+  byte i = windPos;
+  for (byte n = 0; n < WIND_BUCKETS_2; n++) {
+    WindBucket& b = windBucket[i];
+    s.x += b.x;
+    s.y += b.y;
+    s.speed += b.speed;
+    s.count += b.count;
+    if (b.gust > s.gust)
+      s.gust = b.gust;
+    i = i == 0 ? WIND_BUCKETS - 1 : i - 1;
+  }
+  fillStats(ws, s.x, s.y, s.speed, s.count, s.gust);
+}
+
+void windStats10(WindStats& ws) {
+  advanceWind(millis());
+  fillStats(ws, windSum.x, windSum.y, windSum.speed, windSum.count, windSum.gust);
+}
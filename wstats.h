@@ -0,0 +1,43 @@
+#ifndef WSTATS_H
+#define WSTATS_H
+
+#include <Arduino.h>
+
+// Sliding windows are kept in circular buckets with running sums, so each update is O(1)
+#define RAIN_HOUR_BUCKETS 12    // 5 min each
+#define RAIN_DAY_BUCKETS  24    // 1 hour each
+#define WIND_BUCKETS      20    // 30 s each
+#define WIND_BUCKETS_2    4     // the last ones that make the 2 min window
+
+struct WindStats {
+  int16_t avg;   // average speed in 0.1 m/s
+  int16_t dir;   // vector-averaged direction in degrees, -1 when calm
+  int16_t gust;  // maximal gust in 0.1 m/s
+};
+
+// rain state that is kept in the warm start snapshot
+struct RainState {
+  int32_t lastTotal;
+  uint16_t hour[RAIN_HOUR_BUCKETS];
+  uint16_t day[RAIN_DAY_BUCKETS];
+  byte hourPos;
+  byte dayPos;
+};
+
+// Updates rain windows with bucket total (in sensor units), handles counter resets
+extern void updateRain(int32_t total);
+// Rain over the last hour and last 24 hours (in sensor units)
+extern uint32_t rainHour();
+extern uint32_t rainDay();
+
+extern void saveRain(RainState& rs);
+extern void restoreRain(const RainState& rs);
+
+// Updates wind windows with 16-sector direction, average and gust speeds (in 0.1 m/s)
+extern void updateWind(uint8_t dir, int16_t avg, int16_t gust);
+// Wind statistics over the last 2 and 10 minutes. The current bucket has only started, so the
+// windows cover 1.5-2 and 9.5-10 minutes of samples.
+extern void windStats2(WindStats& ws);
+extern void windStats10(WindStats& ws);
+
+#endif
@@ -1,5 +1,6 @@
 #include "xprint.h"
 #include "Timeout.h"
+#include "fmt_util.h"
 
 const long INITIAL_PRINT_INTERVAL = 1000L; // wait 1 s before first print to get XBee time to initialize & join
 const long PRINT_INTERVAL         = 250L;  // wait 250 ms between prints 
@@ -7,12 +8,18 @@ const long PRINT_INTERVAL         = 250L;  // wait 250 ms between prints
 Timeout printTimeout(INITIAL_PRINT_INTERVAL);
 
 void setupPrint() {
-  Serial.begin(57600);  
+  Serial.begin(CONSOLE_BAUD);
 }
 
-void waitPrint() {
-  while (!printTimeout.check()); // just wait...
+boolean tryPrint() {
+  if (!printTimeout.check())
+    return false;
   printTimeout.reset(PRINT_INTERVAL);
+  return true;
+}
+
+void waitPrint() {
+  while (!tryPrint()); // just wait...
 }
 
 void waitPrintln(const char* s) {
@@ -33,3 +40,8 @@ void print_P(PGM_P str) {
   printOn_P(Serial, str); 
 }
 
+void printHex(uint16_t x, byte digits) {
+  while (digits-- > 0)
+    Serial.print(HEX_CHARS[(x >> (digits << 2)) & 0xf]);
+}
+
@@ -4,13 +4,19 @@
 #include <Arduino.h>
 #include <avr/pgmspace.h>
 
+#define CONSOLE_BAUD 57600
+
 void setupPrint();
 
 void waitPrint();
+// Returns true and starts the next pace interval when the console can be printed to now
+boolean tryPrint();
 void waitPrintln(const char* s);
 
 void printOn_P(Print& out, PGM_P str);
 void print_P(PGM_P str);
+// Prints the lower digits of x in hex with leading zeroes
+void printHex(uint16_t x, byte digits);
 
 // Workaround for http://gcc.gnu.org/bugzilla/show_bug.cgi?id=34734 
 #ifdef PROGMEM 